@@ -0,0 +1,37 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Bodies of the multi-key endpoints (/mget, /mput, /mdel), on both the
+// server and the proxy. Every length is a LEB128 varint:
+//
+//   keys    : count | (key_len | key)*                 /mget, /mdel requests
+//   pairs   : count | (key_len | key | val_len | val)*  /mput request
+//   results : count | (status | [val_len | val])*       every response
+//
+// Results are positional: result i answers item i of the request. Only a
+// Found result carries a value.
+enum class BatchStatus : uint8_t {
+    Missing = 0,  // /mget: no such key; /mdel: nothing to delete
+    Ok = 1,       // /mput, /mdel: applied
+    Found = 2,    // /mget: value follows
+    Error = 3,    // The owning backend failed (proxy only)
+};
+
+struct BatchResult {
+    BatchStatus status = BatchStatus::Missing;
+    std::string value;
+};
+
+void encode_batch_keys(std::string& out, const std::vector<std::string_view>& keys);
+bool decode_batch_keys(std::string_view body, std::vector<std::string_view>& keys);
+
+void encode_batch_pairs(std::string& out, const std::vector<std::string_view>& keys,
+                        const std::vector<std::string_view>& values);
+bool decode_batch_pairs(std::string_view body, std::vector<std::string_view>& keys,
+                        std::vector<std::string_view>& values);
+
+void encode_batch_results(std::string& out, const std::vector<BatchResult>& results);
+bool decode_batch_results(std::string_view body, std::vector<BatchResult>& results);
@@ -0,0 +1,72 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+// Native binary protocol of kv_server and kv_proxy, a leaner alternative to
+// HTTP for the data path. A connection carries a stream of frames in each
+// direction (integers little-endian):
+//
+//   frame : u32 body_len | u32 request_id | u8 code | payload
+//
+// body_len counts everything after itself. In a request `code` is a BinOp,
+// in a response a BinStatus; a response echoes its request's ID. Clients
+// may pipeline any number of requests without waiting, and responses can
+// come back in a different order, so they are matched by ID.
+//
+//   Get, Del    payload: key                 response: value (Get, Ok)
+//   Put         payload: varint key_len | key | value
+//   MGet, MDel  payload: batch_codec keys    response: batch_codec results
+//   MPut        payload: batch_codec pairs   response: batch_codec results
+//   Ping        payload: empty               response: empty
+//
+// Requests on one connection are applied in the order they were sent.
+
+enum class BinOp : uint8_t {
+    Ping = 0,
+    Get = 1,
+    Put = 2,
+    Del = 3,
+    MGet = 4,
+    MPut = 5,
+    MDel = 6,
+};
+
+// Lower-case op name ("mget"), or "other" for an unknown code.
+const char* bin_op_name(uint8_t code);
+
+enum class BinStatus : uint8_t {
+    Ok = 0,
+    NotFound = 1,     // Get / Del of a missing key
+    BadRequest = 2,   // Unknown op or malformed payload
+    Error = 3,        // WAL failure, or a backend failed (proxy)
+    Unavailable = 4,  // Proxy: no storage node can take the key
+};
+
+constexpr size_t kFrameHeaderSize = 9;
+constexpr uint32_t kMaxFrameBody = 64 << 20;
+
+// The binary listener's default port is the HTTP port plus this.
+constexpr int kBinaryPortOffset = 1000;
+
+struct Frame {
+    uint32_t id;
+    uint8_t code;
+    std::string_view payload;
+};
+
+enum class FrameDecode {
+    Ok,
+    Incomplete,  // Need more bytes
+    TooLarge     // body_len is out of bounds; the stream is unusable
+};
+
+void encode_frame(std::string& out, uint32_t id, uint8_t code, std::string_view payload = {});
+
+// Decodes one frame at data[0..len). On Ok, `consumed` is the frame size and
+// frame.payload points into `data`.
+FrameDecode decode_frame(const char* data, size_t len, Frame& frame, size_t& consumed);
+
+std::string encode_put_payload(std::string_view key, std::string_view value);
+bool decode_put_payload(std::string_view payload, std::string_view& key, std::string_view& value);
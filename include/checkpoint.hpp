@@ -0,0 +1,72 @@
+#pragma once
+#include "shard_store.hpp"
+#include "wal_writer.hpp"
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+
+// Restore and checkpoint figures, exported on the server's /stats endpoint.
+struct PersistenceStats {
+    std::atomic<uint64_t> restore_ms{0};
+    std::atomic<uint64_t> restored_snapshot_keys{0};
+    std::atomic<uint64_t> replayed_wal_records{0};
+    std::atomic<uint64_t> snapshot_bytes{0};
+    std::atomic<uint64_t> snapshot_keys{0};
+    std::atomic<uint64_t> checkpoints{0};
+    std::atomic<uint64_t> last_checkpoint_ms{0};
+};
+
+// Snapshot + WAL checkpointing.
+//
+// A checkpoint rotates the active WAL to <wal>.ckpt, writes every shard to
+// <snapshot>.tmp, fsyncs and renames it over the snapshot, then deletes the
+// rotated segment. Ops that land in the new WAL while the snapshot is being
+// written may also appear in the snapshot; replaying them again on restart
+// is harmless because SET/DEL are last-writer-wins per key.
+class CheckpointManager {
+public:
+    CheckpointManager(ShardStore& store, WalWriter& wal, std::string snapshot_path, std::string wal_path);
+    ~CheckpointManager();
+
+    // Loads the snapshot, then replays the rotated segment left by an
+    // interrupted checkpoint (finishing that checkpoint) and the active WAL.
+    // Each file is mmap'd and replayed with `replay_threads` workers.
+    // Must run before the WalWriter is opened.
+    bool restore(unsigned replay_threads);
+
+    // Runs one checkpoint now.
+    bool checkpoint();
+
+    // Background checkpoints every `interval_s` seconds, or as soon as the
+    // WAL grows past `wal_bytes_limit`. Zero disables that trigger.
+    void start(int interval_s, uint64_t wal_bytes_limit);
+    void stop();
+
+    // Clears every shard, the WAL and the snapshot (the /reset endpoint).
+    void reset();
+
+    const PersistenceStats& stats() const { return stats_; }
+
+private:
+    bool writeSnapshot();
+    bool replayFile(const std::string& path, bool is_snapshot, uint64_t& records);
+    void run(int interval_s, uint64_t wal_bytes_limit);
+
+    ShardStore& store_;
+    WalWriter& wal_;
+    std::string snapshot_path_;
+    std::string wal_path_;
+    std::string rotated_path_;
+    unsigned replay_threads_ = 1;
+    PersistenceStats stats_;
+
+    std::mutex checkpoint_mutex_;  // One checkpoint or reset at a time
+
+    std::mutex thread_mutex_;
+    std::condition_variable thread_cv_;
+    bool stop_ = false;
+    std::thread thread_;
+};
@@ -0,0 +1,104 @@
+#pragma once
+#include "httplib.h"
+#include "metrics.hpp"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Per-backend pool of keep-alive httplib clients, so proxied requests reuse
+// TCP connections instead of paying a handshake each time.
+class ConnectionPool {
+public:
+    struct Options {
+        size_t max_per_backend = 32;  // Leased + idle connections per backend
+        int connect_timeout_s = 1;
+        int read_timeout_s = 5;       // Per request; migrations use a pool with a longer one
+        int max_idle_s = 30;          // Idle connections older than this are replaced
+    };
+
+    struct Stats {
+        std::atomic<uint64_t> hits{0};        // Served from an idle connection
+        std::atomic<uint64_t> misses{0};      // Had to open a new connection
+        std::atomic<uint64_t> waits{0};       // Had to wait for a free slot
+        std::atomic<uint64_t> wait_us{0};     // Total time spent waiting
+        std::atomic<uint64_t> evictions{0};   // Broken or stale connections dropped
+    };
+
+private:
+    struct Idle {
+        std::unique_ptr<httplib::Client> client;
+        std::chrono::steady_clock::time_point since;
+    };
+
+    struct Backend {
+        std::string ip;
+        int port = 0;
+        std::mutex mutex;
+        std::condition_variable cv;
+        std::vector<Idle> idle;
+        size_t open = 0;  // Leased + idle
+        Stats stats;
+        Histogram* latency = nullptr;  // Round trips reported through Lease::observe
+        Counter* errors = nullptr;     // Leases marked broken
+    };
+
+public:
+    // A borrowed connection; goes back to the pool when destroyed. Call
+    // markBroken() after a transport error so it is evicted instead.
+    class Lease {
+    public:
+        Lease() = default;
+        Lease(Lease&& other) noexcept;
+        Lease& operator=(Lease&& other) noexcept;
+        ~Lease();
+
+        explicit operator bool() const { return client_ != nullptr; }
+        httplib::Client* operator->() const { return client_.get(); }
+        httplib::Client& operator*() const { return *client_; }
+        void markBroken() { broken_ = true; }
+        // Records one request on this backend, sent at `start`, in
+        // kv_proxy_backend_request_duration_seconds.
+        void observe(std::chrono::steady_clock::time_point start) const {
+            if (backend_) backend_->latency->recordSince(start);
+        }
+
+    private:
+        friend class ConnectionPool;
+        Lease(ConnectionPool* pool, Backend* backend, std::unique_ptr<httplib::Client> client)
+            : pool_(pool), backend_(backend), client_(std::move(client)) {}
+        void release();
+
+        ConnectionPool* pool_ = nullptr;
+        Backend* backend_ = nullptr;
+        std::unique_ptr<httplib::Client> client_;
+        bool broken_ = false;
+    };
+
+    ConnectionPool() : ConnectionPool(Options()) {}
+    explicit ConnectionPool(Options options) : options_(options) {}
+
+    // Blocks while the backend is at max_per_backend. Returns an empty lease
+    // if `address` is not a valid "ip:port".
+    Lease acquire(const std::string& address);
+
+    // Drops idle connections to a backend that left the cluster.
+    void evictIdle(const std::string& address);
+
+    // One line per backend: hits, misses, hit rate, waits, wait time, evictions.
+    std::string statsText();
+
+private:
+    Backend* backend(const std::string& address);
+    void giveBack(Backend* backend, std::unique_ptr<httplib::Client> client, bool broken);
+
+    Options options_;
+    std::shared_mutex backends_mutex_;
+    std::unordered_map<std::string, std::unique_ptr<Backend>> backends_;
+};
@@ -0,0 +1,11 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+// CRC-32C (Castagnoli). Uses the SSE4.2 / ARMv8 CRC instructions when the
+// CPU has them, otherwise a slice-by-8 table kernel. Pass a previous result
+// as `crc` to checksum data in pieces.
+uint32_t crc32c(const void* data, size_t len, uint32_t crc = 0);
+
+// Name of the kernel picked at runtime ("sse4.2", "armv8", "table").
+const char* crc32c_kernel();
@@ -0,0 +1,40 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Thin wrappers over POSIX / MSVCRT file descriptors for the WAL and
+// snapshot code, which need fdatasync and exact control over writes.
+
+int file_open_append(const std::string& path);
+int file_open_trunc(const std::string& path);
+bool file_write_all(int fd, const char* data, size_t len);
+bool file_sync(int fd);                       // fdatasync (fsync / _commit elsewhere)
+bool file_truncate(int fd, uint64_t size);
+int64_t file_size(int fd);
+void file_close(int fd);
+
+// Makes a preceding rename in `path`'s directory durable (no-op on Windows).
+void file_sync_parent_dir(const std::string& path);
+
+// Read-only view of a whole file: mmap'd on POSIX, read into memory on Windows.
+class MappedFile {
+public:
+    MappedFile() = default;
+    ~MappedFile() { close(); }
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool open(const std::string& path);
+    void close();
+
+    const char* data() const { return data_; }
+    size_t size() const { return size_; }
+
+private:
+    const char* data_ = nullptr;
+    size_t size_ = 0;
+#ifdef _WIN32
+    std::string buffer_;
+#endif
+};
@@ -0,0 +1,96 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+
+// Key with inline storage: short keys live inside the slot, longer ones
+// spill to a single heap buffer. The pointer is memcpy'd into the inline
+// bytes so the whole key stays 24 bytes with 4-byte alignment.
+class InlineKey {
+public:
+    static constexpr size_t kInlineCapacity = 20;
+
+    InlineKey() : len(0) {}
+    explicit InlineKey(std::string_view s);
+    InlineKey(InlineKey&& other) noexcept;
+    InlineKey& operator=(InlineKey&& other) noexcept;
+    InlineKey(const InlineKey&) = delete;
+    InlineKey& operator=(const InlineKey&) = delete;
+    ~InlineKey() { release(); }
+
+    size_t size() const { return len; }
+    bool isInline() const { return len <= kInlineCapacity; }
+    const char* data() const { return isInline() ? buf : heapPtr(); }
+    std::string_view view() const { return std::string_view(data(), len); }
+
+private:
+    uint32_t len;
+    char buf[kInlineCapacity];
+
+    char* heapPtr() const { char* p; std::memcpy(&p, buf, sizeof(p)); return p; }
+    void release();
+};
+
+// Swiss-table style open-addressing map from string keys to string values.
+// Slots are stored flat next to a control byte array; each control byte holds
+// 7 bits of the hash (or EMPTY / DELETED), and lookups compare 16 control
+// bytes at a time (SSE2 when available) before touching any key.
+class FlatStringMap {
+public:
+    static constexpr size_t kGroupWidth = 16;
+
+    struct Slot {
+        InlineKey key;
+        std::string value;
+    };
+
+    FlatStringMap() = default;
+    ~FlatStringMap();
+    FlatStringMap(FlatStringMap&& other) noexcept;
+    FlatStringMap& operator=(FlatStringMap&& other) noexcept;
+    FlatStringMap(const FlatStringMap&) = delete;
+    FlatStringMap& operator=(const FlatStringMap&) = delete;
+
+    std::string* find(std::string_view key);
+    const std::string* find(std::string_view key) const;
+    bool contains(std::string_view key) const { return find(key) != nullptr; }
+
+    // Returns true if the key was newly inserted, false if it was overwritten.
+    bool insertOrAssign(std::string_view key, std::string value);
+    bool erase(std::string_view key);
+
+    void clear();
+    void reserve(size_t count);
+
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+    size_t capacity() const { return capacity_; }
+
+    // Approximate heap footprint: table, spilled keys and non-SSO values.
+    // O(1): the key and value bytes are counted as slots are filled and
+    // emptied, so values must only change through insertOrAssign.
+    size_t memoryUsage() const;
+
+    template <typename Fn>
+    void forEach(Fn&& fn) const {
+        for (size_t i = 0; i < capacity_; ++i) {
+            if (ctrl_[i] >= 0) fn(slots_[i].key.view(), slots_[i].value);
+        }
+    }
+
+private:
+    int8_t* ctrl_ = nullptr;
+    Slot* slots_ = nullptr;
+    size_t capacity_ = 0;   // Always 0 or a power of two >= kGroupWidth
+    size_t size_ = 0;
+    size_t growth_left_ = 0;
+    size_t heap_bytes_ = 0;  // Spilled keys and non-SSO values; see memoryUsage
+
+    static size_t hashOf(std::string_view key);
+    size_t findIndex(std::string_view key, size_t hash) const;
+    size_t findInsertSlot(size_t hash) const;
+    void rehash(size_t new_capacity);
+    void destroyAll();
+};
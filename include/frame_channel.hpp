@@ -0,0 +1,72 @@
+#pragma once
+#include "binary_protocol.hpp"
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+
+// One binary-protocol connection to a server, shared by any number of
+// threads. call() queues the request and returns at once; the channel's own
+// epoll loop connects, writes and reads without blocking and matches
+// responses to requests by ID, so many requests are in flight on the same
+// socket and no caller ever waits on the network. A failed or silent
+// connection (no reply within timeout_s while requests are pending) fails
+// everything in flight with Unavailable. The next call after a failure
+// reconnects, but only once a backoff has passed that doubles with each
+// failure in a row; calls before then fail at once, so a down node costs its
+// callers nothing. Linux only.
+class FrameChannel {
+public:
+    // Runs on the loop thread (or inline in call() while the channel is
+    // backing off); must not block. `payload` is only valid during the call.
+    using Callback = std::function<void(BinStatus status, std::string_view payload)>;
+
+    FrameChannel(std::string ip, int port, int timeout_s = 5);
+    ~FrameChannel();
+    FrameChannel(const FrameChannel&) = delete;
+    FrameChannel& operator=(const FrameChannel&) = delete;
+
+    void call(BinOp op, std::string_view payload, Callback done);
+
+private:
+    using Clock = std::chrono::steady_clock;
+    enum class State { Down, Connecting, Connected };
+
+    void run();
+    void connect();
+    void onConnected();
+    void onReadable();
+    void flush();
+    void drop();
+    void wake();
+
+    std::string ip_;
+    int port_;
+    int timeout_s_;
+    int epoll_fd_ = -1;
+    int wake_fd_ = -1;  // eventfd: requests queued by another thread
+
+    // Loop thread only
+    int fd_ = -1;
+    std::string in_;
+    std::string wbuf_;  // Being written; wbuf_[wpos_..] is still unsent
+    size_t wpos_ = 0;
+    Clock::time_point connect_deadline_;
+
+    // Shared with call(); state_ only changes on the loop thread
+    std::mutex mu_;
+    State state_ = State::Down;
+    std::string out_;  // Requests not yet picked up by the loop
+    std::unordered_map<uint32_t, Callback> pending_;
+    uint32_t next_id_ = 0;
+    Clock::time_point last_progress_;  // Last reply, or when pending_ filled up
+    Clock::time_point retry_at_;       // While Down, calls fail until then
+    std::chrono::milliseconds backoff_{0};
+    bool stop_ = false;
+
+    std::thread loop_;  // Last: starts once everything above is built
+};
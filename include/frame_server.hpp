@@ -0,0 +1,78 @@
+#pragma once
+#include "binary_protocol.hpp"
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// TCP listener for the binary protocol (binary_protocol.hpp), or for any
+// other request/response protocol given a splitter (RESP): a small fixed set
+// of I/O threads, each running an edge-triggered epoll loop over its own
+// SO_REUSEPORT listening socket and the connections it accepted. Linux only.
+//
+// Each complete request is handed to the handler on the I/O thread that read
+// it, in arrival order. The handler answers through a Reply, either before
+// returning or later from any thread; replies that become ready together
+// leave in one write.
+class FrameServer {
+    struct Connection;
+    struct Loop;
+
+public:
+    // Answers one request. Cheap to copy; exactly one send must be called.
+    class Reply {
+    public:
+        // Binary protocol: a response frame echoing the request's ID.
+        void send(BinStatus status, std::string_view payload = {}) const;
+        // Other protocols: bytes already in the wire format.
+        void sendRaw(std::string_view bytes) const;
+
+    private:
+        friend class FrameServer;
+        Reply(std::shared_ptr<Connection> conn, uint64_t seq) : conn_(std::move(conn)), seq_(seq) {}
+        template <typename Append>
+        void deliver(Append&& append) const;
+
+        std::shared_ptr<Connection> conn_;
+        uint64_t seq_;     // Request's position on its connection
+        uint32_t id_ = 0;  // Binary protocol request ID
+    };
+
+    // frame.payload is only valid during the call; copy what outlives it.
+    using Handler = std::function<void(const Frame& frame, Reply reply)>;
+
+    // Finds the size of the request at data[0..len) of another protocol.
+    using Splitter = std::function<FrameDecode(const char* data, size_t len, size_t& consumed)>;
+    using RawHandler = std::function<void(std::string_view request, Reply reply)>;
+
+    // Binary protocol; replies leave as soon as they are sent.
+    FrameServer(Handler handler, size_t io_threads);
+    // Other protocols; replies leave in request order, as their pipelining
+    // clients expect. `name` tags log lines.
+    FrameServer(Splitter split, RawHandler handler, size_t io_threads, std::string name);
+    ~FrameServer();
+    FrameServer(const FrameServer&) = delete;
+    FrameServer& operator=(const FrameServer&) = delete;
+
+    // Binds every loop's socket to `port` and starts the I/O threads.
+    bool start(int port);
+    void stop();
+
+private:
+    void run(Loop& loop);
+    void accept(Loop& loop);
+    void onReadable(Loop& loop, const std::shared_ptr<Connection>& conn);
+    void flush(Loop& loop, const std::shared_ptr<Connection>& conn);
+    void close(Loop& loop, const std::shared_ptr<Connection>& conn);
+
+    Splitter split_;
+    RawHandler handler_;
+    bool ordered_;
+    std::string name_;
+    std::vector<std::unique_ptr<Loop>> loops_;
+    std::atomic<bool> stop_{false};
+};
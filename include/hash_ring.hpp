@@ -1,6 +1,7 @@
 #pragma once
+#include <cstdint>
 #include <string>
-#include <map>
+#include <string_view>
 #include <vector>
 
 struct MigrationTask {
@@ -9,16 +10,91 @@ struct MigrationTask {
     size_t end_hash;         // Range End (inclusive)
 };
 
-class ConsistentHashRing {
+// An arc (start, end] of the ring, wrapping past zero when start > end.
+// start == end is empty.
+struct HashRange {
+    size_t start;
+    size_t end;
+
+    bool contains(size_t h) const {
+        if (start == end) return false;
+        if (start < end) return h > start && h <= end;
+        return h > start || h <= end;
+    }
+};
+
+// A union of ring ranges as sorted, disjoint, inclusive hash intervals
+// (adjacent and overlapping ranges merged, wrapped ones split at zero), so
+// testing a hash against any number of ranges is one binary search.
+class HashRangeSet {
+public:
+    struct Interval {
+        size_t lo;
+        size_t hi;
+    };
+
+    HashRangeSet() = default;
+    explicit HashRangeSet(const std::vector<HashRange>& ranges);
+
+    bool contains(size_t h) const;
+    bool empty() const { return intervals_.empty(); }
+    const std::vector<Interval>& intervals() const { return intervals_; }
+
 private:
-    std::map<size_t, std::string> ring;
-    int virtual_nodes;
-    size_t hash_key(const std::string& key);
+    std::vector<Interval> intervals_;
+};
+
+// Everything one source node hands to a new node, with ranges that touch
+// merged into one.
+struct SourcePlan {
+    std::string source_node;
+    std::vector<HashRange> ranges;
+};
 
+// Groups tasks by source node and merges each source's adjacent ranges.
+std::vector<SourcePlan> coalesce_tasks(const std::vector<MigrationTask>& tasks);
+
+// Not synchronized: the proxy shares it between threads through RcuPtr
+// (rcu_ptr.hpp), mutating private copies and publishing them whole.
+//
+// Layout: vnode hashes live in one sorted array with a parallel array of
+// small node IDs, and each address is stored once in a node table. A bucket
+// index over the top bits of the hash narrows a lookup to about one entry,
+// so getNode is O(1) and never allocates.
+class ConsistentHashRing {
 public:
+    using NodeId = uint32_t;
+    static constexpr NodeId kNoNode = UINT32_MAX;
+
     ConsistentHashRing(int v_nodes = 200);
     void addNode(const std::string& node_address);
     void removeNode(const std::string& node_address);
-    std::string getNode(const std::string& key);
-    std::vector<MigrationTask> getRebalancingTasks(const std::string& new_node);
-};
\ No newline at end of file
+
+    // Owner of `key`, or an empty string if the ring is empty. The reference
+    // stays valid until the ring is modified.
+    const std::string& getNode(std::string_view key) const;
+    NodeId getNodeId(std::string_view key) const;
+    const std::string& nodeAddress(NodeId id) const { return nodes_[id]; }
+    size_t nodeCount() const { return nodes_.size(); }
+
+    std::vector<MigrationTask> getRebalancingTasks(const std::string& new_node) const;
+    // The same tasks coalesced: one entry per source node.
+    std::vector<SourcePlan> getRebalancingPlan(const std::string& new_node) const {
+        return coalesce_tasks(getRebalancingTasks(new_node));
+    }
+
+    // FNV-1a + murmur3 finalizer; must match the storage servers.
+    static size_t hash_key(std::string_view key);
+
+private:
+    size_t lowerBound(size_t hash) const;  // First vnode >= hash, or size() when past the end
+    NodeId findNode(const std::string& node_address) const;
+    void rebuildIndex();
+
+    int virtual_nodes;
+    std::vector<std::string> nodes_;  // NodeId -> address
+    std::vector<size_t> hashes_;      // Sorted vnode hashes
+    std::vector<NodeId> owners_;      // owners_[i] owns hashes_[i]
+    std::vector<uint32_t> buckets_;   // buckets_[b] = first vnode whose top bits are >= b
+    int bucket_shift_ = 64;
+};
@@ -0,0 +1,125 @@
+#pragma once
+#include <atomic>
+#include <charconv>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+enum class LogLevel : uint8_t { Debug = 0, Info = 1, Warn = 2, Error = 3, Off = 4 };
+
+bool parse_log_level(const std::string& name, LogLevel& out);
+const char* log_level_name(LogLevel level);
+
+// Process-wide asynchronous logger. A caller formats its line on the stack
+// and copies it into a slot of a bounded lock-free ring; one background
+// thread drains the ring and writes everything it finds with a single
+// fwrite + fflush (Warn and above go to stderr). A full ring drops the line
+// and counts it instead of blocking the caller.
+//
+// Use the LOG_* macros below: the message is not even formatted when its
+// level is disabled. Per-key lines use LOG_SAMPLED, which also applies the
+// 1-in-N sample rate.
+class Logger {
+public:
+    static constexpr size_t kLineBytes = 240;  // Longer lines are truncated
+    static constexpr size_t kSlots = 8192;
+
+    static Logger& instance();
+
+    bool enabled(LogLevel level) const { return level >= level_.load(std::memory_order_relaxed); }
+    void setLevel(LogLevel level) { level_.store(level, std::memory_order_relaxed); }
+    LogLevel level() const { return level_.load(std::memory_order_relaxed); }
+
+    // Keep 1 in `n` sampled lines; 1 keeps all of them.
+    void setSampleRate(uint32_t n) { sample_rate_.store(n > 0 ? n : 1, std::memory_order_relaxed); }
+    uint32_t sampleRate() const { return sample_rate_.load(std::memory_order_relaxed); }
+    bool sampled() const;
+
+    void write(LogLevel level, const char* line, size_t len);
+
+    // Blocks until every line written so far is out.
+    void flush();
+    uint64_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+private:
+    struct Slot {
+        std::atomic<size_t> seq;
+        LogLevel level;
+        uint16_t len;
+        char text[kLineBytes];
+    };
+
+    Logger();
+    void run();
+    size_t drain(std::string& out, std::string& err);
+
+    std::unique_ptr<Slot[]> slots_;
+    alignas(64) std::atomic<size_t> enqueue_pos_{0};
+    alignas(64) size_t dequeue_pos_ = 0;  // Flusher thread only
+
+    std::atomic<LogLevel> level_{LogLevel::Info};
+    std::atomic<uint32_t> sample_rate_{1};
+    mutable std::atomic<uint64_t> sample_counter_{0};
+    std::atomic<uint64_t> dropped_{0};
+
+    std::mutex mu_;
+    std::condition_variable wake_cv_;
+    std::condition_variable flushed_cv_;
+    std::atomic<bool> sleeping_{false};
+    uint64_t flushed_epoch_ = 0;
+};
+
+// One log line, built in place and handed to the logger when destroyed.
+class LogLine {
+public:
+    explicit LogLine(LogLevel level) : level_(level) {}
+    ~LogLine() { Logger::instance().write(level_, buf_, len_); }
+    LogLine(const LogLine&) = delete;
+    LogLine& operator=(const LogLine&) = delete;
+
+    LogLine& operator<<(std::string_view s) {
+        size_t n = s.size() < Logger::kLineBytes - len_ ? s.size() : Logger::kLineBytes - len_;
+        s.copy(buf_ + len_, n);
+        len_ += n;
+        return *this;
+    }
+    LogLine& operator<<(const char* s) { return *this << std::string_view(s); }
+    LogLine& operator<<(const std::string& s) { return *this << std::string_view(s); }
+    LogLine& operator<<(char c) { return *this << std::string_view(&c, 1); }
+
+    template <typename T, typename = std::enable_if_t<std::is_integral<T>::value>>
+    LogLine& operator<<(T v) {
+        char tmp[24] = {};
+        auto res = std::to_chars(tmp, tmp + sizeof(tmp), v);
+        return *this << std::string_view(tmp, res.ptr - tmp);
+    }
+    LogLine& operator<<(double v) {
+        char tmp[32];
+        int n = std::snprintf(tmp, sizeof(tmp), "%.3f", v);
+        return *this << std::string_view(tmp, n > 0 ? n : 0);
+    }
+    LogLine& operator<<(bool v) { return *this << (v ? "true" : "false"); }
+    template <typename T>
+    LogLine& operator<<(const std::atomic<T>& v) { return *this << v.load(std::memory_order_relaxed); }
+
+private:
+    LogLevel level_;
+    size_t len_ = 0;
+    char buf_[Logger::kLineBytes];
+};
+
+// `for` rather than `if` so the macros are safe inside an unbraced if/else.
+#define KV_LOG_IF(level, cond) \
+    for (bool kv_log_on_ = Logger::instance().enabled(level) && (cond); kv_log_on_; kv_log_on_ = false) LogLine(level)
+
+#define LOG_DEBUG KV_LOG_IF(LogLevel::Debug, true)
+#define LOG_INFO KV_LOG_IF(LogLevel::Info, true)
+#define LOG_WARN KV_LOG_IF(LogLevel::Warn, true)
+#define LOG_ERROR KV_LOG_IF(LogLevel::Error, true)
+#define LOG_SAMPLED(level) KV_LOG_IF(level, Logger::instance().sampled())
@@ -0,0 +1,167 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Prometheus metrics (text exposition format, served on /metrics).
+//
+// Recording must stay cheap on request threads, so every counter and
+// histogram is split into cache-line-aligned stripes and each thread adds to
+// its own stripe; a scrape sums the stripes. Metrics are registered once at
+// startup and live for the whole process, so hot paths keep plain references.
+
+constexpr size_t kMetricStripes = 16;
+
+// This thread's stripe; threads are spread round-robin.
+inline size_t metric_stripe() {
+    static std::atomic<size_t> next{0};
+    thread_local size_t stripe = next.fetch_add(1, std::memory_order_relaxed) % kMetricStripes;
+    return stripe;
+}
+
+inline uint64_t nanos_since(std::chrono::steady_clock::time_point start) {
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+}
+
+class Counter {
+public:
+    void inc(uint64_t n = 1) { cells_[metric_stripe()].value.fetch_add(n, std::memory_order_relaxed); }
+    uint64_t value() const;
+
+private:
+    struct alignas(64) Cell {
+        std::atomic<uint64_t> value{0};
+    };
+    Cell cells_[kMetricStripes];
+};
+
+// HDR-style log-linear histogram of non-negative integers: each power of two
+// is split into 4 equal buckets, so any recorded value is known to within
+// 25% from 1 up to 2^40 (18 minutes in nanoseconds). Larger values land in
+// the last bucket.
+class Histogram {
+public:
+    static constexpr size_t kSubBuckets = 4;
+    static constexpr size_t kMaxExponent = 40;
+    static constexpr size_t kBuckets = kSubBuckets * kMaxExponent;
+
+    Histogram() : stripes_(new Stripe[kMetricStripes]) {}
+
+    void record(uint64_t value) {
+        Stripe& stripe = stripes_[metric_stripe()];
+        stripe.counts[bucketOf(value)].fetch_add(1, std::memory_order_relaxed);
+        stripe.sum.fetch_add(value, std::memory_order_relaxed);
+    }
+    void recordSince(std::chrono::steady_clock::time_point start) { record(nanos_since(start)); }
+
+    static size_t bucketOf(uint64_t value);
+    // Largest value that falls into `bucket`.
+    static uint64_t bucketMax(size_t bucket);
+
+    struct Snapshot {
+        std::vector<uint64_t> counts;  // Per bucket, not cumulative
+        uint64_t count = 0;
+        uint64_t sum = 0;
+    };
+    Snapshot snapshot() const;
+
+    // Upper bound of the bucket holding the q-th quantile of per-bucket
+    // `counts` (a snapshot, or the difference of two); 0 if they are empty.
+    static uint64_t quantile(const std::vector<uint64_t>& counts, double q);
+
+private:
+    struct alignas(64) Stripe {
+        std::atomic<uint64_t> counts[kBuckets] = {};
+        std::atomic<uint64_t> sum{0};
+    };
+    std::unique_ptr<Stripe[]> stripes_;
+};
+
+// Histograms of durations record nanoseconds and are exported in seconds.
+constexpr double kNanosToSeconds = 1e-9;
+
+// `name="value"`, escaped for the exposition format.
+std::string metric_label(std::string_view name, std::string_view value);
+
+// For collectors that compute gauges at scrape time.
+void metric_header(std::string& out, std::string_view name, std::string_view help, std::string_view type);
+void metric_sample(std::string& out, std::string_view name, std::string_view labels, double value);
+
+class Metrics {
+public:
+    static Metrics& instance();
+
+    // Get-or-create; the returned reference stays valid for the process
+    // lifetime. `labels` is a comma-separated list of metric_label()s.
+    Counter& counter(const std::string& name, const std::string& help, const std::string& labels = "");
+    // `scale` converts recorded values to exported ones (kNanosToSeconds).
+    Histogram& histogram(const std::string& name, const std::string& help, const std::string& labels = "",
+                         double scale = 1);
+
+    // Every series of a histogram family, e.g. to watch latency from inside
+    // the process.
+    std::vector<Histogram*> histograms(const std::string& name);
+
+    // Runs on every scrape and appends its own metrics (gauges).
+    void addCollector(std::function<void(std::string& out)> collect);
+
+    std::string render();
+
+private:
+    Metrics() = default;
+
+    struct Series {
+        std::string labels;
+        std::unique_ptr<Counter> counter;
+        std::unique_ptr<Histogram> histogram;
+    };
+    struct Family {
+        std::string help;
+        bool histogram = false;
+        double scale = 1;
+        std::vector<Series> series;
+    };
+
+    Family& family(const std::string& name, const std::string& help, bool histogram, double scale);
+
+    std::mutex mu_;
+    std::map<std::string, Family> families_;
+    std::vector<std::function<void(std::string&)>> collectors_;
+};
+
+// --- REQUEST METRICS ---
+enum class Outcome : uint8_t { Ok = 0, ClientError = 1, ServerError = 2 };
+
+inline Outcome http_outcome(int status) {
+    return status < 400 ? Outcome::Ok : status < 500 ? Outcome::ClientError : Outcome::ServerError;
+}
+
+// Request counts by outcome and a latency histogram for each of a fixed set
+// of endpoints (HTTP paths, binary ops), exported as
+// <prefix>_requests_total and <prefix>_request_duration_seconds labelled
+// <label>="endpoint". Anything outside the set is recorded as "other".
+class EndpointMetrics {
+public:
+    EndpointMetrics(const std::string& prefix, const std::string& label, const std::vector<std::string>& endpoints);
+
+    void record(std::string_view endpoint, Outcome outcome, uint64_t nanos);
+
+private:
+    struct Endpoint {
+        Counter* requests[3];
+        Histogram* latency;
+    };
+    Endpoint make(const std::string& prefix, const std::string& label, const std::string& endpoint);
+
+    std::map<std::string, Endpoint, std::less<>> endpoints_;  // Read-only once built
+    Endpoint other_;
+};
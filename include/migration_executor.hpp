@@ -0,0 +1,79 @@
+#pragma once
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+// Token bucket: `rate` tokens per second, holding at most `burst`. A take
+// larger than what is available goes into debt and waits it off, so big
+// batches are paced rather than refused. A rate of 0 means unlimited.
+class TokenBucket {
+public:
+    TokenBucket(double rate, double burst);
+
+    // Takes `n` tokens; returns how long the caller must wait before using them.
+    std::chrono::nanoseconds take(double n);
+    void setRate(double rate);
+    double rate() const;
+
+private:
+    void refill(std::chrono::steady_clock::time_point now);
+
+    mutable std::mutex mu_;
+    double rate_;
+    double burst_;
+    double tokens_;
+    std::chrono::steady_clock::time_point last_;
+};
+
+// Runs migration transfers for the proxy: up to `concurrency` at a time
+// (across every rebalance in progress), paced by key and byte token buckets.
+// The pace adapts AIMD-style to foreground latency: every control interval
+// the probe reports the backends' recent p99, and a p99 over target halves
+// the rate, while one under target gives back a tenth of the maximum.
+class MigrationExecutor {
+public:
+    struct Options {
+        size_t concurrency = 4;          // Transfers running at once
+        double max_bytes_per_s = 64e6;   // 0 = unlimited
+        double max_keys_per_s = 0;       // 0 = unlimited
+        double target_p99_s = 0.05;      // 0 = never slow down
+        double min_fraction = 0.02;      // Floor for the adaptive rate
+        std::chrono::milliseconds control_interval{250};
+    };
+
+    // Backend p99 in seconds since the previous call, or a negative value
+    // when there were too few requests to judge.
+    using LatencyProbe = std::function<double()>;
+
+    MigrationExecutor(Options options, LatencyProbe probe);
+
+    // Runs every job and returns once all have finished. Jobs run on their
+    // own threads, each after taking one of the shared concurrency slots.
+    void run(const std::vector<std::function<void()>>& jobs);
+
+    // Blocks the calling transfer until it may send `keys` keys of `bytes`.
+    void throttle(size_t keys, size_t bytes);
+
+    // Current pace as a fraction of the configured maximum (1 = full speed).
+    double rateFraction() const;
+    size_t activeTransfers() const;
+    const Options& options() const { return options_; }
+
+private:
+    void adapt();
+
+    Options options_;
+    LatencyProbe probe_;
+    TokenBucket bytes_;
+    TokenBucket keys_;
+
+    mutable std::mutex mu_;
+    std::condition_variable slot_cv_;
+    size_t active_ = 0;
+    double fraction_ = 1;
+    std::chrono::steady_clock::time_point next_control_;
+};
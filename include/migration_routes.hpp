@@ -0,0 +1,49 @@
+#pragma once
+#include "hash_ring.hpp"
+#include <atomic>
+#include <memory>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Ranges whose keys are being copied from `from` to `to`. The ring already
+// sends their traffic to `to`, which may not have a key yet, so a read that
+// misses there falls back to `from`. A SET goes to `to` only; the copy loads
+// if-absent and cannot overwrite it. A DEL goes to `from` first and then to
+// `to`, so a deleted key is found on neither. Once `from` has dropped the key
+// the copy can no longer read it, and a batch read earlier is filtered by
+// the tombstone `to` keeps under the move's lease.
+class MigrationRoute {
+public:
+    MigrationRoute(std::string from, std::string to, const std::vector<HashRange>& ranges)
+        : from_(std::move(from)), to_(std::move(to)), ranges_(ranges) {}
+
+    const std::string& from() const { return from_; }
+    const std::string& to() const { return to_; }
+    bool covers(size_t hash) const { return ranges_.contains(hash); }
+
+private:
+    std::string from_;
+    std::string to_;
+    HashRangeSet ranges_;
+};
+
+// The routes of every move not yet finished, including those of stopped
+// jobs, whose keys are still split between both nodes. Costs one atomic
+// load per request when nothing is moving.
+class MigrationRoutes {
+public:
+    std::shared_ptr<MigrationRoute> add(const std::string& from, const std::string& to,
+                                        const std::vector<HashRange>& ranges);
+    void remove(const std::shared_ptr<MigrationRoute>& route);
+
+    // The route covering `key`, or null.
+    std::shared_ptr<MigrationRoute> find(std::string_view key) const;
+    bool empty() const { return count_.load(std::memory_order_acquire) == 0; }
+
+private:
+    mutable std::shared_mutex mu_;
+    std::vector<std::shared_ptr<MigrationRoute>> routes_;
+    std::atomic<size_t> count_{0};
+};
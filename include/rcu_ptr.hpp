@@ -0,0 +1,103 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+// Read-copy-update pointer with epoch-based reclamation.
+//
+// Readers pin the current object with read(): one CAS on a reader slot and an
+// atomic load, no lock. Writers copy the object, modify the copy and publish
+// it with a single pointer swap, then wait until every reader that might
+// still see the old object has finished before deleting it. Writes are
+// serialized among themselves; reads never wait for them.
+template <typename T>
+class RcuPtr {
+    static constexpr size_t kSlots = 128;
+
+    struct alignas(64) Slot {
+        std::atomic<uint64_t> epoch{0};  // 0 = free, else the epoch the reader entered in
+    };
+
+public:
+    // Keeps the object it was created from alive until destroyed.
+    class ReadGuard {
+    public:
+        ReadGuard(ReadGuard&& other) noexcept : slot_(other.slot_), ptr_(other.ptr_) { other.slot_ = nullptr; }
+        ReadGuard(const ReadGuard&) = delete;
+        ReadGuard& operator=(const ReadGuard&) = delete;
+        ~ReadGuard() {
+            if (slot_) slot_->epoch.store(0, std::memory_order_release);
+        }
+
+        const T* get() const { return ptr_; }
+        const T* operator->() const { return ptr_; }
+        const T& operator*() const { return *ptr_; }
+
+    private:
+        friend class RcuPtr;
+        ReadGuard(Slot* slot, const T* ptr) : slot_(slot), ptr_(ptr) {}
+
+        Slot* slot_;
+        const T* ptr_;
+    };
+
+    explicit RcuPtr(std::unique_ptr<T> initial = std::unique_ptr<T>(new T())) : current_(initial.release()) {}
+    RcuPtr(const RcuPtr&) = delete;
+    RcuPtr& operator=(const RcuPtr&) = delete;
+    ~RcuPtr() { delete current_.load(); }
+
+    ReadGuard read() const {
+        // Each thread starts probing at its own slot, so uncontended readers
+        // never share a cache line.
+        static thread_local size_t hint = std::hash<std::thread::id>()(std::this_thread::get_id());
+        for (size_t i = hint;; ++i) {
+            Slot& slot = slots_[i % kSlots];
+            uint64_t expected = 0;
+            // Entering with a stale epoch is safe: it only delays reclamation.
+            if (slot.epoch.compare_exchange_strong(expected, epoch_.load())) {
+                hint = i;
+                return ReadGuard(&slot, current_.load());
+            }
+        }
+    }
+
+    // Publishes `next` and deletes the previous object once no reader can
+    // still hold it.
+    void store(std::unique_ptr<T> next) {
+        std::lock_guard<std::mutex> lock(write_mutex_);
+        retire(current_.exchange(next.release()));
+    }
+
+    // Copies the current object, applies `mutate` to the copy and publishes
+    // it. Concurrent updates are applied one after another, so none is lost.
+    template <typename Fn>
+    void update(Fn mutate) {
+        std::lock_guard<std::mutex> lock(write_mutex_);
+        std::unique_ptr<T> next(new T(*current_.load()));
+        mutate(*next);
+        retire(current_.exchange(next.release()));
+    }
+
+private:
+    // Waits for every reader that entered before the swap, then deletes.
+    void retire(T* old) {
+        uint64_t retire_epoch = epoch_.fetch_add(1) + 1;
+        for (Slot& slot : slots_) {
+            for (;;) {
+                uint64_t e = slot.epoch.load();
+                if (e == 0 || e >= retire_epoch) break;
+                std::this_thread::yield();
+            }
+        }
+        delete old;
+    }
+
+    std::atomic<T*> current_;
+    std::atomic<uint64_t> epoch_{1};
+    mutable Slot slots_[kSlots];
+    std::mutex write_mutex_;
+};
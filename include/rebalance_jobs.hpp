@@ -0,0 +1,104 @@
+#pragma once
+#include "hash_ring.hpp"
+#include "migration_routes.hpp"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// One node's worth of ranges moving between two nodes. `cursor` is where the
+// export from `from` may resume: every key before it has been loaded into `to`.
+// `route` routes the ranges' traffic until every key has landed (`copied`);
+// the move is done once the ranges are also dropped from `from`.
+struct RangeMove {
+    std::string from;
+    std::string to;
+    std::vector<HashRange> ranges;
+    std::string cursor;
+    bool done = false;
+    std::shared_ptr<MigrationRoute> route;
+    bool copied = false;
+};
+
+// A node add or remove, run in the background. The runner owns `moves` and
+// `planned` while the job runs; progress counters can be read at any time.
+struct RebalanceJob {
+    enum class State { Queued, Running, Cancelled, Done, Failed };
+
+    uint64_t id = 0;
+    std::string op;    // "add" | "remove"
+    std::string node;
+
+    std::atomic<size_t> ranges_total{0};
+    std::atomic<size_t> ranges_done{0};
+    std::atomic<size_t> keys_moved{0};
+    std::atomic<size_t> bytes_moved{0};
+    std::atomic<size_t> keys_estimate{0};  // From the nodes' key counts; for the ETA
+    std::atomic<bool> cancel{false};
+
+    // Resume state: the ring has been updated and `moves` planned
+    bool planned = false;
+    std::vector<RangeMove> moves;
+};
+
+// Runs rebalance jobs one at a time, in submission order, on a thread of its
+// own, so admin calls return at once and no HTTP worker waits on a migration.
+// A cancelled or failed job keeps its plan, cursors and routes and can be
+// resumed, picking up each move where it stopped. Its ring change stays, so
+// its uncopied keys are only reachable through its routes. Before a new job
+// plans against the ring, it runs every stopped job's remaining moves to the
+// end; if one of them stops again, the new job fails without touching the
+// ring, and can be resumed once the stopped job has finished.
+class RebalanceJobs {
+public:
+    // Runs or resumes `job`; returns true once every move has finished.
+    using Runner = std::function<bool(RebalanceJob& job)>;
+
+    enum class Result { Ok, NotFound, Conflict };
+
+    explicit RebalanceJobs(Runner runner);
+    ~RebalanceJobs();
+
+    std::shared_ptr<RebalanceJob> submit(const std::string& op, const std::string& node);
+    // Stops a queued job at once, or asks a running one to stop after its
+    // current batch (and so the stopped job it is finishing, if any).
+    Result cancel(uint64_t id);
+    Result resume(uint64_t id);
+
+    // "key value" lines: state, progress, elapsed time and ETA.
+    bool describe(uint64_t id, std::string& out) const;
+    // One line per job.
+    std::string list() const;
+
+private:
+    struct Entry {
+        std::shared_ptr<RebalanceJob> job;
+        RebalanceJob::State state = RebalanceJob::State::Queued;
+        uint64_t finishing = 0;  // Stopped job this one is running first, if any
+        std::chrono::nanoseconds active{0};  // Running time over all runs
+        std::chrono::steady_clock::time_point run_start;
+    };
+
+    void work();
+    void runLocked(std::unique_lock<std::mutex>& lock, Entry& e);
+    bool finishStoppedLocked(std::unique_lock<std::mutex>& lock, Entry& e);
+    std::string describeLocked(const Entry& e) const;
+    static bool resumable(const Entry& e);
+
+    Runner runner_;
+    mutable std::mutex mu_;
+    std::condition_variable cv_;
+    std::map<uint64_t, Entry> jobs_;
+    std::deque<uint64_t> queue_;
+    uint64_t next_id_ = 1;
+    bool stop_ = false;
+    std::thread worker_;  // Last: starts once everything above is built
+};
@@ -0,0 +1,30 @@
+#pragma once
+#include "binary_protocol.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// RESP2, the Redis wire protocol, for the proxy's Redis-compatible listener.
+// A command is either an array of bulk strings
+//
+//   *2\r\n$3\r\nGET\r\n$3\r\nkey\r\n
+//
+// or an inline line of space-separated words ("GET key\r\n", as typed into
+// telnet). Replies are built with the resp_* helpers below.
+
+// Finds the size of the command at data[0..len). Malformed or oversized
+// input is TooLarge: the stream cannot be resynchronised after it.
+FrameDecode frame_resp_command(const char* data, size_t len, size_t& consumed);
+
+// Splits a command framed by frame_resp_command into its arguments, which
+// point into `command`.
+void parse_resp_command(std::string_view command, std::vector<std::string_view>& args);
+
+void resp_simple(std::string& out, std::string_view s);   // +OK
+void resp_error(std::string& out, std::string_view msg);  // -ERR ...
+void resp_integer(std::string& out, int64_t v);           // :1
+void resp_bulk(std::string& out, std::string_view s);     // $3\r\nval
+void resp_null(std::string& out);                         // $-1 (missing key)
+void resp_array(std::string& out, size_t count);          // *N, then N elements
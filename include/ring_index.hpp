@@ -0,0 +1,95 @@
+#pragma once
+#include "flat_map.hpp"
+#include "hash_ring.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <set>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// Keys of one shard ordered by their ring hash, so a ring range is found
+// in O(log n + k) instead of rehashing every key. The hash is computed once,
+// when a key is first inserted.
+class RingIndex {
+public:
+    // Both are no-ops if the entry is already present / absent.
+    void insert(size_t ring_hash, std::string_view key);
+    void erase(size_t ring_hash, std::string_view key);
+    void clear();
+
+    size_t size() const { return entries_.size(); }
+
+    // Approximate heap footprint: one tree node per key plus spilled keys.
+    size_t memoryUsage() const;
+
+    // A position in index order; scans resume after it.
+    struct Cursor {
+        size_t hash = 0;
+        std::string key;
+    };
+
+    // Visits keys in hash order, calling fn(hash, key) for each key in
+    // `ranges` (the whole ring if null) that comes after `after` (from the
+    // beginning if null). Each interval of the set is found with one seek, so
+    // many ranges cost one pass. Stops early after `limit` keys or when fn
+    // returns false. Returns true once the ranges are exhausted.
+    template <typename Fn>
+    bool scan(const HashRangeSet* ranges, const Cursor* after, size_t limit, Fn&& fn) const {
+        static const std::vector<HashRangeSet::Interval> kWholeRing{{0, SIZE_MAX}};
+        const auto& intervals = ranges ? ranges->intervals() : kWholeRing;
+        for (const HashRangeSet::Interval& iv : intervals) {
+            if (after && after->hash > iv.hi) continue;
+            auto it = (after && after->hash >= iv.lo) ? entries_.upper_bound(Probe{after->hash, after->key})
+                                                      : entries_.lower_bound(Probe{iv.lo});
+            for (; it != entries_.end() && it->hash <= iv.hi; ++it) {
+                if (limit == 0) return false;
+                --limit;
+                if (!fn(it->hash, it->key.view())) return false;
+            }
+        }
+        return true;
+    }
+
+    // Calls fn(key) for every key whose hash lies in `ranges`.
+    template <typename Fn>
+    void forEachInRanges(const HashRangeSet& ranges, Fn&& fn) const {
+        scan(&ranges, nullptr, SIZE_MAX, [&](size_t, std::string_view key) {
+            fn(key);
+            return true;
+        });
+    }
+
+private:
+    struct Entry {
+        Entry(size_t h, std::string_view k) : hash(h), key(k) {}
+        size_t hash;
+        InlineKey key;
+    };
+
+    // Lookup key without building an Entry; an empty key sorts first among
+    // its hash.
+    struct Probe {
+        size_t hash;
+        std::string_view key = {};
+    };
+
+    struct Less {
+        using is_transparent = void;
+        bool operator()(const Entry& a, const Entry& b) const {
+            return a.hash != b.hash ? a.hash < b.hash : a.key.view() < b.key.view();
+        }
+        bool operator()(const Entry& a, const Probe& b) const {
+            if (a.hash != b.hash) return a.hash < b.hash;
+            return a.key.view() < b.key;
+        }
+        bool operator()(const Probe& a, const Entry& b) const {
+            if (a.hash != b.hash) return a.hash < b.hash;
+            return a.key < b.key.view();
+        }
+    };
+
+    std::set<Entry, Less> entries_;
+    size_t spilled_bytes_ = 0;  // Heap bytes of keys too long to store inline
+};
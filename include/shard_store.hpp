@@ -0,0 +1,114 @@
+#pragma once
+#include "flat_map.hpp"
+#include "hash_ring.hpp"
+#include "rcu_ptr.hpp"
+#include "ring_index.hpp"
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+constexpr size_t kCacheLineSize = 64;
+
+// Everything one shard touches lives in one cache-line-aligned block, so
+// threads working on neighboring shards never false-share a line.
+struct alignas(kCacheLineSize) Shard {
+    mutable std::shared_mutex mutex;  // Readers share, writers exclusive
+    FlatStringMap map;
+    RingIndex ring_index;             // map's keys ordered by ring hash
+    std::atomic<uint64_t> reads{0};
+    std::atomic<uint64_t> writes{0};
+
+    // Keys deleted under a live tombstone lease, whether they existed or
+    // not (values empty); see ShardStore::openTombstoneLease.
+    FlatStringMap tombstones;
+
+    // Writes go through these so map and ring_index stay in step.
+    // The caller holds `mutex` exclusively.
+    void put(std::string_view key, std::string value);
+    bool erase(std::string_view key);  // True if the key existed
+    void clear();
+    bool tombstoned(std::string_view key) const { return !tombstones.empty() && tombstones.contains(key); }
+};
+
+class ShardStore {
+public:
+    // Shard counts are rounded up to a power of two.
+    explicit ShardStore(size_t shard_count = defaultShardCount());
+
+    // 4 shards per hardware thread, at least 16, at most 4096.
+    static size_t defaultShardCount();
+
+    size_t shardCount() const { return count_; }
+    size_t shardId(std::string_view key) const { return shardOfHash(keyHash(key)); }
+
+    // Split form of shardId, for callers that reuse the hash.
+    static size_t keyHash(std::string_view key);
+    size_t shardOfHash(size_t hash) const { return hash & mask_; }
+
+    Shard& shard(size_t id) { return shards_[id]; }
+    const Shard& shard(size_t id) const { return shards_[id]; }
+    Shard& shardFor(std::string_view key) { return shards_[shardId(key)]; }
+
+    // Total number of keys; takes each shard's shared lock in turn.
+    size_t size() const;
+
+    // Position of a key on the proxy's hash ring (not the shard hash).
+    static size_t ringHash(std::string_view key) { return ConsistentHashRing::hash_key(key); }
+
+    // Removes every key of `shard` whose ring hash falls in one of `ranges`,
+    // found through its ring index. The caller holds the shard's unique
+    // lock. Returns the number removed, and the keys in `erased` if given.
+    static size_t eraseRanges(Shard& shard, const std::vector<HashRange>& ranges,
+                              std::vector<std::string>* erased = nullptr);
+
+    // --- TOMBSTONE LEASES ---
+    // A migration copying `ranges` into this node opens a lease on them
+    // first. While it is live, keepTombstone remembers the keys deleted in
+    // those ranges, and an if-absent load skips them, so the copy cannot
+    // bring back a key deleted after it was read. A lease lives until it is
+    // closed or `ttl` passes without a renewal; its tombstones go with it
+    // unless another live lease covers them. Leases are not persisted: after
+    // a restart the copy's next load fails and the job has to be resumed.
+    // Returns the lease ID, never 0.
+    uint64_t openTombstoneLease(const std::vector<HashRange>& ranges, std::chrono::seconds ttl);
+    // Extends a live lease to its `ttl` from now; false if it is unknown or
+    // has expired.
+    bool renewTombstoneLease(uint64_t id);
+    bool closeTombstoneLease(uint64_t id);  // False if unknown or expired
+    size_t tombstoneLeases() const { return lease_count_.load(std::memory_order_acquire); }
+
+    // Called with `shard` locked exclusively after deleting `key` from it:
+    // keeps a tombstone if a live lease covers the key. One atomic load when
+    // no lease is open.
+    void keepTombstone(Shard& shard, std::string_view key) const;
+
+private:
+    struct TombstoneLease {
+        uint64_t id;
+        HashRangeSet ranges;
+        std::chrono::seconds ttl;
+        std::chrono::steady_clock::time_point until;
+    };
+    using TombstoneLeases = std::vector<TombstoneLease>;
+
+    // Removes the leases `done` picks (and any that expired), then drops
+    // the tombstones they alone covered. The caller holds lease_mutex_.
+    template <typename Fn>
+    size_t endLeasesLocked(Fn done);
+
+    size_t count_;
+    size_t mask_;
+    std::unique_ptr<Shard[]> shards_;
+
+    std::mutex lease_mutex_;  // Serializes lease changes
+    RcuPtr<TombstoneLeases> leases_;
+    std::atomic<size_t> lease_count_{0};
+    uint64_t next_lease_;
+};
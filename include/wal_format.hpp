@@ -0,0 +1,73 @@
+#pragma once
+#include "hash_ring.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Binary WAL layout (all integers little-endian):
+//
+//   file header : "KVWL" | u8 version | 3 reserved bytes
+//   record      : u32 crc32c | u8 op | varint key_len | varint val_len | key | val
+//
+// The checksum covers everything after itself, so a torn or bit-flipped
+// record is detected and replay stops cleanly in front of it.
+//
+// Key streams (/range_export, format=bin) reuse the record encoding too,
+// with a Cursor record after each batch that a client can pass back to
+// resume the stream.
+//
+// Snapshots use the same record encoding (Set records only) behind a
+// "KVSN" header instead of "KVWL".
+
+enum class WalOp : uint8_t {
+    Set = 1,
+    Del = 2,
+    Cursor = 3,  // Stream-only resume token (key); never written to a WAL
+};
+
+constexpr uint8_t kWalVersion = 1;
+constexpr size_t kWalHeaderSize = 8;
+
+struct WalRecord {
+    WalOp op;
+    std::string_view key;
+    std::string_view value;
+};
+
+enum class WalDecode {
+    Ok,
+    Incomplete,  // Ran out of bytes mid-record (torn tail)
+    Corrupt      // Bad checksum, bad varint or unknown op
+};
+
+std::string wal_file_header();
+bool has_wal_header(std::string_view data);
+std::string snapshot_file_header();
+bool has_snapshot_header(std::string_view data);
+
+void put_varint(std::string& out, uint64_t v);
+bool get_varint(const char*& p, const char* end, uint64_t& v);
+
+void encode_wal_record(std::string& out, WalOp op, std::string_view key, std::string_view value = {});
+
+// Decodes one record at data[0..len). On Ok, `consumed` is the record size
+// and `out` points into `data`. Replay skips the checksum on records it has
+// already verified.
+WalDecode decode_wal_record(const char* data, size_t len, WalRecord& out, size_t& consumed,
+                            bool verify_crc = true);
+
+// Hash ranges as u64 start | u64 end pairs: the body of /ranges_export and
+// /range_delete.
+std::string encode_hash_ranges(const std::vector<HashRange>& ranges);
+bool decode_hash_ranges(std::string_view payload, std::vector<HashRange>& out);
+
+// Finds the size of the record at data[0..len) from its length prefixes
+// alone, without touching the payload or checksum.
+WalDecode frame_wal_record(const char* data, size_t len, size_t& consumed);
+
+// Rewrites a legacy text WAL ("SET key val" / "DEL key" lines) in the binary
+// format. The original is kept as <path>.txt.bak. Returns the number of
+// records converted, or -1 on I/O failure.
+long convert_text_wal(const std::string& path);
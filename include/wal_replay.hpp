@@ -0,0 +1,25 @@
+#pragma once
+#include "shard_store.hpp"
+#include "wal_format.hpp"
+#include <cstddef>
+#include <cstdint>
+
+struct ReplayResult {
+    uint64_t records = 0;            // Records applied
+    size_t valid_bytes = 0;          // End of the last good record
+    WalDecode tail = WalDecode::Ok;  // Why replay stopped short of the end, if it did
+};
+
+// Parallel replay of an in-memory (typically mmap'd) WAL or snapshot.
+//
+//   1. Framing pass: walk the length prefixes once to cut the file into
+//      record-aligned chunks.
+//   2. Chunk workers verify checksums and bucket record offsets by
+//      destination shard, estimating distinct keys per shard as they go.
+//   3. Each shard's table is reserved up front, then shard workers apply
+//      their own records in log order; shards never share a worker.
+//      Range deletes are bucketed into every shard.
+//
+// Replay stops at the first torn or corrupt record, exactly like a
+// sequential scan would.
+ReplayResult replay_records(ShardStore& store, const char* data, size_t len, size_t begin, unsigned threads);
@@ -0,0 +1,114 @@
+#pragma once
+#include "metrics.hpp"
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+// When a WAL append counts as acknowledged.
+enum class Durability {
+    None,        // Queued in memory; the writer thread flushes it eventually
+    Interval,    // Written to the OS; fdatasync runs every interval_ms
+    Group,       // Written and fdatasync'd together with its batch
+    EveryWrite   // Written and fdatasync'd on its own
+};
+
+bool parse_durability(const std::string& name, Durability& out);
+const char* durability_name(Durability mode);
+
+// Group-commit WAL writer. Request threads append records into a shared
+// buffer; one background thread drains it with a single write (and at most
+// one fdatasync) per batch, then wakes every request waiting on that batch.
+class WalWriter {
+public:
+    WalWriter() = default;
+    ~WalWriter();
+    WalWriter(const WalWriter&) = delete;
+    WalWriter& operator=(const WalWriter&) = delete;
+
+    // `file_header` is written first whenever the log is empty (new or reset).
+    bool open(const std::string& path, Durability mode, int interval_ms = 100,
+              std::string_view file_header = {});
+    void close();
+
+    // Queues one record and returns its sequence number. Cheap enough to call
+    // while holding a shard lock, which keeps WAL order equal to apply order.
+    uint64_t append(std::string_view record);
+
+    // Blocks until record `seq` satisfies the configured durability.
+    // Returns false if the log hit an I/O error.
+    bool waitDurable(uint64_t seq);
+
+    // Non-blocking form of waitDurable for event-loop callers: runs fn(ok)
+    // once record `seq` is durable, on the writer thread (or inline if it
+    // already is). fn must be cheap and must not call back into the writer.
+    void whenDurable(uint64_t seq, std::function<void(bool)> fn);
+
+    // Drains everything queued, then truncates the log back to its header.
+    void reset();
+
+    // Cuts the log after the last record appended so far: the writer thread
+    // flushes and fdatasyncs everything up to that record, renames the log to
+    // `rotated_path` and writes later records to a fresh log at the original
+    // path. Appends carry on meanwhile; only the caller waits for the cut.
+    bool rotate(const std::string& rotated_path);
+
+    // Size of the current log file, header included.
+    uint64_t logBytes();
+
+    Durability mode() const { return mode_; }
+
+private:
+    void run();
+    bool openFile();
+    bool switchFile(const std::string& rotated_path);
+    void waitIdle(std::unique_lock<std::mutex>& lock);
+    bool isDurable(uint64_t seq) const;
+    void notifyWaiters(std::unique_lock<std::mutex>& lock);
+
+    struct DurableWaiter {
+        uint64_t seq;
+        std::function<void(bool)> fn;
+    };
+
+    std::mutex mu_;
+    std::condition_variable work_cv_;
+    std::condition_variable done_cv_;
+
+    std::string pending_;
+    std::vector<size_t> pending_ends_;  // Record boundaries, for EveryWrite
+    std::vector<DurableWaiter> waiters_;  // whenDurable callbacks, in seq order
+    uint64_t appended_seq_ = 0;
+    uint64_t written_seq_ = 0;
+    uint64_t synced_seq_ = 0;
+    uint64_t file_bytes_ = 0;
+    bool busy_ = false;      // Writer thread is doing I/O without holding mu_
+    // Pending rotate(): the cut falls after the first rotate_bytes_ of
+    // pending_ (rotate_records_ of pending_ends_), i.e. after record rotate_seq_
+    bool rotate_requested_ = false;
+    bool rotate_ok_ = false;
+    size_t rotate_bytes_ = 0;
+    size_t rotate_records_ = 0;
+    uint64_t rotate_seq_ = 0;
+    std::string rotate_path_;
+    bool healthy_ = true;
+    bool stop_ = false;
+
+    Durability mode_ = Durability::Interval;
+    int interval_ms_ = 100;
+    std::string path_;
+    std::string header_;
+    int fd_ = -1;
+    std::thread thread_;
+
+    Histogram& batch_records_ = Metrics::instance().histogram(
+        "kv_wal_batch_records", "Records written per WAL group commit.");
+    Histogram& batch_bytes_ = Metrics::instance().histogram(
+        "kv_wal_batch_bytes", "Bytes written per WAL group commit.");
+    Histogram& fsync_latency_ = Metrics::instance().histogram(
+        "kv_wal_fsync_duration_seconds", "Time spent in fdatasync on the WAL.", "", kNanosToSeconds);
+};
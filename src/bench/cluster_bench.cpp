@@ -0,0 +1,760 @@
+#include "../../include/batch_codec.hpp"
+#include "../../include/httplib.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <climits>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <fcntl.h>
+#include <functional>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <string>
+#include <sys/wait.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+// Rebalancing under load, on a local cluster: launches N+1 kv_servers and a
+// kv_proxy, puts N servers in the ring, preloads a dataset through the
+// proxy, then adds the spare server and removes the first one while
+// background clients keep reading and writing at a fixed rate. For each
+// rebalance it reports keys and bytes moved (from the proxy's job report),
+// wall time, and the clients' p50/p99/p999 during the operation next to the
+// baseline measured before it. Client latency is taken from each request's
+// scheduled start (open loop), so a stall counts against every request it
+// delayed.
+//
+// --scenario runs a consistency check instead, after the same preload, and
+// exits 2 if it fails:
+//   cancel-then-job  cancels the add midway, removes the spare, then writes
+//                    and reads through the proxy; nothing may reach the spare.
+//   cancel-then-add  cancels the add midway, updates and deletes keys, then
+//                    adds a second spare; every key must read as last written.
+//   del-during-copy  deletes keys at --rate keys/s while the spare is added;
+//                    none of them may come back with the copy.
+// Scenarios slow migrations down (--migration-rate-mb 1) unless --proxy-args
+// says otherwise, so they can act while data is moving.
+//
+// With --json - the JSON report takes stdout and the text goes to stderr.
+//
+// Processes run in a scratch directory (WAL and snapshot files land there)
+// and are killed at the end. POSIX only.
+//
+// Usage: ./cluster_bench [--servers N] [--base-port P] [--records N] [--value-size N]
+//                        [--rate OPS_PER_S] [--threads N] [--read-percent P] [--settle-s N]
+//                        [--bin-dir DIR] [--work-dir DIR] [--proxy-args "FLAGS"] [--json FILE|-]
+//                        [--scenario rebalance|cancel-then-job|cancel-then-add|del-during-copy]
+
+using clock_type = std::chrono::steady_clock;
+
+// Where the text report goes: stderr when the JSON report takes stdout
+// (--json -), so that stdout can be piped straight into a JSON tool.
+FILE* text_out = stdout;
+
+struct Options {
+    size_t servers = 3;     // In the ring before the add
+    int base_port = 9500;   // Proxy; servers take the next ports
+    size_t records = 200000;
+    size_t value_size = 100;
+    double rate = 2000;     // Background ops/s, all threads together
+    size_t threads = 4;
+    int read_percent = 90;
+    double settle_s = 3;    // Baseline window, and the gap between operations
+    std::string bin_dir;    // Default: next to this binary
+    std::string work_dir;   // Default: a fresh directory under /tmp
+    std::string proxy_args; // Extra kv_proxy flags, space-separated (migration pacing)
+    std::string json_path;
+    std::string scenario = "rebalance";
+};
+
+// --- PROCESSES ---
+class Cluster {
+public:
+    explicit Cluster(std::string work_dir) : work_dir_(std::move(work_dir)) {}
+    ~Cluster() {
+        for (pid_t pid : pids_) kill(pid, SIGTERM);
+        for (pid_t pid : pids_) waitpid(pid, nullptr, 0);
+    }
+
+    // Starts `args` in the work directory with output to `log_name` there.
+    bool spawn(const std::vector<std::string>& args, const std::string& log_name) {
+        pid_t pid = fork();
+        if (pid < 0) return false;
+        if (pid == 0) {
+            if (chdir(work_dir_.c_str()) != 0) _exit(127);
+            int fd = open(log_name.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+            if (fd >= 0) {
+                dup2(fd, STDOUT_FILENO);
+                dup2(fd, STDERR_FILENO);
+                close(fd);
+            }
+            std::vector<char*> argv;
+            for (const auto& a : args) argv.push_back(const_cast<char*>(a.c_str()));
+            argv.push_back(nullptr);
+            execv(argv[0], argv.data());
+            _exit(127);
+        }
+        pids_.push_back(pid);
+        return true;
+    }
+
+private:
+    std::string work_dir_;
+    std::vector<pid_t> pids_;
+};
+
+// Polls `path` until it answers 200, for up to 10 s.
+bool wait_ready(int port, const char* path) {
+    httplib::Client cli("127.0.0.1", port);
+    cli.set_connection_timeout(0, 200000);
+    for (int i = 0; i < 100; ++i) {
+        auto res = cli.Get(path);
+        if (res && res->status == 200) return true;
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    }
+    return false;
+}
+
+std::string node_of(int port) { return "127.0.0.1:" + std::to_string(port); }
+std::string key_of(uint64_t index) { return "user" + std::to_string(index); }
+
+// --- BACKGROUND LOAD ---
+struct Sample {
+    int64_t due_ns;     // Scheduled start, from the run's start
+    uint64_t latency_ns;
+    bool ok;
+};
+
+struct Load {
+    const Options& opt;
+    int proxy_port;
+    clock_type::time_point start;
+    std::atomic<bool> stop{false};
+    std::vector<std::vector<Sample>> samples;  // Per thread
+
+    Load(const Options& o, int port) : opt(o), proxy_port(port), samples(o.threads) {}
+
+    int64_t now_ns() const {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(clock_type::now() - start).count();
+    }
+
+    void worker(size_t id) {
+        httplib::Client cli("127.0.0.1", proxy_port);
+        cli.set_keep_alive(true);
+        cli.set_tcp_nodelay(true);
+        std::mt19937_64 rng(id + 1);
+        const std::string value(opt.value_size, 'x');
+        const auto interval = std::chrono::nanoseconds(static_cast<int64_t>(1e9 * opt.threads / opt.rate));
+        clock_type::time_point due = start + interval * id / opt.threads;
+        std::vector<Sample>& out = samples[id];
+
+        while (!stop.load(std::memory_order_relaxed)) {
+            std::this_thread::sleep_until(due);
+            std::string key = key_of(rng() % opt.records);
+            bool ok;
+            if (static_cast<int>(rng() % 100) < opt.read_percent) {
+                auto res = cli.Get("/get", httplib::Params{{"key", key}}, httplib::Headers());
+                ok = res && res->status == 200;  // Every key was preloaded
+            } else {
+                auto res = cli.Post("/put", httplib::Params{{"key", key}, {"val", value}});
+                ok = res && res->status == 200;
+            }
+            auto done = clock_type::now();
+            out.push_back({std::chrono::duration_cast<std::chrono::nanoseconds>(due - start).count(),
+                           static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(done - due).count()),
+                           ok});
+            due += interval;
+        }
+    }
+};
+
+struct Window {
+    size_t ops = 0;
+    size_t errors = 0;
+    uint64_t p50 = 0, p99 = 0, p999 = 0, max = 0;
+};
+
+// Requests scheduled in [from, to).
+Window window_of(const Load& load, int64_t from, int64_t to) {
+    Window w;
+    std::vector<uint64_t> latencies;
+    for (const auto& thread_samples : load.samples) {
+        for (const Sample& s : thread_samples) {
+            if (s.due_ns < from || s.due_ns >= to) continue;
+            latencies.push_back(s.latency_ns);
+            if (!s.ok) w.errors++;
+        }
+    }
+    w.ops = latencies.size();
+    if (latencies.empty()) return w;
+    std::sort(latencies.begin(), latencies.end());
+    auto at = [&](double q) { return latencies[std::min(latencies.size() - 1, static_cast<size_t>(q * latencies.size()))]; };
+    w.p50 = at(0.50);
+    w.p99 = at(0.99);
+    w.p999 = at(0.999);
+    w.max = latencies.back();
+    return w;
+}
+
+// --- REBALANCES ---
+struct Operation {
+    std::string op;    // "add" | "remove"
+    std::string node;
+    bool ok = false;
+    size_t keys = 0, bytes = 0;
+    uint64_t proxy_ms = 0;  // Job running time, as timed by the proxy
+    double wall_ms = 0;     // As seen by this client
+    int64_t from_ns = 0, to_ns = 0;
+    Window load;
+};
+
+// Value of the "<name> <value>" line in a /jobs/<id> report.
+std::string job_field(const std::string& report, const std::string& name) {
+    std::istringstream in(report);
+    for (std::string line; std::getline(in, line);) {
+        if (line.compare(0, name.size() + 1, name + " ") == 0) return line.substr(name.size() + 1);
+    }
+    return "";
+}
+
+// Submits an add or remove; returns its job ID, or 0 if the proxy refused.
+uint64_t submit_job(httplib::Client& admin, const std::string& op, const std::string& node) {
+    auto res = admin.Post(op == "add" ? "/add_node" : "/remove_node", httplib::Params{{"host", node}});
+
+    // "Accepted: job N (...)"
+    unsigned long long id;
+    if (!res || res->status != 202 || std::sscanf(res->body.c_str(), "Accepted: job %llu", &id) != 1) {
+        std::fprintf(stderr, "[Bench] %s %s failed: %s\n", op.c_str(), node.c_str(),
+                     res ? res->body.c_str() : httplib::to_string(res.error()).c_str());
+        return 0;
+    }
+    return id;
+}
+
+// Polls job `id` until it stops. Returns the final state ("done", "failed",
+// "cancelled", or empty if the proxy is gone) and sets `report` to the job's
+// last /jobs/<id> report.
+std::string wait_job(httplib::Client& admin, uint64_t id, std::string& report) {
+    const std::string path = "/jobs/" + std::to_string(id);
+    std::string state;
+    for (int misses = 0; state != "done" && state != "failed" && state != "cancelled";) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        auto poll = admin.Get(path);
+        if (!poll || poll->status != 200) {
+            if (++misses == 100) break;  // The proxy is gone
+            continue;
+        }
+        misses = 0;
+        report = poll->body;
+        state = job_field(report, "state");
+    }
+    return state;
+}
+
+// Submits an add or remove and waits for it; see wait_job.
+std::string run_job(httplib::Client& admin, const std::string& op, const std::string& node, std::string& report) {
+    uint64_t id = submit_job(admin, op, node);
+    if (id == 0) return "";
+    std::string state = wait_job(admin, id, report);
+    if (state != "done") {
+        std::fprintf(stderr, "[Bench] %s %s: job %llu %s\n", op.c_str(), node.c_str(),
+                     static_cast<unsigned long long>(id), state.empty() ? "unreachable" : state.c_str());
+    }
+    return state;
+}
+
+Operation run_operation(Load& load, const std::string& op, const std::string& node) {
+    httplib::Client admin("127.0.0.1", load.proxy_port);
+    Operation r;
+    r.op = op;
+    r.node = node;
+    r.from_ns = load.now_ns();
+    std::string report;
+    r.ok = run_job(admin, op, node, report) == "done";
+    r.to_ns = load.now_ns();
+    r.wall_ms = (r.to_ns - r.from_ns) / 1e6;
+    r.keys = std::strtoull(job_field(report, "keys_moved").c_str(), nullptr, 10);
+    r.bytes = std::strtoull(job_field(report, "bytes_moved").c_str(), nullptr, 10);
+    r.proxy_ms = std::strtoull(job_field(report, "elapsed_ms").c_str(), nullptr, 10);
+    return r;
+}
+
+// Sum of the "keys" lines of the servers' /stats.
+size_t cluster_keys(int first_port, size_t count) {
+    size_t total = 0;
+    for (size_t i = 0; i < count; ++i) {
+        httplib::Client cli("127.0.0.1", first_port + static_cast<int>(i));
+        auto res = cli.Get("/stats");
+        if (!res || res->status != 200) continue;
+        unsigned long long keys;
+        if (std::sscanf(res->body.c_str(), "keys %llu", &keys) == 1) total += keys;
+    }
+    return total;
+}
+
+// --- SCENARIOS ---
+size_t node_keys(int port) { return cluster_keys(port, 1); }
+
+// Polls job `id` until it runs, then gives it a moment to start copying.
+// Progress counters only move as batches land, so they cannot tell.
+bool wait_copying(httplib::Client& admin, uint64_t id) {
+    for (int i = 0; i < 500; ++i) {
+        auto poll = admin.Get("/jobs/" + std::to_string(id));
+        if (poll && poll->status == 200 && job_field(poll->body, "state") == "running") {
+            std::this_thread::sleep_for(std::chrono::milliseconds(300));
+            return true;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    return false;
+}
+
+// A cancelled add leaves the spare in the ring with routes to it. Removing
+// the spare first finishes the add, then moves everything back: afterwards
+// every write lands on a ring member, reads see it, and the reset spare
+// stays empty.
+bool scenario_cancel_then_job(const Options& opt, int proxy_port, int spare_port) {
+    httplib::Client admin("127.0.0.1", proxy_port);
+    const std::string spare = node_of(spare_port);
+
+    // 1. Cancel the add while it is copying
+    uint64_t add = submit_job(admin, "add", spare);
+    if (add == 0 || !wait_copying(admin, add)) {
+        std::fprintf(stderr, "[Bench] The add finished or failed before it could be cancelled\n");
+        return false;
+    }
+    admin.Post("/jobs/" + std::to_string(add) + "/cancel");
+    std::string report;
+    std::string state = wait_job(admin, add, report);
+    std::fprintf(text_out, "[Bench] Add cancelled (%s) after %s keys\n", state.c_str(),
+                 job_field(report, "keys_moved").c_str());
+    if (state != "cancelled") return false;
+
+    // 2. A new job, which finishes the cancelled add first
+    if (run_job(admin, "remove", spare, report) != "done") return false;
+    auto old = admin.Get("/jobs/" + std::to_string(add));
+    std::string old_state = old ? job_field(old->body, "state") : "";
+
+    // 3. Write and read back fresh keys, and read a sample of the preloaded ones
+    httplib::Client cli("127.0.0.1", proxy_port);
+    cli.set_keep_alive(true);
+    size_t wrong = 0, lost = 0;
+    const size_t fresh = std::min<size_t>(opt.records, 5000);
+    for (size_t i = 0; i < fresh; ++i) {
+        std::string key = "fresh" + std::to_string(i), value = "v" + std::to_string(i);
+        auto put = cli.Post("/put", httplib::Params{{"key", key}, {"val", value}});
+        auto get = cli.Get("/get", httplib::Params{{"key", key}}, httplib::Headers());
+        if (!put || put->status != 200 || !get || get->status != 200 || get->body != value) wrong++;
+    }
+    for (size_t i = 0; i < opt.records; i += 10) {
+        auto get = cli.Get("/get", httplib::Params{{"key", key_of(i)}}, httplib::Headers());
+        if (!get || get->status != 200) lost++;
+    }
+    size_t on_spare = node_keys(spare_port);
+    std::fprintf(text_out, "[Bench] cancel-then-job: cancelled add %s, %zu/%zu fresh keys wrong, %zu/%zu "
+                 "preloaded keys missing, %zu keys on the removed spare\n",
+                 old_state.c_str(), wrong, fresh, lost, (opt.records + 9) / 10, on_spare);
+    return old_state == "done" && wrong == 0 && lost == 0 && on_spare == 0;
+}
+
+// Reads every preloaded key through the proxy (/mget, in batches) and hands
+// each result to `check`. Returns how many keys could not be read.
+size_t read_back(int proxy_port, size_t records, const std::function<void(size_t i, const BatchResult&)>& check) {
+    httplib::Client cli("127.0.0.1", proxy_port);
+    cli.set_keep_alive(true);
+    size_t unread = 0;
+    constexpr size_t kReadBatch = 500;
+    for (size_t begin = 0; begin < records; begin += kReadBatch) {
+        size_t end = std::min(records, begin + kReadBatch);
+        std::vector<std::string> keys;
+        for (size_t i = begin; i < end; ++i) keys.push_back(key_of(i));
+        std::vector<std::string_view> key_views(keys.begin(), keys.end());
+        std::string body;
+        encode_batch_keys(body, key_views);
+        auto res = cli.Post("/mget", body, "application/octet-stream");
+        std::vector<BatchResult> results;
+        if (!res || res->status != 200 || !decode_batch_results(res->body, results) || results.size() != keys.size()) {
+            unread += keys.size();
+            continue;
+        }
+        for (size_t i = begin; i < end; ++i) {
+            if (results[i - begin].status == BatchStatus::Error) unread++;
+            else check(i, results[i - begin]);
+        }
+    }
+    return unread;
+}
+
+// A cancelled add leaves half-copied ranges behind its routes. Adding a
+// different node must not strand them: it finishes the cancelled add first,
+// so every key reads as last written, including keys updated or deleted while
+// the add was stopped, and each key is stored exactly once.
+bool scenario_cancel_then_add(const Options& opt, int proxy_port, int first_server, size_t total_servers) {
+    httplib::Client admin("127.0.0.1", proxy_port);
+    const std::string spare = node_of(first_server + static_cast<int>(opt.servers));
+    const std::string second = node_of(first_server + static_cast<int>(opt.servers) + 1);
+
+    // 1. Cancel the add while it is copying
+    uint64_t add = submit_job(admin, "add", spare);
+    if (add == 0 || !wait_copying(admin, add)) {
+        std::fprintf(stderr, "[Bench] The add finished or failed before it could be cancelled\n");
+        return false;
+    }
+    admin.Post("/jobs/" + std::to_string(add) + "/cancel");
+    std::string report;
+    std::string state = wait_job(admin, add, report);
+    std::fprintf(text_out, "[Bench] Add cancelled (%s) after %s keys\n", state.c_str(),
+                 job_field(report, "keys_moved").c_str());
+    if (state != "cancelled") return false;
+
+    // 2. While it is stopped, update every 20th key and delete the one after
+    httplib::Client cli("127.0.0.1", proxy_port);
+    cli.set_keep_alive(true);
+    std::vector<char> deleted(opt.records, 0);
+    size_t failed_writes = 0;
+    constexpr size_t kBatch = 500;
+    for (size_t begin = 0; begin < opt.records; begin += kBatch * 20) {
+        std::vector<std::string> puts, put_values, dels;
+        for (size_t i = begin; i < std::min(opt.records, begin + kBatch * 20); i += 20) {
+            puts.push_back(key_of(i));
+            put_values.push_back("u" + std::to_string(i));
+            if (i + 1 < opt.records) dels.push_back(key_of(i + 1));
+        }
+        std::vector<std::string_view> put_views(puts.begin(), puts.end());
+        std::vector<std::string_view> value_views(put_values.begin(), put_values.end());
+        std::vector<std::string_view> del_views(dels.begin(), dels.end());
+        std::string body;
+        encode_batch_pairs(body, put_views, value_views);
+        auto put = cli.Post("/mput", body, "application/octet-stream");
+        body.clear();
+        encode_batch_keys(body, del_views);
+        auto del = cli.Post("/mdel", body, "application/octet-stream");
+        std::vector<BatchResult> put_results, del_results;
+        if (!put || put->status != 200 || !decode_batch_results(put->body, put_results)) failed_writes += puts.size();
+        if (!del || del->status != 200 || !decode_batch_results(del->body, del_results)) continue;
+        for (size_t j = 0; j < del_results.size(); ++j) {
+            if (del_results[j].status != BatchStatus::Error) deleted[begin + 20 * j + 1] = 1;
+        }
+    }
+
+    // 3. Add a different node; the cancelled add must be finished with it
+    if (run_job(admin, "add", second, report) != "done") return false;
+    auto old = admin.Get("/jobs/" + std::to_string(add));
+    std::string old_state = old ? job_field(old->body, "state") : "";
+
+    // 4. Every key reads as last written, and is stored once
+    const std::string preloaded(opt.value_size, 'v');
+    size_t wrong = 0, removed = 0;
+    size_t unread = read_back(proxy_port, opt.records, [&](size_t i, const BatchResult& r) {
+        removed += deleted[i];
+        if (deleted[i]) wrong += r.status != BatchStatus::Missing;
+        else if (i % 20 == 0) wrong += r.status != BatchStatus::Found || r.value != "u" + std::to_string(i);
+        else wrong += r.status != BatchStatus::Found || r.value != preloaded;
+    });
+    size_t stored = cluster_keys(first_server, total_servers);
+    std::fprintf(text_out, "[Bench] cancel-then-add: cancelled add %s, %zu keys deleted while stopped, %zu/%zu keys "
+                 "wrong, %zu unreadable, %zu failed writes, %zu keys stored (%zu expected)\n",
+                 old_state.c_str(), removed, wrong, opt.records, unread, failed_writes, stored,
+                 opt.records - removed);
+    return old_state == "done" && removed > 0 && wrong == 0 && unread == 0 && failed_writes == 0 &&
+           stored == opt.records - removed;
+}
+
+// Deletes preloaded keys through the proxy while an add copies them. A copy
+// read before a DEL may reach the spare after it, and must not bring the key
+// back: once the add is done, every key deleted must read as missing, and
+// every other key as present.
+bool scenario_del_during_copy(const Options& opt, int proxy_port, int spare_port) {
+    httplib::Client admin("127.0.0.1", proxy_port);
+    uint64_t add = submit_job(admin, "add", node_of(spare_port));
+    if (add == 0) return false;
+
+    // 1. Delete keys in a random order, in small batches at --rate keys/s,
+    //    until the add stops
+    constexpr size_t kBatch = 10;
+    std::vector<uint64_t> order(opt.records);
+    for (size_t i = 0; i < order.size(); ++i) order[i] = i;
+    std::shuffle(order.begin(), order.end(), std::mt19937_64(1));
+    std::vector<char> deleted(opt.records, 0);
+    std::atomic<size_t> next{0};
+    std::atomic<bool> stop{false};
+    std::vector<std::thread> deleters;
+    for (size_t t = 0; t < opt.threads; ++t) {
+        deleters.emplace_back([&, t] {
+            httplib::Client cli("127.0.0.1", proxy_port);
+            cli.set_keep_alive(true);
+            const auto interval = std::chrono::nanoseconds(static_cast<int64_t>(1e9 * kBatch * opt.threads / opt.rate));
+            clock_type::time_point due = clock_type::now() + interval * t / opt.threads;
+            std::vector<std::string> keys;
+            while (!stop) {
+                std::this_thread::sleep_until(due);
+                due += interval;
+                size_t begin = next.fetch_add(kBatch);
+                if (begin >= order.size()) break;
+                size_t end = std::min(order.size(), begin + kBatch);
+                keys.clear();
+                for (size_t i = begin; i < end; ++i) keys.push_back(key_of(order[i]));
+                std::vector<std::string_view> key_views(keys.begin(), keys.end());
+                std::string body;
+                encode_batch_keys(body, key_views);
+                auto res = cli.Post("/mdel", body, "application/octet-stream");
+                std::vector<BatchResult> results;
+                if (!res || res->status != 200 || !decode_batch_results(res->body, results)) continue;
+                for (size_t i = 0; i < results.size(); ++i) {
+                    if (results[i].status != BatchStatus::Error) deleted[order[begin + i]] = 1;
+                }
+            }
+        });
+    }
+    std::string report;
+    std::string state = wait_job(admin, add, report);
+    stop = true;
+    for (auto& t : deleters) t.join();
+    if (state != "done") {
+        std::fprintf(stderr, "[Bench] add: job %llu %s\n", static_cast<unsigned long long>(add),
+                     state.empty() ? "unreachable" : state.c_str());
+        return false;
+    }
+
+    // 2. Read every key back
+    size_t removed = 0, resurrected = 0, lost = 0;
+    size_t unread = read_back(proxy_port, opt.records, [&](size_t i, const BatchResult& r) {
+        if (deleted[i]) resurrected += r.status == BatchStatus::Found;
+        else lost += r.status != BatchStatus::Found;
+        removed += deleted[i];
+    });
+    std::fprintf(text_out, "[Bench] del-during-copy: %s keys moved, %zu keys deleted during the add, %zu of them back, "
+                 "%zu other keys missing, %zu unreadable\n",
+                 job_field(report, "keys_moved").c_str(), removed, resurrected, lost, unread);
+    return removed > 0 && resurrected == 0 && lost == 0 && unread == 0;
+}
+
+// --- REPORT ---
+double to_ms(uint64_t nanos) { return nanos / 1e6; }
+
+void print_window(const char* name, const Window& w) {
+    std::fprintf(text_out, "%-10s %8zu %7zu %9.3f %9.3f %9.3f %9.3f\n", name, w.ops, w.errors, to_ms(w.p50),
+                 to_ms(w.p99), to_ms(w.p999), to_ms(w.max));
+}
+
+void json_window(std::ostringstream& js, const Window& w) {
+    js << "{\"ops\": " << w.ops << ", \"errors\": " << w.errors << ", \"p50_ms\": " << to_ms(w.p50)
+       << ", \"p99_ms\": " << to_ms(w.p99) << ", \"p999_ms\": " << to_ms(w.p999) << ", \"max_ms\": " << to_ms(w.max)
+       << "}";
+}
+
+std::string json_report(const Options& opt, const Window& baseline, const std::vector<Operation>& ops, size_t keys_after) {
+    std::ostringstream js;
+    js << "{\n  \"servers\": " << opt.servers << ",\n"
+       << "  \"records\": " << opt.records << ",\n"
+       << "  \"value_size\": " << opt.value_size << ",\n"
+       << "  \"rate\": " << opt.rate << ",\n"
+       << "  \"threads\": " << opt.threads << ",\n"
+       << "  \"read_percent\": " << opt.read_percent << ",\n"
+       << "  \"baseline\": ";
+    json_window(js, baseline);
+    js << ",\n  \"operations\": [";
+    for (size_t i = 0; i < ops.size(); ++i) {
+        const Operation& r = ops[i];
+        js << (i ? ",\n" : "\n") << "    {\"op\": \"" << r.op << "\", \"node\": \"" << r.node << "\", \"ok\": "
+           << (r.ok ? "true" : "false") << ", \"keys_moved\": " << r.keys << ", \"bytes_moved\": " << r.bytes
+           << ", \"wall_ms\": " << r.wall_ms << ", \"proxy_ms\": " << r.proxy_ms << ", \"load\": ";
+        json_window(js, r.load);
+        js << ", \"p99_vs_baseline\": " << (baseline.p99 ? double(r.load.p99) / baseline.p99 : 0) << "}";
+    }
+    js << "\n  ],\n  \"keys_after\": " << keys_after << "\n}\n";
+    return js.str();
+}
+
+void usage() {
+    std::fprintf(stderr,
+                 "Usage: ./cluster_bench [--servers N] [--base-port P] [--records N] [--value-size N]\n"
+                 "                       [--rate OPS_PER_S] [--threads N] [--read-percent P] [--settle-s N]\n"
+                 "                       [--bin-dir DIR] [--work-dir DIR] [--proxy-args \"FLAGS\"] [--json FILE|-]\n"
+                 "                       [--scenario rebalance|cancel-then-job|cancel-then-add|del-during-copy]\n");
+}
+
+int main(int argc, char* argv[]) {
+    Options opt;
+    try {
+        for (int i = 1; i < argc; i += 2) {
+            std::string flag = argv[i];
+            if (i + 1 >= argc) { usage(); return 1; }
+            std::string val = argv[i + 1];
+            if (flag == "--servers") opt.servers = std::max<size_t>(1, std::stoul(val));
+            else if (flag == "--base-port") opt.base_port = std::stoi(val);
+            else if (flag == "--records") opt.records = std::max<size_t>(1, std::stoull(val));
+            else if (flag == "--value-size") opt.value_size = std::max<size_t>(1, std::stoul(val));
+            else if (flag == "--rate" && std::stod(val) > 0) opt.rate = std::stod(val);
+            else if (flag == "--threads") opt.threads = std::max<size_t>(1, std::stoul(val));
+            else if (flag == "--read-percent") opt.read_percent = std::stoi(val);
+            else if (flag == "--settle-s") opt.settle_s = std::stod(val);
+            else if (flag == "--bin-dir") opt.bin_dir = val;
+            else if (flag == "--work-dir") opt.work_dir = val;
+            else if (flag == "--proxy-args") opt.proxy_args = val;
+            else if (flag == "--json") opt.json_path = val;
+            else if (flag == "--scenario" && (val == "rebalance" || val == "cancel-then-job" ||
+                                              val == "cancel-then-add" || val == "del-during-copy"))
+                opt.scenario = val;
+            else { usage(); return 1; }
+        }
+    } catch (...) {
+        usage();
+        return 1;
+    }
+
+    // 1. LAUNCH: proxy on base_port, servers on the ports after it
+    char resolved[PATH_MAX];
+    std::string self = realpath(argv[0], resolved) ? resolved : argv[0];
+    if (opt.bin_dir.empty()) opt.bin_dir = self.substr(0, self.rfind('/'));
+    if (opt.work_dir.empty()) {
+        char tmpl[] = "/tmp/cluster_bench.XXXXXX";
+        if (!mkdtemp(tmpl)) { std::fprintf(stderr, "[Bench] Cannot create a work directory\n"); return 1; }
+        opt.work_dir = tmpl;
+    }
+    if (opt.scenario != "rebalance" && opt.proxy_args.empty()) opt.proxy_args = "--migration-rate-mb 1";
+    if (opt.json_path == "-") text_out = stderr;
+    const int proxy_port = opt.base_port;
+    const int first_server = opt.base_port + 1;
+    const size_t spares = opt.scenario == "cancel-then-add" ? 2 : 1;
+    const size_t total_servers = opt.servers + spares;  // The last ones are the spares to add
+
+    std::fprintf(text_out,
+                 "--- Cluster Bench: %zu+%zu servers, %zu records x %zu B, %.0f ops/s background (%d%% reads) ---\n",
+                 opt.servers, spares, opt.records, opt.value_size, opt.rate, opt.read_percent);
+    std::fprintf(text_out, "[Bench] Work directory %s\n", opt.work_dir.c_str());
+    std::fflush(text_out);
+
+    Cluster cluster(opt.work_dir);
+    for (size_t i = 0; i < total_servers; ++i) {
+        int port = first_server + static_cast<int>(i);
+        cluster.spawn({opt.bin_dir + "/kv_server", std::to_string(port), "--binary-port", "0", "--log-level", "warn"},
+                      "server_" + std::to_string(port) + ".out");
+    }
+    std::vector<std::string> proxy_cmd{opt.bin_dir + "/kv_proxy", "--port", std::to_string(proxy_port),
+                                       "--binary-port", "0", "--log-level", "warn"};
+    std::istringstream extra(opt.proxy_args);
+    for (std::string arg; extra >> arg;) proxy_cmd.push_back(arg);
+    cluster.spawn(proxy_cmd, "proxy.out");
+    for (size_t i = 0; i < total_servers; ++i) {
+        if (!wait_ready(first_server + static_cast<int>(i), "/status")) {
+            std::fprintf(stderr, "[Bench] kv_server on %d did not start (see %s)\n", first_server + int(i),
+                         opt.work_dir.c_str());
+            return 1;
+        }
+    }
+    if (!wait_ready(proxy_port, "/stats")) {
+        std::fprintf(stderr, "[Bench] kv_proxy on %d did not start (see %s)\n", proxy_port, opt.work_dir.c_str());
+        return 1;
+    }
+    {
+        httplib::Client admin("127.0.0.1", proxy_port);
+        for (size_t i = 0; i < opt.servers; ++i) {
+            std::string report;
+            if (run_job(admin, "add", node_of(first_server + int(i)), report) != "done") {
+                std::fprintf(stderr, "[Bench] Initial add_node failed\n");
+                return 1;
+            }
+        }
+    }
+
+    // 2. PRELOAD through the proxy
+    auto t0 = clock_type::now();
+    std::atomic<size_t> next{0};
+    std::atomic<bool> failed{false};
+    std::vector<std::thread> loaders;
+    for (size_t t = 0; t < opt.threads; ++t) {
+        loaders.emplace_back([&] {
+            constexpr size_t kBatch = 500;
+            httplib::Client cli("127.0.0.1", proxy_port);
+            cli.set_keep_alive(true);
+            const std::string value(opt.value_size, 'v');
+            std::vector<std::string> keys;
+            std::vector<std::string_view> key_views, values;
+            while (!failed) {
+                size_t begin = next.fetch_add(kBatch);
+                if (begin >= opt.records) break;
+                size_t end = std::min(opt.records, begin + kBatch);
+                keys.clear();
+                for (size_t i = begin; i < end; ++i) keys.push_back(key_of(i));
+                key_views.assign(keys.begin(), keys.end());
+                values.assign(keys.size(), value);
+                std::string body;
+                encode_batch_pairs(body, key_views, values);
+                auto res = cli.Post("/mput", body, "application/octet-stream");
+                if (!res || res->status != 200) failed = true;
+            }
+        });
+    }
+    for (auto& t : loaders) t.join();
+    if (failed) { std::fprintf(stderr, "[Bench] Preload failed\n"); return 1; }
+    double load_s = std::chrono::duration<double>(clock_type::now() - t0).count();
+    std::fprintf(text_out, "[Bench] Preloaded %zu records in %.2f s; %zu keys on the servers\n", opt.records, load_s,
+                 cluster_keys(first_server, total_servers));
+    std::fflush(text_out);
+    if (opt.scenario == "cancel-then-job") {
+        return scenario_cancel_then_job(opt, proxy_port, first_server + static_cast<int>(opt.servers)) ? 0 : 2;
+    }
+    if (opt.scenario == "cancel-then-add") {
+        return scenario_cancel_then_add(opt, proxy_port, first_server, total_servers) ? 0 : 2;
+    }
+    if (opt.scenario == "del-during-copy") {
+        return scenario_del_during_copy(opt, proxy_port, first_server + static_cast<int>(opt.servers)) ? 0 : 2;
+    }
+
+    // 3. BACKGROUND LOAD, baseline, then add and remove with a settle gap
+    Load load(opt, proxy_port);
+    load.start = clock_type::now();
+    std::vector<std::thread> workers;
+    for (size_t t = 0; t < opt.threads; ++t) workers.emplace_back(&Load::worker, &load, t);
+    auto settle = [&] { std::this_thread::sleep_for(std::chrono::duration<double>(opt.settle_s)); };
+
+    int64_t baseline_from = static_cast<int64_t>(0.5e9);  // Skip connection warm-up
+    settle();
+    int64_t baseline_to = load.now_ns();
+    std::vector<Operation> ops;
+    ops.push_back(run_operation(load, "add", node_of(first_server + static_cast<int>(opt.servers))));
+    settle();
+    ops.push_back(run_operation(load, "remove", node_of(first_server)));
+    settle();
+    load.stop = true;
+    for (auto& w : workers) w.join();
+
+    // 4. REPORT
+    Window baseline = window_of(load, std::min(baseline_from, baseline_to / 2), baseline_to);
+    for (Operation& r : ops) r.load = window_of(load, r.from_ns, r.to_ns);
+    size_t keys_after = cluster_keys(first_server, total_servers);
+
+    std::fprintf(text_out, "%-10s %8s %7s %9s %9s %9s %9s\n", "window", "ops", "errors", "p50 ms", "p99 ms", "p999 ms",
+                 "max ms");
+    print_window("baseline", baseline);
+    for (const Operation& r : ops) print_window(r.op.c_str(), r.load);
+    std::fprintf(text_out, "%-10s %-16s %10s %12s %10s %10s %10s\n", "op", "node", "keys", "bytes", "wall ms",
+                 "proxy ms", "p99 x");
+    bool all_ok = true;
+    for (const Operation& r : ops) {
+        std::fprintf(text_out, "%-10s %-16s %10zu %12zu %10.1f %10llu %10.2f\n", r.op.c_str(), r.node.c_str(), r.keys,
+                     r.bytes, r.wall_ms, static_cast<unsigned long long>(r.proxy_ms),
+                     baseline.p99 ? double(r.load.p99) / baseline.p99 : 0.0);
+        all_ok = all_ok && r.ok;
+    }
+    std::fprintf(text_out, "[Bench] %zu keys on the servers afterwards (expected %zu)\n", keys_after, opt.records);
+    if (keys_after != opt.records) all_ok = false;
+
+    if (!opt.json_path.empty()) {
+        std::string json = json_report(opt, baseline, ops, keys_after);
+        if (opt.json_path == "-") {
+            std::fputs(json.c_str(), stdout);
+        } else {
+            FILE* f = std::fopen(opt.json_path.c_str(), "w");
+            if (!f) { std::fprintf(stderr, "[Bench] Cannot write %s\n", opt.json_path.c_str()); return 1; }
+            std::fputs(json.c_str(), f);
+            std::fclose(f);
+        }
+    }
+    return all_ok ? 0 : 2;
+}
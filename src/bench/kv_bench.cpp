@@ -0,0 +1,679 @@
+#include "../../include/batch_codec.hpp"
+#include "../../include/binary_protocol.hpp"
+#include "../../include/httplib.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#ifdef __linux__
+#include "../../include/frame_channel.hpp"
+#include <future>
+#endif
+
+// YCSB-style load generator against a kv_proxy or a single kv_server, over
+// HTTP or the binary protocol. Runs workloads A-F (or a custom read/update
+// mix) on a Zipfian, uniform or latest key distribution, closed-loop (each
+// thread sends as fast as its replies come back) or open-loop at a fixed
+// rate. Open-loop latencies are measured from when each request was due,
+// not when it was sent, so a stall is charged to every request it delayed
+// (coordinated omission). Reports per-operation throughput and
+// p50/p99/p999/max as text and optionally JSON; with --json - the JSON takes
+// stdout and the text goes to stderr.
+//
+// Usage: ./kv_bench [--target host:port] [--protocol http|binary] [--workload a-f]
+//                   [--records N] [--duration-s N] [--ops N] [--threads N] [--connections N]
+//                   [--rate OPS_PER_S] [--distribution zipfian|uniform|latest] [--zipf-theta X]
+//                   [--read-percent P] [--value-size N] [--value-size-max N] [--scan-length N]
+//                   [--load 0|1] [--interval-s N] [--binary-port N] [--json FILE|-]
+
+using clock_type = std::chrono::steady_clock;
+
+// Where the text report goes: stderr when the JSON report takes stdout
+// (--json -), so that stdout can be piped straight into a JSON tool.
+FILE* text_out = stdout;
+
+// --- LATENCY HISTOGRAM ---
+// Log-linear like the server's metrics histograms, but with 128 buckets per
+// power of two (under 1% error) and not thread-safe: every worker records
+// into its own and they are merged when the run ends.
+class LatencyHistogram {
+public:
+    static constexpr int kSubBits = 7;
+    static constexpr uint64_t kSub = uint64_t{1} << kSubBits;
+    static constexpr int kMaxExponent = 40;  // ~18 minutes in nanoseconds
+    static constexpr size_t kBuckets = (kMaxExponent - kSubBits + 1) * kSub;
+
+    LatencyHistogram() : counts_(kBuckets, 0) {}
+
+    void record(uint64_t nanos) {
+        counts_[bucketOf(nanos)]++;
+        count_++;
+        max_ = std::max(max_, nanos);
+    }
+    void merge(const LatencyHistogram& other) {
+        for (size_t i = 0; i < kBuckets; ++i) counts_[i] += other.counts_[i];
+        count_ += other.count_;
+        max_ = std::max(max_, other.max_);
+    }
+    void clear() {
+        std::fill(counts_.begin(), counts_.end(), 0);
+        count_ = max_ = 0;
+    }
+    uint64_t count() const { return count_; }
+    uint64_t max() const { return max_; }
+
+    // Highest value in the bucket holding the q-th quantile.
+    uint64_t percentile(double q) const {
+        if (count_ == 0) return 0;
+        uint64_t rank = std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(q * count_)));
+        uint64_t seen = 0;
+        for (size_t i = 0; i < kBuckets; ++i) {
+            seen += counts_[i];
+            if (seen >= rank) return std::min(bucketMax(i), max_);
+        }
+        return max_;
+    }
+
+private:
+    static size_t bucketOf(uint64_t v) {
+        if (v < kSub) return static_cast<size_t>(v);
+        int exponent = 63 - __builtin_clzll(v);
+        if (exponent > kMaxExponent) return kBuckets - 1;
+        return (exponent - kSubBits + 1) * kSub + ((v >> (exponent - kSubBits)) - kSub);
+    }
+    static uint64_t bucketMax(size_t i) {
+        if (i < kSub) return i;
+        uint64_t group = i / kSub;
+        uint64_t width = uint64_t{1} << (group - 1);
+        return (kSub + i % kSub) * width + width - 1;
+    }
+
+    std::vector<uint64_t> counts_;
+    uint64_t count_ = 0;
+    uint64_t max_ = 0;
+};
+
+// --- KEY DISTRIBUTIONS ---
+// YCSB's Zipfian generator (Gray et al., "Quickly Generating Billion-Record
+// Synthetic Databases"): rank 0 is the most popular item. zeta(n) is
+// computed once and shared by every thread.
+struct Zipfian {
+    uint64_t items = 1;
+    double theta = 0.99;
+    double zetan = 1, alpha = 1, eta = 0, half_pow_theta = 0;
+
+    Zipfian(uint64_t n, double skew) : items(std::max<uint64_t>(n, 1)), theta(skew) {
+        double zeta2 = 1 + std::pow(0.5, theta);
+        zetan = 0;
+        for (uint64_t i = 1; i <= items; ++i) zetan += 1 / std::pow(static_cast<double>(i), theta);
+        alpha = 1 / (1 - theta);
+        eta = (1 - std::pow(2.0 / items, 1 - theta)) / (1 - zeta2 / zetan);
+        half_pow_theta = 1 + std::pow(0.5, theta);
+    }
+
+    uint64_t next(double u) const {
+        double uz = u * zetan;
+        if (uz < 1) return 0;
+        if (uz < half_pow_theta) return 1;
+        return std::min<uint64_t>(items - 1, static_cast<uint64_t>(items * std::pow(eta * u - eta + 1, alpha)));
+    }
+};
+
+enum class Distribution { Zipfian, Uniform, Latest };
+
+// FNV-1a, to scatter Zipfian ranks over the key space (YCSB's "scrambled
+// Zipfian") so the hottest keys do not all sit next to each other.
+uint64_t scramble(uint64_t v) {
+    uint64_t h = 14695981039346656037ULL;
+    for (int i = 0; i < 8; ++i) {
+        h ^= (v >> (8 * i)) & 0xFF;
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+std::string key_of(uint64_t index) { return "user" + std::to_string(index); }
+
+// --- WORKLOADS ---
+enum Op { Read, Update, Insert, Scan, ReadModifyWrite, kNumOps };
+const char* const kOpNames[kNumOps] = {"read", "update", "insert", "scan", "rmw"};
+
+struct Workload {
+    double mix[kNumOps];  // Proportions, summing to 1
+    Distribution distribution;
+};
+
+bool parse_workload(const std::string& name, Workload& w) {
+    if (name == "a") w = {{0.50, 0.50, 0, 0, 0}, Distribution::Zipfian};         // Update heavy
+    else if (name == "b") w = {{0.95, 0.05, 0, 0, 0}, Distribution::Zipfian};    // Read mostly
+    else if (name == "c") w = {{1.00, 0, 0, 0, 0}, Distribution::Zipfian};       // Read only
+    else if (name == "d") w = {{0.95, 0, 0.05, 0, 0}, Distribution::Latest};     // Read latest
+    else if (name == "e") w = {{0, 0, 0.05, 0.95, 0}, Distribution::Zipfian};    // Short ranges
+    else if (name == "f") w = {{0.50, 0, 0, 0, 0.50}, Distribution::Zipfian};    // Read-modify-write
+    else return false;
+    return true;
+}
+
+// --- CONNECTIONS ---
+// Blocking single requests; safe to share between threads.
+class Connection {
+public:
+    virtual ~Connection() = default;
+    // False on a transport or server error; `found` tells a hit from a miss.
+    virtual bool get(const std::string& key, bool& found) = 0;
+    virtual bool put(const std::string& key, std::string_view value) = 0;
+    virtual bool mget(const std::vector<std::string_view>& keys) = 0;
+    virtual bool mput(const std::vector<std::string_view>& keys, const std::vector<std::string_view>& values) = 0;
+};
+
+class HttpConnection : public Connection {
+public:
+    HttpConnection(const std::string& ip, int port) : cli_(ip, port) {
+        cli_.set_keep_alive(true);
+        cli_.set_tcp_nodelay(true);
+        cli_.set_read_timeout(30);
+    }
+    bool get(const std::string& key, bool& found) override {
+        auto res = cli_.Get("/get", httplib::Params{{"key", key}}, httplib::Headers());
+        found = res && res->status == 200;
+        return res && (res->status == 200 || res->status == 404);
+    }
+    bool put(const std::string& key, std::string_view value) override {
+        auto res = cli_.Post("/put", httplib::Params{{"key", key}, {"val", std::string(value)}});
+        return res && res->status == 200;
+    }
+    bool mget(const std::vector<std::string_view>& keys) override {
+        std::string body;
+        encode_batch_keys(body, keys);
+        return batch("/mget", body);
+    }
+    bool mput(const std::vector<std::string_view>& keys, const std::vector<std::string_view>& values) override {
+        std::string body;
+        encode_batch_pairs(body, keys, values);
+        return batch("/mput", body);
+    }
+
+private:
+    bool batch(const char* path, const std::string& body) {
+        auto res = cli_.Post(path, body, "application/octet-stream");
+        std::vector<BatchResult> results;
+        if (!res || res->status != 200 || !decode_batch_results(res->body, results)) return false;
+        return std::none_of(results.begin(), results.end(),
+                            [](const BatchResult& r) { return r.status == BatchStatus::Error; });
+    }
+
+    httplib::Client cli_;
+};
+
+#ifdef __linux__
+class BinaryConnection : public Connection {
+public:
+    BinaryConnection(const std::string& ip, int port) : channel_(ip, port) {}
+    bool get(const std::string& key, bool& found) override {
+        BinStatus status = call(BinOp::Get, key);
+        found = status == BinStatus::Ok;
+        return status == BinStatus::Ok || status == BinStatus::NotFound;
+    }
+    bool put(const std::string& key, std::string_view value) override {
+        return call(BinOp::Put, encode_put_payload(key, value)) == BinStatus::Ok;
+    }
+    bool mget(const std::vector<std::string_view>& keys) override {
+        std::string body;
+        encode_batch_keys(body, keys);
+        return batch(BinOp::MGet, body);
+    }
+    bool mput(const std::vector<std::string_view>& keys, const std::vector<std::string_view>& values) override {
+        std::string body;
+        encode_batch_pairs(body, keys, values);
+        return batch(BinOp::MPut, body);
+    }
+
+private:
+    BinStatus call(BinOp op, std::string_view payload, std::string* reply = nullptr) {
+        std::promise<BinStatus> done;
+        channel_.call(op, payload, [&](BinStatus status, std::string_view body) {
+            if (reply) reply->assign(body);
+            done.set_value(status);
+        });
+        return done.get_future().get();
+    }
+    bool batch(BinOp op, const std::string& body) {
+        std::string reply;
+        std::vector<BatchResult> results;
+        if (call(op, body, &reply) != BinStatus::Ok || !decode_batch_results(reply, results)) return false;
+        return std::none_of(results.begin(), results.end(),
+                            [](const BatchResult& r) { return r.status == BatchStatus::Error; });
+    }
+
+    FrameChannel channel_;
+};
+#endif
+
+// --- RUN ---
+struct Options {
+    std::string ip = "127.0.0.1";
+    int port = 8000;
+    int binary_port = -1;  // Default: port + kBinaryPortOffset
+    bool binary = false;
+    std::string workload_name = "a";
+    Workload workload{};
+    uint64_t records = 100000;
+    double duration_s = 10;
+    uint64_t max_ops = 0;  // 0 = run for duration_s
+    size_t threads = 8;
+    size_t connections = 0;  // 0 = one per thread
+    double rate = 0;         // Total ops/s; 0 = closed loop
+    double zipf_theta = 0.99;
+    size_t value_size = 100;
+    size_t value_size_max = 0;  // > value_size: uniform in [value_size, value_size_max]
+    size_t scan_length = 100;
+    bool load = true;
+    double interval_s = 0;
+    std::string json_path;
+};
+
+struct WorkerStats {
+    LatencyHistogram latency[kNumOps];  // From when the request was due
+    LatencyHistogram service[kNumOps];  // From when it was actually sent
+    uint64_t errors[kNumOps] = {};
+    std::mutex interval_mu;             // Guards `interval` against the reporter
+    LatencyHistogram interval;
+};
+
+struct IntervalReport {
+    double t;
+    double ops_per_s;
+    uint64_t p50, p99, p999;
+};
+
+// Shared state of the run phase.
+struct Run {
+    const Options& opt;
+    Zipfian zipf;
+    std::atomic<uint64_t> inserted;  // Keys [0, inserted) exist
+    std::atomic<uint64_t> issued{0};
+    std::atomic<bool> stop{false};
+    std::string value_pool;          // Values are slices of this
+    clock_type::time_point start;
+
+    Run(const Options& o, uint64_t zipf_items) : opt(o), zipf(zipf_items, o.zipf_theta), inserted(o.records) {}
+};
+
+uint64_t choose_key(Run& run, std::mt19937_64& rng, std::uniform_real_distribution<double>& unit) {
+    uint64_t existing = std::max<uint64_t>(run.inserted.load(std::memory_order_relaxed), 1);
+    switch (run.opt.workload.distribution) {
+        case Distribution::Uniform:
+            return rng() % existing;
+        case Distribution::Latest: {
+            uint64_t back = run.zipf.next(unit(rng));
+            return back < existing ? existing - 1 - back : existing - 1;
+        }
+        case Distribution::Zipfian:
+            break;
+    }
+    return scramble(run.zipf.next(unit(rng))) % existing;
+}
+
+std::string_view choose_value(Run& run, std::mt19937_64& rng) {
+    size_t size = run.opt.value_size;
+    if (run.opt.value_size_max > size) size += rng() % (run.opt.value_size_max - size + 1);
+    return std::string_view(run.value_pool).substr(rng() % (run.value_pool.size() - size + 1), size);
+}
+
+void worker(Run& run, Connection& conn, WorkerStats& stats, size_t id) {
+    const Options& opt = run.opt;
+    std::mt19937_64 rng(id * 7919 + 1);
+    std::uniform_real_distribution<double> unit(0, 1);
+    std::uniform_int_distribution<size_t> scan_len(1, std::max<size_t>(1, opt.scan_length));
+
+    // Open loop: this thread owes one request every `interval`, staggered
+    // against the other threads.
+    const bool open_loop = opt.rate > 0;
+    const auto interval = std::chrono::nanoseconds(
+        open_loop ? static_cast<int64_t>(1e9 * opt.threads / opt.rate) : 0);
+    clock_type::time_point due = run.start + interval * id / opt.threads;
+    const auto deadline = run.start + std::chrono::duration_cast<clock_type::duration>(
+        std::chrono::duration<double>(opt.duration_s));
+
+    std::vector<std::string> scan_keys;
+    std::vector<std::string_view> scan_views;
+    while (!run.stop.load(std::memory_order_relaxed)) {
+        if (opt.max_ops && run.issued.fetch_add(1, std::memory_order_relaxed) >= opt.max_ops) break;
+        if (open_loop) {
+            if (due >= deadline) break;
+            std::this_thread::sleep_until(due);
+        }
+        clock_type::time_point sent = clock_type::now();
+        if (!open_loop) {
+            if (!opt.max_ops && sent >= deadline) break;
+            due = sent;
+        }
+
+        // 1. Pick the operation and do it
+        double pick = unit(rng);
+        int op = 0;
+        while (op + 1 < kNumOps && pick >= opt.workload.mix[op]) pick -= opt.workload.mix[op++];
+        bool ok = true, found;
+        switch (op) {
+            case Read:
+                ok = conn.get(key_of(choose_key(run, rng, unit)), found);
+                break;
+            case Update:
+                ok = conn.put(key_of(choose_key(run, rng, unit)), choose_value(run, rng));
+                break;
+            case Insert:
+                ok = conn.put(key_of(run.inserted.fetch_add(1, std::memory_order_relaxed)), choose_value(run, rng));
+                break;
+            case Scan: {
+                // No ordered scans in this store: read a run of consecutive
+                // record keys in one multi-get instead.
+                uint64_t first = choose_key(run, rng, unit);
+                size_t n = scan_len(rng);
+                scan_keys.clear();
+                for (size_t i = 0; i < n; ++i) scan_keys.push_back(key_of(first + i));
+                scan_views.assign(scan_keys.begin(), scan_keys.end());
+                ok = conn.mget(scan_views);
+                break;
+            }
+            case ReadModifyWrite: {
+                std::string key = key_of(choose_key(run, rng, unit));
+                ok = conn.get(key, found) && conn.put(key, choose_value(run, rng));
+                break;
+            }
+        }
+
+        // 2. Record it
+        clock_type::time_point done = clock_type::now();
+        uint64_t latency = std::chrono::duration_cast<std::chrono::nanoseconds>(done - due).count();
+        stats.latency[op].record(latency);
+        stats.service[op].record(std::chrono::duration_cast<std::chrono::nanoseconds>(done - sent).count());
+        if (!ok) stats.errors[op]++;
+        if (opt.interval_s > 0) {
+            std::lock_guard<std::mutex> lock(stats.interval_mu);
+            stats.interval.record(latency);
+        }
+        if (open_loop) due += interval;
+    }
+}
+
+// Writes `records` keys in batches, spread over the connections.
+bool load_records(const Options& opt, std::vector<std::unique_ptr<Connection>>& conns, const std::string& value_pool) {
+    constexpr uint64_t kBatch = 500;
+    std::atomic<uint64_t> next{0};
+    std::atomic<bool> failed{false};
+    std::vector<std::thread> loaders;
+    for (size_t c = 0; c < conns.size(); ++c) {
+        loaders.emplace_back([&, c] {
+            std::mt19937_64 rng(c + 1);
+            std::vector<std::string> keys;
+            std::vector<std::string_view> key_views, values;
+            while (!failed) {
+                uint64_t begin = next.fetch_add(kBatch);
+                if (begin >= opt.records) break;
+                uint64_t end = std::min(opt.records, begin + kBatch);
+                keys.clear();
+                values.clear();
+                for (uint64_t i = begin; i < end; ++i) {
+                    keys.push_back(key_of(i));
+                    size_t size = opt.value_size;
+                    if (opt.value_size_max > size) size += rng() % (opt.value_size_max - size + 1);
+                    values.push_back(std::string_view(value_pool).substr(rng() % (value_pool.size() - size + 1), size));
+                }
+                key_views.assign(keys.begin(), keys.end());
+                if (!conns[c]->mput(key_views, values)) failed = true;
+            }
+        });
+    }
+    for (auto& t : loaders) t.join();
+    return !failed;
+}
+
+// --- REPORT ---
+double to_ms(uint64_t nanos) { return nanos / 1e6; }
+
+void print_row(const char* name, const LatencyHistogram& h, uint64_t errors, double secs) {
+    std::fprintf(text_out, "%-8s %10llu %8llu %12.0f %9.3f %9.3f %9.3f %9.3f\n", name,
+                 static_cast<unsigned long long>(h.count()), static_cast<unsigned long long>(errors), h.count() / secs,
+                 to_ms(h.percentile(0.50)), to_ms(h.percentile(0.99)), to_ms(h.percentile(0.999)), to_ms(h.max()));
+}
+
+void json_latency(std::ostringstream& js, const char* name, const LatencyHistogram& h) {
+    js << "\"" << name << "\": {\"p50\": " << h.percentile(0.50) / 1e3 << ", \"p99\": " << h.percentile(0.99) / 1e3
+       << ", \"p999\": " << h.percentile(0.999) / 1e3 << ", \"max\": " << h.max() / 1e3 << "}";
+}
+
+std::string json_report(const Options& opt, double secs, const LatencyHistogram* latency, const LatencyHistogram* service,
+                        const uint64_t* errors, const LatencyHistogram& total, const std::vector<IntervalReport>& intervals) {
+    std::ostringstream js;
+    js << "{\n  \"workload\": \"" << opt.workload_name << "\",\n"
+       << "  \"target\": \"" << opt.ip << ":" << opt.port << "\",\n"
+       << "  \"protocol\": \"" << (opt.binary ? "binary" : "http") << "\",\n"
+       << "  \"records\": " << opt.records << ",\n"
+       << "  \"threads\": " << opt.threads << ",\n"
+       << "  \"connections\": " << opt.connections << ",\n"
+       << "  \"target_rate\": " << opt.rate << ",\n"
+       << "  \"duration_s\": " << secs << ",\n"
+       << "  \"throughput\": " << total.count() / secs << ",\n"
+       << "  \"latency_unit\": \"us\",\n"
+       << "  \"ops\": {";
+    bool first = true;
+    for (int op = 0; op < kNumOps; ++op) {
+        if (latency[op].count() == 0 && errors[op] == 0) continue;
+        js << (first ? "\n" : ",\n") << "    \"" << kOpNames[op] << "\": {\"count\": " << latency[op].count()
+           << ", \"errors\": " << errors[op] << ", ";
+        json_latency(js, "latency", latency[op]);
+        js << ", ";
+        json_latency(js, "service_time", service[op]);
+        js << "}";
+        first = false;
+    }
+    js << "\n  },\n  \"total\": {\"count\": " << total.count() << ", ";
+    json_latency(js, "latency", total);
+    js << "},\n  \"intervals\": [";
+    for (size_t i = 0; i < intervals.size(); ++i) {
+        const IntervalReport& r = intervals[i];
+        js << (i ? ",\n" : "\n") << "    {\"t\": " << r.t << ", \"ops_per_s\": " << r.ops_per_s << ", \"p50\": "
+           << r.p50 / 1e3 << ", \"p99\": " << r.p99 / 1e3 << ", \"p999\": " << r.p999 / 1e3 << "}";
+    }
+    js << (intervals.empty() ? "]\n}\n" : "\n  ]\n}\n");
+    return js.str();
+}
+
+void usage() {
+    std::fprintf(stderr,
+                 "Usage: ./kv_bench [--target host:port] [--protocol http|binary] [--workload a-f]\n"
+                 "                  [--records N] [--duration-s N] [--ops N] [--threads N] [--connections N]\n"
+                 "                  [--rate OPS_PER_S] [--distribution zipfian|uniform|latest] [--zipf-theta X]\n"
+                 "                  [--read-percent P] [--value-size N] [--value-size-max N] [--scan-length N]\n"
+                 "                  [--load 0|1] [--interval-s N] [--binary-port N] [--json FILE|-]\n");
+}
+
+int main(int argc, char* argv[]) {
+    Options opt;
+    parse_workload(opt.workload_name, opt.workload);
+    std::string distribution, target;
+    int read_percent = -1;
+    try {
+        for (int i = 1; i < argc; i += 2) {
+            std::string flag = argv[i];
+            if (i + 1 >= argc) { usage(); return 1; }
+            std::string val = argv[i + 1];
+            if (flag == "--target") target = val;
+            else if (flag == "--protocol" && (val == "http" || val == "binary")) opt.binary = val == "binary";
+            else if (flag == "--workload" && parse_workload(val, opt.workload)) opt.workload_name = val;
+            else if (flag == "--records") opt.records = std::stoull(val);
+            else if (flag == "--duration-s") opt.duration_s = std::stod(val);
+            else if (flag == "--ops") opt.max_ops = std::stoull(val);
+            else if (flag == "--threads") opt.threads = std::max<size_t>(1, std::stoul(val));
+            else if (flag == "--connections") opt.connections = std::stoul(val);
+            else if (flag == "--rate") opt.rate = std::stod(val);
+            else if (flag == "--distribution") distribution = val;
+            else if (flag == "--zipf-theta") opt.zipf_theta = std::stod(val);
+            else if (flag == "--read-percent") read_percent = std::stoi(val);
+            else if (flag == "--value-size") opt.value_size = std::max<size_t>(1, std::stoul(val));
+            else if (flag == "--value-size-max") opt.value_size_max = std::stoul(val);
+            else if (flag == "--scan-length") opt.scan_length = std::stoul(val);
+            else if (flag == "--load") opt.load = val != "0";
+            else if (flag == "--interval-s") opt.interval_s = std::stod(val);
+            else if (flag == "--binary-port") opt.binary_port = std::stoi(val);
+            else if (flag == "--json") opt.json_path = val;
+            else { usage(); return 1; }
+        }
+        if (!target.empty()) {
+            opt.ip = target.substr(0, target.rfind(':'));
+            opt.port = std::stoi(target.substr(target.rfind(':') + 1));
+        }
+    } catch (...) {
+        usage();
+        return 1;
+    }
+    if (distribution == "zipfian") opt.workload.distribution = Distribution::Zipfian;
+    else if (distribution == "uniform") opt.workload.distribution = Distribution::Uniform;
+    else if (distribution == "latest") opt.workload.distribution = Distribution::Latest;
+    else if (!distribution.empty()) { usage(); return 1; }
+    if (read_percent >= 0) {
+        opt.workload_name = "custom";
+        opt.workload.mix[Read] = std::min(read_percent, 100) / 100.0;
+        opt.workload.mix[Update] = 1 - opt.workload.mix[Read];
+        opt.workload.mix[Insert] = opt.workload.mix[Scan] = opt.workload.mix[ReadModifyWrite] = 0;
+    }
+    if (opt.connections == 0) opt.connections = opt.threads;
+    if (opt.binary_port < 0) opt.binary_port = opt.port + kBinaryPortOffset;
+    if (opt.json_path == "-") text_out = stderr;
+#ifndef __linux__
+    if (opt.binary) { std::fprintf(stderr, "[Bench] The binary protocol client is Linux only\n"); return 1; }
+#endif
+
+    // 1. CONNECT
+    std::vector<std::unique_ptr<Connection>> conns;
+    for (size_t c = 0; c < opt.connections; ++c) {
+#ifdef __linux__
+        if (opt.binary) { conns.push_back(std::make_unique<BinaryConnection>(opt.ip, opt.binary_port)); continue; }
+#endif
+        conns.push_back(std::make_unique<HttpConnection>(opt.ip, opt.port));
+    }
+    std::string value_pool(std::max(opt.value_size, opt.value_size_max) + 4096, 0);
+    std::mt19937_64 pool_rng(42);
+    for (char& c : value_pool) c = static_cast<char>('a' + pool_rng() % 26);
+
+    std::fprintf(text_out,
+                 "--- KV Bench: workload %s, %llu records, %zu threads, %zu connections, %s -> %s:%d (%s) ---\n",
+                 opt.workload_name.c_str(), static_cast<unsigned long long>(opt.records), opt.threads, opt.connections,
+                 opt.binary ? "binary" : "http", opt.ip.c_str(), opt.binary ? opt.binary_port : opt.port,
+                 opt.rate > 0 ? ("open loop, " + std::to_string(static_cast<long long>(opt.rate)) + " ops/s").c_str()
+                              : "closed loop");
+    std::fflush(text_out);
+
+    // 2. LOAD
+    if (opt.load) {
+        auto t0 = clock_type::now();
+        if (!load_records(opt, conns, value_pool)) { std::fprintf(stderr, "[Bench] Load failed\n"); return 1; }
+        std::fprintf(text_out, "[Bench] Loaded %llu records in %.2f s\n", static_cast<unsigned long long>(opt.records),
+                     std::chrono::duration<double>(clock_type::now() - t0).count());
+    }
+
+    // 3. RUN (a Latest workload draws recency offsets over the loaded records)
+    Run run(opt, opt.records);
+    run.value_pool = value_pool;
+    std::vector<std::unique_ptr<WorkerStats>> stats;
+    for (size_t t = 0; t < opt.threads; ++t) stats.push_back(std::make_unique<WorkerStats>());
+    run.start = clock_type::now() + std::chrono::milliseconds(10);
+    std::vector<std::thread> workers;
+    for (size_t t = 0; t < opt.threads; ++t) {
+        workers.emplace_back(worker, std::ref(run), std::ref(*conns[t % conns.size()]), std::ref(*stats[t]), t);
+    }
+
+    // Per-interval throughput and latency while the workers run
+    std::vector<IntervalReport> intervals;
+    std::mutex finished_mu;
+    std::condition_variable finished_cv;
+    bool finished = false;
+    std::thread reporter;
+    if (opt.interval_s > 0) {
+        reporter = std::thread([&] {
+            auto period = std::chrono::duration_cast<clock_type::duration>(std::chrono::duration<double>(opt.interval_s));
+            auto tick = run.start + period;
+            while (true) {
+                {
+                    std::unique_lock<std::mutex> lock(finished_mu);
+                    if (finished_cv.wait_until(lock, tick, [&] { return finished; })) break;  // Drop the partial tail
+                }
+                LatencyHistogram merged;
+                for (auto& s : stats) {
+                    std::lock_guard<std::mutex> lock(s->interval_mu);
+                    merged.merge(s->interval);
+                    s->interval.clear();
+                }
+                double t = std::chrono::duration<double>(tick - run.start).count();
+                IntervalReport r{t, merged.count() / opt.interval_s, merged.percentile(0.50), merged.percentile(0.99),
+                                 merged.percentile(0.999)};
+                intervals.push_back(r);
+                std::fprintf(text_out, "[Bench] t=%6.1fs %10.0f ops/s  p50 %8.3f ms  p99 %8.3f ms  p999 %8.3f ms\n", t,
+                             r.ops_per_s, to_ms(r.p50), to_ms(r.p99), to_ms(r.p999));
+                std::fflush(text_out);
+                tick += period;
+            }
+        });
+    }
+    for (auto& w : workers) w.join();
+    double secs = std::chrono::duration<double>(clock_type::now() - run.start).count();
+    {
+        std::lock_guard<std::mutex> lock(finished_mu);
+        finished = true;
+    }
+    finished_cv.notify_one();
+    if (reporter.joinable()) reporter.join();
+
+    // 4. REPORT
+    LatencyHistogram latency[kNumOps], service[kNumOps], total;
+    uint64_t errors[kNumOps] = {};
+    for (auto& s : stats) {
+        for (int op = 0; op < kNumOps; ++op) {
+            latency[op].merge(s->latency[op]);
+            service[op].merge(s->service[op]);
+            errors[op] += s->errors[op];
+        }
+    }
+    for (int op = 0; op < kNumOps; ++op) total.merge(latency[op]);
+
+    std::fprintf(text_out, "%-8s %10s %8s %12s %9s %9s %9s %9s\n", "op", "count", "errors", "ops/s", "p50 ms", "p99 ms",
+                 "p999 ms", "max ms");
+    uint64_t total_errors = 0;
+    for (int op = 0; op < kNumOps; ++op) {
+        if (latency[op].count() == 0) continue;
+        print_row(kOpNames[op], latency[op], errors[op], secs);
+        total_errors += errors[op];
+    }
+    print_row("total", total, total_errors, secs);
+    if (opt.rate > 0) {
+        std::fprintf(text_out, "(latency from each request's scheduled start; service time p99: ");
+        for (int op = 0; op < kNumOps; ++op) {
+            if (service[op].count()) {
+                std::fprintf(text_out, "%s %.3f ms ", kOpNames[op], to_ms(service[op].percentile(0.99)));
+            }
+        }
+        std::fprintf(text_out, ")\n");
+    }
+
+    if (!opt.json_path.empty()) {
+        std::string json = json_report(opt, secs, latency, service, errors, total, intervals);
+        if (opt.json_path == "-") {
+            std::fputs(json.c_str(), stdout);
+        } else {
+            FILE* f = std::fopen(opt.json_path.c_str(), "w");
+            if (!f) { std::fprintf(stderr, "[Bench] Cannot write %s\n", opt.json_path.c_str()); return 1; }
+            std::fputs(json.c_str(), f);
+            std::fclose(f);
+        }
+    }
+    return total_errors ? 2 : 0;
+}
@@ -0,0 +1,385 @@
+#include "../../include/flat_map.hpp"
+#include "../../include/hash_ring.hpp"
+#include "../../include/logger.hpp"
+#include "../../include/shard_store.hpp"
+#include "../../include/wal_format.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Microbenchmarks of the hot primitives, in isolation: key hashing, ring
+// lookup and rebalancing, shard selection, the shard map and WAL records.
+// Each case is calibrated to run for at least --min-time-ms, then timed
+// --repeats times; the median ns/op is reported (plus the fastest run).
+// Results go to stdout as a table and, with --json, as one JSON document
+// meant to be diffed between releases. With --json - the JSON takes stdout
+// and the table goes to stderr.
+//
+// Usage: ./kv_microbench [--filter SUBSTRING] [--min-time-ms N] [--repeats N] [--json FILE|-]
+
+using clock_type = std::chrono::steady_clock;
+
+// --- HARNESS ---
+// Bodies return a checksum of their work, stored here so the compiler cannot
+// drop the work.
+static volatile uint64_t g_sink;
+
+// Where the table goes: stderr when the JSON report takes stdout (--json -),
+// so that stdout can be piped straight into a JSON tool.
+static FILE* g_text = stdout;
+
+struct Result {
+    std::string name;
+    std::vector<std::pair<std::string, size_t>> params;
+    uint64_t iterations = 0;    // Per timed run
+    double ns_per_op = 0;       // Median over the runs
+    double ns_per_op_min = 0;
+    size_t bytes_per_op = 0;    // Input bytes processed per op, when meaningful
+};
+
+struct Options {
+    std::string filter;
+    double min_time_ms = 50;
+    int repeats = 5;
+    std::string json_path;
+};
+
+class Suite {
+public:
+    explicit Suite(const Options& opt) : opt_(opt) {}
+
+    bool wants(const std::string& name) const {
+        return opt_.filter.empty() || name.find(opt_.filter) != std::string::npos;
+    }
+
+    // `body(iters)` performs `iters` operations.
+    template <typename Body>
+    void run(const std::string& name, std::vector<std::pair<std::string, size_t>> params, size_t bytes_per_op,
+             Body body) {
+        // 1. Calibrate: double the iteration count until a run is long enough
+        uint64_t iters = 1;
+        while (true) {
+            double ms = timeMs(body, iters);
+            if (ms >= opt_.min_time_ms || iters >= (uint64_t{1} << 40)) break;
+            double grow = ms > 0 ? opt_.min_time_ms * 1.2 / ms : 16;
+            iters = static_cast<uint64_t>(iters * std::min(std::max(grow, 2.0), 16.0));
+        }
+
+        // 2. Timed runs
+        std::vector<double> ns;
+        for (int r = 0; r < opt_.repeats; ++r) ns.push_back(timeMs(body, iters) * 1e6 / iters);
+        std::sort(ns.begin(), ns.end());
+
+        Result res;
+        res.name = name;
+        res.params = std::move(params);
+        res.iterations = iters;
+        res.ns_per_op = ns[ns.size() / 2];
+        res.ns_per_op_min = ns.front();
+        res.bytes_per_op = bytes_per_op;
+        print(res);
+        results_.push_back(std::move(res));
+    }
+
+    const std::vector<Result>& results() const { return results_; }
+
+private:
+    template <typename Body>
+    static double timeMs(Body& body, uint64_t iters) {
+        auto t0 = clock_type::now();
+        g_sink = g_sink + body(iters);
+        return std::chrono::duration<double, std::milli>(clock_type::now() - t0).count();
+    }
+
+    static void print(const Result& r) {
+        std::string params;
+        for (const auto& p : r.params) params += p.first + "=" + std::to_string(p.second) + " ";
+        std::fprintf(g_text, "%-22s %-28s %12.1f %12.1f %10.2f", r.name.c_str(), params.c_str(), r.ns_per_op,
+                     r.ns_per_op_min, 1e3 / r.ns_per_op);
+        if (r.bytes_per_op) std::fprintf(g_text, " %10.1f", r.bytes_per_op / r.ns_per_op * 1e3);
+        std::fprintf(g_text, "\n");
+        std::fflush(g_text);
+    }
+
+    const Options& opt_;
+    std::vector<Result> results_;
+};
+
+// --- INPUTS ---
+// `count` distinct keys of exactly `len` bytes (len >= 8).
+std::vector<std::string> make_keys(size_t count, size_t len, uint64_t seed) {
+    std::mt19937_64 rng(seed);
+    std::vector<std::string> keys;
+    keys.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        std::string key = "user:" + std::to_string(i) + ":";
+        while (key.size() < len) key.push_back(static_cast<char>('a' + rng() % 26));
+        key.resize(len);
+        keys.push_back(std::move(key));
+    }
+    return keys;
+}
+
+std::string node_address(size_t n) {
+    return "10." + std::to_string(n / 65536) + "." + std::to_string(n / 256 % 256) + "." + std::to_string(n % 256) +
+           ":8081";
+}
+
+// --- CASES ---
+void bench_hashing(Suite& suite) {
+    for (size_t len : {8, 16, 32, 64, 128, 256, 1024}) {
+        std::vector<std::string> keys = make_keys(1024, std::max<size_t>(len, 8), len);
+        if (suite.wants("hash.ring_hash_key")) {
+            // Placement on the proxy's ring (and the servers' ring index)
+            suite.run("hash.ring_hash_key", {{"key_len", len}}, len, [&](uint64_t iters) {
+                uint64_t sum = 0;
+                for (uint64_t i = 0; i < iters; ++i) sum += ConsistentHashRing::hash_key(keys[i & 1023]);
+                return sum;
+            });
+        }
+        if (suite.wants("hash.shard_key_hash")) {
+            // The server's shard hash
+            suite.run("hash.shard_key_hash", {{"key_len", len}}, len, [&](uint64_t iters) {
+                uint64_t sum = 0;
+                for (uint64_t i = 0; i < iters; ++i) sum += ShardStore::keyHash(keys[i & 1023]);
+                return sum;
+            });
+        }
+    }
+}
+
+void bench_ring(Suite& suite) {
+    if (!suite.wants("ring.")) return;
+    const size_t kKeys = 1 << 16;
+    std::vector<std::string> keys = make_keys(kKeys, 16, 7);
+    for (size_t nodes : {10, 100, 1000}) {
+        for (int vnodes : {50, 200, 500}) {
+            ConsistentHashRing ring(vnodes);
+            for (size_t n = 0; n < nodes; ++n) ring.addNode(node_address(n));
+            std::vector<std::pair<std::string, size_t>> params{{"nodes", nodes}, {"vnodes", size_t(vnodes)}};
+
+            if (suite.wants("ring.get_node")) {
+                suite.run("ring.get_node", params, 0, [&](uint64_t iters) {
+                    uint64_t sum = 0;
+                    for (uint64_t i = 0; i < iters; ++i) sum += ring.getNode(keys[i & (kKeys - 1)]).size();
+                    return sum;
+                });
+            }
+            if (suite.wants("ring.get_node_id")) {
+                suite.run("ring.get_node_id", params, 0, [&](uint64_t iters) {
+                    uint64_t sum = 0;
+                    for (uint64_t i = 0; i < iters; ++i) sum += ring.getNodeId(keys[i & (kKeys - 1)]);
+                    return sum;
+                });
+            }
+            if (suite.wants("ring.rebalancing_tasks")) {
+                // Plan for the newest node joining a ring of `nodes`
+                const std::string joining = node_address(nodes - 1);
+                suite.run("ring.rebalancing_tasks", params, 0, [&](uint64_t iters) {
+                    uint64_t sum = 0;
+                    for (uint64_t i = 0; i < iters; ++i) sum += ring.getRebalancingTasks(joining).size();
+                    return sum;
+                });
+            }
+            if (suite.wants("ring.rebalancing_plan")) {
+                // The same tasks grouped by source with adjacent ranges merged
+                const std::string joining = node_address(nodes - 1);
+                suite.run("ring.rebalancing_plan", params, 0, [&](uint64_t iters) {
+                    uint64_t sum = 0;
+                    for (uint64_t i = 0; i < iters; ++i) sum += ring.getRebalancingPlan(joining).size();
+                    return sum;
+                });
+            }
+        }
+    }
+}
+
+void bench_shards(Suite& suite) {
+    if (!suite.wants("shard.shard_id")) return;
+    std::vector<std::string> keys = make_keys(1 << 16, 16, 11);
+    for (size_t shards : {16, 256, 4096}) {
+        ShardStore store(shards);
+        suite.run("shard.shard_id", {{"shards", shards}, {"key_len", 16}}, 0, [&](uint64_t iters) {
+            uint64_t sum = 0;
+            for (uint64_t i = 0; i < iters; ++i) sum += store.shardId(keys[i & 0xFFFF]);
+            return sum;
+        });
+    }
+}
+
+void bench_map(Suite& suite) {
+    if (!suite.wants("map.")) return;
+    for (size_t size : {size_t(1) << 10, size_t(1) << 16, size_t(1) << 20}) {
+        std::vector<std::string> keys = make_keys(size, 16, size);
+        std::vector<std::string> absent = make_keys(size, 17, size + 1);  // Never inserted
+        std::vector<size_t> order(size);
+        for (size_t i = 0; i < size; ++i) order[i] = i;
+        std::shuffle(order.begin(), order.end(), std::mt19937_64(42));
+        const std::string value(16, 'v');
+        std::vector<std::pair<std::string, size_t>> params{{"keys", size}, {"value_size", value.size()}};
+
+        if (suite.wants("map.insert")) {
+            // Fills fresh maps from empty, so growth is included
+            suite.run("map.insert", params, 0, [&](uint64_t iters) {
+                auto map = std::make_unique<FlatStringMap>();
+                uint64_t sum = 0;
+                for (uint64_t i = 0, k = 0; i < iters; ++i) {
+                    sum += map->insertOrAssign(keys[k], value);
+                    if (++k == size) {
+                        map = std::make_unique<FlatStringMap>();
+                        k = 0;
+                    }
+                }
+                return sum;
+            });
+        }
+
+        FlatStringMap map;
+        for (const auto& k : keys) map.insertOrAssign(k, value);
+        if (suite.wants("map.find_hit")) {
+            suite.run("map.find_hit", params, 0, [&](uint64_t iters) {
+                uint64_t sum = 0;
+                for (uint64_t i = 0, k = 0; i < iters; ++i) {
+                    sum += map.find(keys[order[k]]) != nullptr;
+                    if (++k == size) k = 0;
+                }
+                return sum;
+            });
+        }
+        if (suite.wants("map.find_miss")) {
+            suite.run("map.find_miss", params, 0, [&](uint64_t iters) {
+                uint64_t sum = 0;
+                for (uint64_t i = 0, k = 0; i < iters; ++i) {
+                    sum += map.find(absent[order[k]]) != nullptr;
+                    if (++k == size) k = 0;
+                }
+                return sum;
+            });
+        }
+    }
+}
+
+void bench_wal(Suite& suite) {
+    if (!suite.wants("wal.")) return;
+    const std::string key = make_keys(1, 16, 3)[0];
+    for (size_t value_size : {16, 256, 4096}) {
+        const std::string value(value_size, 'v');
+        std::string record;
+        encode_wal_record(record, WalOp::Set, key, value);
+        const size_t record_size = record.size();
+        std::vector<std::pair<std::string, size_t>> params{{"key_len", key.size()}, {"value_size", value_size}};
+
+        if (suite.wants("wal.encode")) {
+            suite.run("wal.encode", params, record_size, [&](uint64_t iters) {
+                std::string out;
+                out.reserve(record_size);
+                uint64_t sum = 0;
+                for (uint64_t i = 0; i < iters; ++i) {
+                    out.clear();
+                    encode_wal_record(out, WalOp::Set, key, value);
+                    sum += static_cast<unsigned char>(out[0]);
+                }
+                return sum;
+            });
+        }
+        for (bool verify : {true, false}) {
+            const char* name = verify ? "wal.decode" : "wal.decode_no_crc";
+            if (!suite.wants(name)) continue;
+            suite.run(name, params, record_size, [&](uint64_t iters) {
+                uint64_t sum = 0;
+                WalRecord rec;
+                size_t consumed = 0;
+                for (uint64_t i = 0; i < iters; ++i) {
+                    if (decode_wal_record(record.data(), record.size(), rec, consumed, verify) == WalDecode::Ok) {
+                        sum += consumed + rec.value.size();
+                    }
+                }
+                return sum;
+            });
+        }
+    }
+}
+
+// --- OUTPUT ---
+std::string json_report(const Options& opt, const std::vector<Result>& results) {
+    std::ostringstream js;
+    js << "{\n  \"suite\": \"kv_microbench\",\n"
+#ifdef NDEBUG
+       << "  \"build\": \"release\",\n"
+#else
+       << "  \"build\": \"debug\",\n"
+#endif
+       << "  \"min_time_ms\": " << opt.min_time_ms << ",\n"
+       << "  \"repeats\": " << opt.repeats << ",\n"
+       << "  \"results\": [";
+    for (size_t i = 0; i < results.size(); ++i) {
+        const Result& r = results[i];
+        js << (i ? ",\n" : "\n") << "    {\"name\": \"" << r.name << "\", \"params\": {";
+        for (size_t p = 0; p < r.params.size(); ++p) {
+            js << (p ? ", " : "") << "\"" << r.params[p].first << "\": " << r.params[p].second;
+        }
+        js << "}, \"iterations\": " << r.iterations << ", \"ns_per_op\": " << r.ns_per_op
+           << ", \"ns_per_op_min\": " << r.ns_per_op_min << ", \"ops_per_s\": " << 1e9 / r.ns_per_op;
+        if (r.bytes_per_op) js << ", \"bytes_per_s\": " << r.bytes_per_op / r.ns_per_op * 1e9;
+        js << "}";
+    }
+    js << (results.empty() ? "]\n}\n" : "\n  ]\n}\n");
+    return js.str();
+}
+
+void usage() {
+    std::fprintf(stderr, "Usage: ./kv_microbench [--filter SUBSTRING] [--min-time-ms N] [--repeats N] [--json FILE|-]\n");
+}
+
+int main(int argc, char* argv[]) {
+    Options opt;
+    try {
+        for (int i = 1; i < argc; i += 2) {
+            std::string flag = argv[i];
+            if (i + 1 >= argc) { usage(); return 1; }
+            std::string val = argv[i + 1];
+            if (flag == "--filter") opt.filter = val;
+            else if (flag == "--min-time-ms") opt.min_time_ms = std::stod(val);
+            else if (flag == "--repeats") opt.repeats = std::max(1, std::stoi(val));
+            else if (flag == "--json") opt.json_path = val;
+            else { usage(); return 1; }
+        }
+    } catch (...) {
+        usage();
+        return 1;
+    }
+
+    if (opt.json_path == "-") g_text = stderr;
+
+    // getRebalancingTasks logs every plan at Info
+    Logger::instance().setLevel(LogLevel::Warn);
+
+    std::fprintf(g_text, "--- KV Microbench: %.0f ms min per run, median of %d runs ---\n", opt.min_time_ms,
+                 opt.repeats);
+    std::fprintf(g_text, "%-22s %-28s %12s %12s %10s %10s\n", "case", "params", "ns/op", "min ns/op", "Mop/s", "MB/s");
+    Suite suite(opt);
+    bench_hashing(suite);
+    bench_ring(suite);
+    bench_shards(suite);
+    bench_map(suite);
+    bench_wal(suite);
+
+    if (!opt.json_path.empty()) {
+        std::string json = json_report(opt, suite.results());
+        if (opt.json_path == "-") {
+            std::fputs(json.c_str(), stdout);
+        } else {
+            FILE* f = std::fopen(opt.json_path.c_str(), "w");
+            if (!f) { std::fprintf(stderr, "[Bench] Cannot write %s\n", opt.json_path.c_str()); return 1; }
+            std::fputs(json.c_str(), f);
+            std::fclose(f);
+        }
+    }
+    return 0;
+}
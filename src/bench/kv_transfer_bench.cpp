@@ -0,0 +1,125 @@
+#include "../../include/httplib.h"
+#include "../../include/wal_format.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <sstream>
+#include <string>
+
+// Migration throughput between two live storage nodes: the bulk path
+// (/range_export -> /bulk_load -> /range_delete) vs the per-key path
+// (/range -> /put + /del per key). Both nodes are RESET first.
+// Usage: ./kv_transfer_bench <src host:port> <dst host:port> [num_keys] [value_size] [legacy_keys]
+
+using clock_type = std::chrono::steady_clock;
+constexpr size_t kBatchBytes = 4 << 20;
+
+struct Node {
+    explicit Node(const std::string& address)
+        : cli(address.substr(0, address.rfind(':')), std::stoi(address.substr(address.rfind(':') + 1))) {
+        cli.set_keep_alive(true);
+        cli.set_tcp_nodelay(true);
+        cli.set_read_timeout(60);
+        cli.set_write_timeout(60);
+    }
+    httplib::Client cli;
+};
+
+bool post_batches(Node& node, const std::string& records) {
+    size_t pos = 0, used;
+    while (pos < records.size()) {
+        size_t end = pos;
+        while (end < records.size() && end - pos < kBatchBytes) {
+            if (frame_wal_record(records.data() + end, records.size() - end, used) != WalDecode::Ok) return false;
+            end += used;
+        }
+        auto res = node.cli.Post("/bulk_load", records.data() + pos, end - pos, "application/octet-stream");
+        if (!res || res->status != 200) return false;
+        pos = end;
+    }
+    return true;
+}
+
+bool preload(Node& src, size_t num_keys, size_t value_size) {
+    std::string records, value(value_size, 'v');
+    for (size_t i = 0; i < num_keys; ++i) encode_wal_record(records, WalOp::Set, "user:" + std::to_string(i), value);
+    return post_batches(src, records);
+}
+
+// The ring split in two halves, as a migration would see a pair of tasks.
+const HashRange kHalves[2] = {{0, SIZE_MAX / 2}, {SIZE_MAX / 2, 0}};
+
+httplib::Params range_params(const HashRange& r) {
+    return {{"start", std::to_string(r.start)}, {"end", std::to_string(r.end)}};
+}
+
+void report(const char* name, size_t keys, size_t bytes, double secs) {
+    std::printf("%-10s %10zu %12.0f %10.1f %10.2f\n", name, keys, keys / secs, bytes / 1e6 / secs, secs);
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 3) {
+        std::fprintf(stderr, "Usage: ./kv_transfer_bench <src host:port> <dst host:port> [num_keys] [value_size] [legacy_keys]\n");
+        return 1;
+    }
+    Node src(argv[1]), dst(argv[2]);
+    size_t num_keys = argc > 3 ? std::stoull(argv[3]) : 500000;
+    size_t value_size = argc > 4 ? std::stoull(argv[4]) : 100;
+    size_t legacy_keys = argc > 5 ? std::stoull(argv[5]) : std::min<size_t>(num_keys, 20000);
+
+    std::printf("--- KV Transfer Bench: %zu keys (bulk), %zu keys (per-key), %zu-byte values ---\n", num_keys,
+                legacy_keys, value_size);
+    std::printf("%-10s %10s %12s %10s %10s\n", "path", "keys", "keys/s", "MB/s", "seconds");
+
+    // 1. BULK PATH
+    src.cli.Post("/reset");
+    dst.cli.Post("/reset");
+    if (!preload(src, num_keys, value_size)) { std::fprintf(stderr, "[Bench] Preload failed\n"); return 1; }
+
+    size_t moved = 0, bytes = 0;
+    auto t0 = clock_type::now();
+    for (const HashRange& half : kHalves) {
+        auto res = src.cli.Get("/range_export", range_params(half), httplib::Headers());
+        if (!res || res->status != 200 || !post_batches(dst, res->body)) {
+            std::fprintf(stderr, "[Bench] Bulk transfer failed\n");
+            return 1;
+        }
+        src.cli.Post("/range_delete", range_params(half));
+
+        size_t pos = 0, used;
+        WalRecord rec;
+        while (pos < res->body.size() &&
+               decode_wal_record(res->body.data() + pos, res->body.size() - pos, rec, used, false) == WalDecode::Ok) {
+            bytes += rec.key.size() + rec.value.size();
+            moved++;
+            pos += used;
+        }
+    }
+    report("bulk", moved, bytes, std::chrono::duration<double>(clock_type::now() - t0).count());
+
+    // 2. PER-KEY PATH (the original migration loop)
+    src.cli.Post("/reset");
+    dst.cli.Post("/reset");
+    if (!preload(src, legacy_keys, value_size)) { std::fprintf(stderr, "[Bench] Preload failed\n"); return 1; }
+
+    moved = bytes = 0;
+    t0 = clock_type::now();
+    for (const HashRange& half : kHalves) {
+        std::string path = "/range?start=" + std::to_string(half.start) + "&end=" + std::to_string(half.end);
+        auto res = src.cli.Get(path.c_str());
+        if (!res || res->status != 200) { std::fprintf(stderr, "[Bench] /range failed\n"); return 1; }
+        std::stringstream ss(res->body);
+        std::string key, val;
+        while (std::getline(ss, key) && std::getline(ss, val)) {
+            if (dst.cli.Post("/put", httplib::Params{{"key", key}, {"val", val}})) {
+                src.cli.Post("/del", httplib::Params{{"key", key}});
+                bytes += key.size() + val.size();
+                moved++;
+            }
+        }
+    }
+    report("per-key", moved, bytes, std::chrono::duration<double>(clock_type::now() - t0).count());
+
+    dst.cli.Post("/reset");
+    return 0;
+}
@@ -0,0 +1,85 @@
+#include "../../include/hash_ring.hpp"
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+// Before/after comparison of proxy routing:
+// the original std::map<size_t, std::string> ring vs the flat ring.
+// Usage: ./ring_bench [num_lookups] [max_nodes]
+
+// --- BASELINE: the original map-based ring ---
+class MapRing {
+public:
+    explicit MapRing(int v_nodes) : virtual_nodes_(v_nodes) {}
+
+    void addNode(const std::string& node_address) {
+        for (int i = 0; i < virtual_nodes_; ++i) {
+            ring_[ConsistentHashRing::hash_key(node_address + "#" + std::to_string(i))] = node_address;
+        }
+    }
+
+    std::string getNode(const std::string& key) const {
+        if (ring_.empty()) return "";
+        auto it = ring_.lower_bound(ConsistentHashRing::hash_key(key));
+        if (it == ring_.end()) it = ring_.begin();
+        return it->second;
+    }
+
+private:
+    std::map<size_t, std::string> ring_;
+    int virtual_nodes_;
+};
+
+template <typename Fn>
+double ns_per_op(size_t n, Fn fn) {
+    auto t0 = std::chrono::steady_clock::now();
+    fn();
+    auto t1 = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::nano>(t1 - t0).count() / n;
+}
+
+int main(int argc, char* argv[]) {
+    size_t num_lookups = argc > 1 ? std::stoull(argv[1]) : 2000000;
+    size_t max_nodes = argc > 2 ? std::stoull(argv[2]) : 256;
+
+    std::vector<std::string> keys;
+    keys.reserve(num_lookups);
+    for (size_t i = 0; i < num_lookups; ++i) keys.push_back("user:" + std::to_string(i * 7919));
+
+    std::printf("--- Ring Bench: %zu lookups, 200 vnodes/node ---\n", num_lookups);
+    std::printf("%8s %10s %14s %14s %14s\n", "nodes", "vnodes", "map ns/op", "flat ns/op", "flat id ns/op");
+
+    for (size_t nodes = 4; nodes <= max_nodes; nodes *= 4) {
+        MapRing map_ring(200);
+        ConsistentHashRing flat_ring(200);
+        for (size_t n = 0; n < nodes; ++n) {
+            std::string address = "10.0." + std::to_string(n / 256) + "." + std::to_string(n % 256) + ":8081";
+            map_ring.addNode(address);
+            flat_ring.addNode(address);
+        }
+
+        size_t sink = 0;
+        double map_ns = ns_per_op(num_lookups, [&] {
+            for (const auto& k : keys) sink += map_ring.getNode(k).size();
+        });
+        double flat_ns = ns_per_op(num_lookups, [&] {
+            for (const auto& k : keys) sink += flat_ring.getNode(k).size();
+        });
+        double id_ns = ns_per_op(num_lookups, [&] {
+            for (const auto& k : keys) sink += flat_ring.getNodeId(k);
+        });
+
+        size_t mismatches = 0;
+        for (size_t i = 0; i < keys.size(); i += 97) {
+            if (map_ring.getNode(keys[i]) != flat_ring.getNode(keys[i])) ++mismatches;
+        }
+        if (mismatches) std::cerr << "[Bench] Warning: " << mismatches << " routing mismatches\n";
+
+        std::printf("%8zu %10zu %14.1f %14.1f %14.1f\n", nodes, nodes * 200, map_ns, flat_ns, id_ns);
+        if (sink == 42) std::printf(" ");
+    }
+    return 0;
+}
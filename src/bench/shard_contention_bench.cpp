@@ -0,0 +1,109 @@
+#include "../../include/shard_store.hpp"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <mutex>
+#include <random>
+#include <shared_mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// GET scaling under contention: exclusive mutex (old server) vs shared_mutex
+// read path on 16 shards, and the server's ShardStore at its default
+// core-count-derived shard count, from 1 to 64 threads.
+// Usage: ./shard_contention_bench [keys] [write_percent] [millis_per_run]
+
+const int NUM_SHARDS = 16;
+
+template <typename Mutex>
+struct Shards {
+    FlatStringMap maps[NUM_SHARDS];
+    Mutex mutexes[NUM_SHARDS];
+};
+
+size_t shard_of(const std::string& key) { return std::hash<std::string>{}(key) % NUM_SHARDS; }
+
+struct StoreShards {
+    ShardStore store;
+};
+
+// Accessors giving the fixed arrays and ShardStore the same shape.
+template <typename Mutex>
+size_t id_of(Shards<Mutex>&, const std::string& key) { return shard_of(key); }
+template <typename Mutex>
+FlatStringMap& map_of(Shards<Mutex>& s, size_t id) { return s.maps[id]; }
+template <typename Mutex>
+Mutex& mutex_of(Shards<Mutex>& s, size_t id) { return s.mutexes[id]; }
+
+size_t id_of(StoreShards& s, const std::string& key) { return s.store.shardId(key); }
+FlatStringMap& map_of(StoreShards& s, size_t id) { return s.store.shard(id).map; }
+std::shared_mutex& mutex_of(StoreShards& s, size_t id) { return s.store.shard(id).mutex; }
+
+template <typename Mutex, typename ReadLock, typename Store>
+double run(Store& shards, const std::vector<std::string>& keys,
+           int threads, int write_percent, int millis) {
+    std::atomic<bool> stop{false};
+    std::atomic<uint64_t> total{0};
+    std::vector<std::thread> workers;
+
+    for (int t = 0; t < threads; ++t) {
+        workers.emplace_back([&, t] {
+            std::mt19937_64 rng(t + 1);
+            uint64_t ops = 0;
+            size_t sink = 0;
+            while (!stop.load(std::memory_order_relaxed)) {
+                const std::string& key = keys[rng() % keys.size()];
+                size_t id = id_of(shards, key);
+                if (static_cast<int>(rng() % 100) < write_percent) {
+                    std::lock_guard<Mutex> lock(mutex_of(shards, id));
+                    map_of(shards, id).insertOrAssign(key, "updated");
+                } else {
+                    ReadLock lock(mutex_of(shards, id));
+                    const std::string* val = map_of(shards, id).find(key);
+                    if (val) sink += val->size();
+                }
+                ++ops;
+            }
+            total += ops + (sink == 0);
+        });
+    }
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(millis));
+    stop = true;
+    for (auto& w : workers) w.join();
+    return total.load() / (millis * 1000.0);
+}
+
+template <typename Store>
+void fill(Store& shards, const std::vector<std::string>& keys) {
+    for (const auto& k : keys) map_of(shards, id_of(shards, k)).insertOrAssign(k, "value-0123456789");
+}
+
+int main(int argc, char* argv[]) {
+    size_t num_keys = argc > 1 ? std::stoull(argv[1]) : 100000;
+    int write_percent = argc > 2 ? std::stoi(argv[2]) : 5;
+    int millis = argc > 3 ? std::stoi(argv[3]) : 500;
+
+    std::vector<std::string> keys;
+    for (size_t i = 0; i < num_keys; ++i) keys.push_back("user:" + std::to_string(i));
+
+    Shards<std::mutex> exclusive;
+    Shards<std::shared_mutex> shared;
+    StoreShards store;
+    fill(exclusive, keys);
+    fill(shared, keys);
+    fill(store, keys);
+
+    std::printf("--- Shard Contention Bench: %zu keys, %d%% writes, %u hw threads, store has %zu shards ---\n",
+                num_keys, write_percent, std::thread::hardware_concurrency(), store.store.shardCount());
+    std::printf("%8s %16s %16s %16s\n", "threads", "mutex Mop/s", "shared Mop/s", "store Mop/s");
+    for (int threads = 1; threads <= 64; threads *= 2) {
+        double a = run<std::mutex, std::lock_guard<std::mutex>>(exclusive, keys, threads, write_percent, millis);
+        double b = run<std::shared_mutex, std::shared_lock<std::shared_mutex>>(shared, keys, threads, write_percent, millis);
+        double c = run<std::shared_mutex, std::shared_lock<std::shared_mutex>>(store, keys, threads, write_percent, millis);
+        std::printf("%8d %16.2f %16.2f %16.2f\n", threads, a, b, c);
+    }
+    return 0;
+}
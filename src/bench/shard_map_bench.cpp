@@ -0,0 +1,105 @@
+#include "../../include/flat_map.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Before/after comparison of the server's shard map:
+// std::unordered_map<string, string> vs FlatStringMap.
+// Usage: ./shard_map_bench [num_keys] [value_size]
+
+// --- ALLOCATION ACCOUNTING ---
+// Every allocation carries a 16-byte header with its size so live heap bytes
+// can be measured exactly, independent of the allocator.
+static std::atomic<long long> g_live_bytes{0};
+
+void* operator new(size_t size) {
+    void* raw = std::malloc(size + 16);
+    if (!raw) throw std::bad_alloc();
+    *static_cast<size_t*>(raw) = size;
+    g_live_bytes += static_cast<long long>(size);
+    return static_cast<char*>(raw) + 16;
+}
+
+void operator delete(void* p) noexcept {
+    if (!p) return;
+    char* raw = static_cast<char*>(p) - 16;
+    g_live_bytes -= static_cast<long long>(*reinterpret_cast<size_t*>(raw));
+    std::free(raw);
+}
+
+void operator delete(void* p, size_t) noexcept { operator delete(p); }
+
+// --- WORKLOAD ---
+struct Result {
+    double put_mops;
+    double get_mops;
+    double bytes_per_entry;
+};
+
+template <typename Map, typename PutFn, typename GetFn>
+Result run(const std::vector<std::string>& keys, const std::vector<size_t>& order,
+           const std::string& value, PutFn put, GetFn get) {
+    using clock = std::chrono::steady_clock;
+    Result r{};
+
+    long long before = g_live_bytes.load();
+    Map* map = new Map();
+
+    auto t0 = clock::now();
+    for (const auto& k : keys) put(*map, k, value);
+    auto t1 = clock::now();
+
+    r.bytes_per_entry = double(g_live_bytes.load() - before) / keys.size();
+
+    size_t hits = 0;
+    auto t2 = clock::now();
+    for (size_t i : order) hits += get(*map, keys[i]);
+    auto t3 = clock::now();
+    if (hits != order.size()) std::cerr << "[Bench] Warning: " << order.size() - hits << " misses\n";
+
+    r.put_mops = keys.size() / std::chrono::duration<double, std::micro>(t1 - t0).count();
+    r.get_mops = order.size() / std::chrono::duration<double, std::micro>(t3 - t2).count();
+    delete map;
+    return r;
+}
+
+void print(const char* name, const Result& r) {
+    std::printf("%-24s %10.2f %10.2f %14.1f\n", name, r.put_mops, r.get_mops, r.bytes_per_entry);
+}
+
+int main(int argc, char* argv[]) {
+    size_t num_keys = argc > 1 ? std::stoull(argv[1]) : 1000000;
+    size_t value_size = argc > 2 ? std::stoull(argv[2]) : 16;
+
+    std::vector<std::string> keys;
+    keys.reserve(num_keys);
+    for (size_t i = 0; i < num_keys; ++i) keys.push_back("user:" + std::to_string(i));
+
+    std::vector<size_t> order(num_keys);
+    for (size_t i = 0; i < num_keys; ++i) order[i] = i;
+    std::shuffle(order.begin(), order.end(), std::mt19937_64(42));
+
+    std::string value(value_size, 'v');
+
+    std::printf("--- Shard Map Bench: %zu keys, %zu-byte values ---\n", num_keys, value_size);
+    std::printf("%-24s %10s %10s %14s\n", "map", "PUT Mop/s", "GET Mop/s", "bytes/entry");
+
+    using StdMap = std::unordered_map<std::string, std::string>;
+    print("unordered_map", run<StdMap>(keys, order, value,
+        [](StdMap& m, const std::string& k, const std::string& v) { m[k] = v; },
+        [](StdMap& m, const std::string& k) { return m.find(k) != m.end() ? 1 : 0; }));
+
+    print("FlatStringMap", run<FlatStringMap>(keys, order, value,
+        [](FlatStringMap& m, const std::string& k, const std::string& v) { m.insertOrAssign(k, v); },
+        [](FlatStringMap& m, const std::string& k) { return m.find(k) ? 1 : 0; }));
+
+    return 0;
+}
@@ -0,0 +1,66 @@
+#include "../../include/file_util.hpp"
+#include "../../include/shard_store.hpp"
+#include "../../include/wal_format.hpp"
+#include "../../include/wal_replay.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Cold-start recovery time vs WAL size and replay thread count.
+// Usage: ./wal_replay_bench [max_records] [value_size] [max_threads]
+//
+// Each WAL holds 90% SETs and 10% DELs over a key space of records/4, so
+// replay exercises overwrites as well as inserts.
+
+std::string build_wal(size_t records, size_t value_size) {
+    std::string wal = wal_file_header();
+    std::mt19937_64 rng(7);
+    std::string value(value_size, 'v');
+    size_t key_space = std::max<size_t>(1, records / 4);
+    for (size_t i = 0; i < records; ++i) {
+        std::string key = "user:" + std::to_string(rng() % key_space);
+        if (rng() % 10 == 0) encode_wal_record(wal, WalOp::Del, key);
+        else encode_wal_record(wal, WalOp::Set, key, value);
+    }
+    return wal;
+}
+
+int main(int argc, char* argv[]) {
+    size_t max_records = argc > 1 ? std::stoull(argv[1]) : 4000000;
+    size_t value_size = argc > 2 ? std::stoull(argv[2]) : 32;
+    unsigned max_threads = argc > 3 ? std::stoul(argv[3]) : std::max(1u, std::thread::hardware_concurrency());
+    const std::string path = "wal_replay_bench.tmp";
+
+    std::printf("--- WAL Replay Bench: up to %zu records, %zu-byte values ---\n", max_records, value_size);
+    std::printf("%12s %10s %8s %12s %12s %12s\n", "records", "MB", "threads", "ms", "MB/s", "Mrec/s");
+
+    for (size_t records = std::max<size_t>(1, max_records / 16); records <= max_records; records *= 4) {
+        std::string wal = build_wal(records, value_size);
+        int fd = file_open_trunc(path);
+        file_write_all(fd, wal.data(), wal.size());
+        file_close(fd);
+        double mb = wal.size() / 1e6;
+        wal.clear();
+        wal.shrink_to_fit();
+
+        for (unsigned threads = 1; threads <= max_threads; threads *= 2) {
+            ShardStore store;
+            MappedFile file;
+            file.open(path);
+
+            auto t0 = std::chrono::steady_clock::now();
+            ReplayResult r = replay_records(store, file.data(), file.size(), kWalHeaderSize, threads);
+            auto t1 = std::chrono::steady_clock::now();
+
+            double ms = std::chrono::duration<double, std::milli>(t1 - t0).count();
+            std::printf("%12llu %10.1f %8u %12.1f %12.1f %12.2f\n", static_cast<unsigned long long>(r.records), mb,
+                        threads, ms, mb / (ms / 1000), r.records / (ms * 1000));
+        }
+    }
+    std::remove(path.c_str());
+    return 0;
+}
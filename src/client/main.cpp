@@ -1,6 +1,11 @@
+#include "../../include/batch_codec.hpp"
 #include "../../include/httplib.h"
+#include <chrono>
+#include <cstdio>
 #include <iostream>
+#include <sstream>
 #include <string>
+#include <thread>
 #include <vector>
 
 int main() {
@@ -9,7 +14,7 @@ int main() {
 
     std::string command;
     std::cout << "--- Distributed KV Store Client ---\n";
-    std::cout << "Commands: SET k v | GET k | DEL k | ADD host | REMOVE host\n";
+    std::cout << "Commands: SET k v | GET k | DEL k | MGET k1 k2 ... | MSET k1 v1 k2 v2 ... | ADD host | REMOVE host | JOB id | CANCEL id | RESUME id\n";
 
     while (true) {
         std::cout << "> ";
@@ -32,21 +37,70 @@ int main() {
             if (res) std::cout << res->body << "\n";
             else std::cout << "Error: Proxy unreachable\n";
         }
-        else if (command == "ADD") {
-            std::string host;
-            std::cin >> host;
-            httplib::Params params;
-            params.emplace("host", host);
-            auto res = proxy.Post("/add_node", params);
-            if (res) std::cout << res->body << "\n";
-            else std::cout << "Error: Proxy unreachable\n";
+        else if (command == "MGET" || command == "MSET") {
+            // One round trip for the whole line
+            std::string line, word;
+            std::getline(std::cin, line);
+            std::stringstream ss(line);
+            std::vector<std::string> words;
+            while (ss >> word) words.push_back(word);
+
+            std::vector<std::string_view> keys, values;
+            for (size_t i = 0; i < words.size(); ++i) {
+                if (command == "MSET" && i % 2 == 1) values.push_back(words[i]);
+                else keys.push_back(words[i]);
+            }
+            if (values.size() < keys.size() && command == "MSET") keys.pop_back();
+
+            std::string body;
+            if (command == "MGET") encode_batch_keys(body, keys);
+            else encode_batch_pairs(body, keys, values);
+            auto res = proxy.Post(command == "MGET" ? "/mget" : "/mput", body, "application/octet-stream");
+            std::vector<BatchResult> results;
+            if (!res || !decode_batch_results(res->body, results)) {
+                std::cout << "Error: Proxy unreachable\n";
+                continue;
+            }
+            for (size_t i = 0; i < results.size(); ++i) {
+                std::cout << keys[i] << ": ";
+                if (results[i].status == BatchStatus::Found) std::cout << results[i].value << "\n";
+                else if (results[i].status == BatchStatus::Ok) std::cout << "OK\n";
+                else if (results[i].status == BatchStatus::Missing) std::cout << "(not found)\n";
+                else std::cout << "(error)\n";
+            }
         }
-        else if (command == "REMOVE") {
+        else if (command == "ADD" || command == "REMOVE") {
+            // Queues a job on the proxy, then follows it until it stops
             std::string host;
             std::cin >> host;
             httplib::Params params;
             params.emplace("host", host);
-            auto res = proxy.Post("/remove_node", params);
+            auto res = proxy.Post(command == "ADD" ? "/add_node" : "/remove_node", params);
+            if (!res) {
+                std::cout << "Error: Proxy unreachable\n";
+                continue;
+            }
+            std::cout << res->body << "\n";
+            unsigned long long id;
+            if (res->status != 202 || std::sscanf(res->body.c_str(), "Accepted: job %llu", &id) != 1) continue;
+            std::string path = "/jobs/" + std::to_string(id);
+            while (true) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(500));
+                auto job = proxy.Get(path);
+                if (!job || job->status != 200) break;
+                if (job->body.find("state done") != std::string::npos ||
+                    job->body.find("state failed") != std::string::npos ||
+                    job->body.find("state cancelled") != std::string::npos) {
+                    std::cout << job->body;
+                    break;
+                }
+            }
+        }
+        else if (command == "JOB" || command == "CANCEL" || command == "RESUME") {
+            std::string id;
+            std::cin >> id;
+            std::string path = "/jobs/" + id;
+            auto res = command == "JOB" ? proxy.Get(path) : proxy.Post(path + (command == "CANCEL" ? "/cancel" : "/resume"));
             if (res) std::cout << res->body << "\n";
             else std::cout << "Error: Proxy unreachable\n";
         }
@@ -0,0 +1,91 @@
+#include "../../include/batch_codec.hpp"
+#include "../../include/wal_format.hpp"
+
+namespace {
+void put_bytes(std::string& out, std::string_view s) {
+    put_varint(out, s.size());
+    out.append(s.data(), s.size());
+}
+
+bool get_bytes(const char*& p, const char* end, std::string_view& s) {
+    uint64_t len;
+    if (!get_varint(p, end, len) || len > static_cast<uint64_t>(end - p)) return false;
+    s = std::string_view(p, static_cast<size_t>(len));
+    p += len;
+    return true;
+}
+
+// Reads the item count, rejecting counts the body could not possibly hold.
+bool get_count(const char*& p, const char* end, uint64_t& count) {
+    return get_varint(p, end, count) && count <= static_cast<uint64_t>(end - p);
+}
+} // namespace
+
+void encode_batch_keys(std::string& out, const std::vector<std::string_view>& keys) {
+    put_varint(out, keys.size());
+    for (auto key : keys) put_bytes(out, key);
+}
+
+bool decode_batch_keys(std::string_view body, std::vector<std::string_view>& keys) {
+    const char* p = body.data();
+    const char* end = p + body.size();
+    uint64_t count;
+    if (!get_count(p, end, count)) return false;
+    keys.resize(count);
+    for (auto& key : keys) {
+        if (!get_bytes(p, end, key)) return false;
+    }
+    return p == end;
+}
+
+void encode_batch_pairs(std::string& out, const std::vector<std::string_view>& keys,
+                        const std::vector<std::string_view>& values) {
+    put_varint(out, keys.size());
+    for (size_t i = 0; i < keys.size(); ++i) {
+        put_bytes(out, keys[i]);
+        put_bytes(out, values[i]);
+    }
+}
+
+bool decode_batch_pairs(std::string_view body, std::vector<std::string_view>& keys,
+                        std::vector<std::string_view>& values) {
+    const char* p = body.data();
+    const char* end = p + body.size();
+    uint64_t count;
+    if (!get_count(p, end, count)) return false;
+    keys.resize(count);
+    values.resize(count);
+    for (size_t i = 0; i < count; ++i) {
+        if (!get_bytes(p, end, keys[i]) || !get_bytes(p, end, values[i])) return false;
+    }
+    return p == end;
+}
+
+void encode_batch_results(std::string& out, const std::vector<BatchResult>& results) {
+    put_varint(out, results.size());
+    for (const auto& r : results) {
+        out.push_back(static_cast<char>(r.status));
+        if (r.status == BatchStatus::Found) put_bytes(out, r.value);
+    }
+}
+
+bool decode_batch_results(std::string_view body, std::vector<BatchResult>& results) {
+    const char* p = body.data();
+    const char* end = p + body.size();
+    uint64_t count;
+    if (!get_count(p, end, count)) return false;
+    results.resize(count);
+    for (auto& r : results) {
+        if (p == end) return false;
+        uint8_t status = static_cast<uint8_t>(*p++);
+        if (status > static_cast<uint8_t>(BatchStatus::Error)) return false;
+        r.status = static_cast<BatchStatus>(status);
+        r.value.clear();
+        if (r.status == BatchStatus::Found) {
+            std::string_view v;
+            if (!get_bytes(p, end, v)) return false;
+            r.value.assign(v.data(), v.size());
+        }
+    }
+    return p == end;
+}
@@ -0,0 +1,57 @@
+#include "../../include/binary_protocol.hpp"
+#include "../../include/wal_format.hpp"
+
+namespace {
+void put_u32(std::string& out, uint32_t v) {
+    for (int i = 0; i < 4; ++i) out.push_back(static_cast<char>((v >> (8 * i)) & 0xFF));
+}
+
+uint32_t get_u32(const char* p) {
+    uint32_t v = 0;
+    for (int i = 0; i < 4; ++i) v |= static_cast<uint32_t>(static_cast<unsigned char>(p[i])) << (8 * i);
+    return v;
+}
+} // namespace
+
+const char* bin_op_name(uint8_t code) {
+    static const char* names[] = {"ping", "get", "put", "del", "mget", "mput", "mdel"};
+    return code < sizeof(names) / sizeof(names[0]) ? names[code] : "other";
+}
+
+void encode_frame(std::string& out, uint32_t id, uint8_t code, std::string_view payload) {
+    put_u32(out, static_cast<uint32_t>(kFrameHeaderSize - 4 + payload.size()));
+    put_u32(out, id);
+    out.push_back(static_cast<char>(code));
+    out.append(payload.data(), payload.size());
+}
+
+FrameDecode decode_frame(const char* data, size_t len, Frame& frame, size_t& consumed) {
+    if (len < 4) return FrameDecode::Incomplete;
+    uint32_t body = get_u32(data);
+    if (body < kFrameHeaderSize - 4 || body > kMaxFrameBody) return FrameDecode::TooLarge;
+    if (len - 4 < body) return FrameDecode::Incomplete;
+    frame.id = get_u32(data + 4);
+    frame.code = static_cast<uint8_t>(data[8]);
+    frame.payload = std::string_view(data + kFrameHeaderSize, body - (kFrameHeaderSize - 4));
+    consumed = 4 + body;
+    return FrameDecode::Ok;
+}
+
+std::string encode_put_payload(std::string_view key, std::string_view value) {
+    std::string out;
+    out.reserve(key.size() + value.size() + 5);
+    put_varint(out, key.size());
+    out.append(key.data(), key.size());
+    out.append(value.data(), value.size());
+    return out;
+}
+
+bool decode_put_payload(std::string_view payload, std::string_view& key, std::string_view& value) {
+    const char* p = payload.data();
+    const char* end = p + payload.size();
+    uint64_t len;
+    if (!get_varint(p, end, len) || len > static_cast<uint64_t>(end - p)) return false;
+    key = std::string_view(p, static_cast<size_t>(len));
+    value = std::string_view(p + len, static_cast<size_t>(end - p - len));
+    return true;
+}
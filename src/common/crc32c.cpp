@@ -0,0 +1,125 @@
+#include "../../include/crc32c.hpp"
+#include <cstring>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define KV_CRC32C_X86 1
+#include <nmmintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#endif
+#elif defined(__aarch64__) && defined(__ARM_FEATURE_CRC32)
+#define KV_CRC32C_ARM 1
+#include <arm_acle.h>
+#endif
+
+namespace {
+
+// --- PORTABLE SLICE-BY-8 KERNEL ---
+const uint32_t kPoly = 0x82F63B78u;  // Reflected Castagnoli polynomial
+
+struct Tables {
+    uint32_t t[8][256];
+    Tables() {
+        for (uint32_t i = 0; i < 256; ++i) {
+            uint32_t c = i;
+            for (int k = 0; k < 8; ++k) c = (c >> 1) ^ (kPoly & (0u - (c & 1u)));
+            t[0][i] = c;
+        }
+        for (uint32_t i = 0; i < 256; ++i) {
+            for (int s = 1; s < 8; ++s) t[s][i] = (t[s - 1][i] >> 8) ^ t[0][t[s - 1][i] & 0xFF];
+        }
+    }
+};
+
+const Tables& tables() {
+    static const Tables instance;
+    return instance;
+}
+
+uint32_t crc32c_table(const unsigned char* p, size_t len, uint32_t crc) {
+    const auto& t = tables().t;
+    while (len >= 8) {
+        uint32_t lo, hi;
+        std::memcpy(&lo, p, 4);
+        std::memcpy(&hi, p + 4, 4);
+        lo ^= crc;  // Assumes little-endian, like the rest of the on-disk format
+        crc = t[7][lo & 0xFF] ^ t[6][(lo >> 8) & 0xFF] ^ t[5][(lo >> 16) & 0xFF] ^ t[4][lo >> 24] ^
+              t[3][hi & 0xFF] ^ t[2][(hi >> 8) & 0xFF] ^ t[1][(hi >> 16) & 0xFF] ^ t[0][hi >> 24];
+        p += 8;
+        len -= 8;
+    }
+    while (len--) crc = (crc >> 8) ^ t[0][(crc ^ *p++) & 0xFF];
+    return crc;
+}
+
+// --- HARDWARE KERNELS ---
+#ifdef KV_CRC32C_X86
+#if defined(__GNUC__) || defined(__clang__)
+__attribute__((target("sse4.2")))
+#endif
+uint32_t crc32c_sse42(const unsigned char* p, size_t len, uint32_t crc) {
+    uint64_t c = crc;
+    while (len >= 8) {
+        uint64_t v;
+        std::memcpy(&v, p, 8);
+        c = _mm_crc32_u64(c, v);
+        p += 8;
+        len -= 8;
+    }
+    uint32_t c32 = static_cast<uint32_t>(c);
+    while (len--) c32 = _mm_crc32_u8(c32, *p++);
+    return c32;
+}
+
+bool cpu_has_sse42() {
+#if defined(_MSC_VER) && !defined(__clang__)
+    int info[4];
+    __cpuid(info, 1);
+    return (info[2] & (1 << 20)) != 0;
+#else
+    return __builtin_cpu_supports("sse4.2");
+#endif
+}
+#endif
+
+#ifdef KV_CRC32C_ARM
+uint32_t crc32c_armv8(const unsigned char* p, size_t len, uint32_t crc) {
+    while (len >= 8) {
+        uint64_t v;
+        std::memcpy(&v, p, 8);
+        crc = __crc32cd(crc, v);
+        p += 8;
+        len -= 8;
+    }
+    while (len--) crc = __crc32cb(crc, *p++);
+    return crc;
+}
+#endif
+
+using Kernel = uint32_t (*)(const unsigned char*, size_t, uint32_t);
+
+struct Dispatch {
+    Kernel fn = crc32c_table;
+    const char* name = "table";
+    Dispatch() {
+#if defined(KV_CRC32C_X86)
+        if (cpu_has_sse42()) { fn = crc32c_sse42; name = "sse4.2"; }
+#elif defined(KV_CRC32C_ARM)
+        fn = crc32c_armv8;
+        name = "armv8";
+#endif
+    }
+};
+
+const Dispatch& dispatch() {
+    static const Dispatch instance;
+    return instance;
+}
+
+} // namespace
+
+uint32_t crc32c(const void* data, size_t len, uint32_t crc) {
+    return ~dispatch().fn(static_cast<const unsigned char*>(data), len, ~crc);
+}
+
+const char* crc32c_kernel() { return dispatch().name; }
@@ -0,0 +1,139 @@
+#include "../../include/file_util.hpp"
+#include "../../include/logger.hpp"
+#include <cerrno>
+#include <cstring>
+
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#include <sys/stat.h>
+#include <fstream>
+#include <iterator>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+int file_open_append(const std::string& path) {
+#ifdef _WIN32
+    return _open(path.c_str(), _O_WRONLY | _O_CREAT | _O_APPEND | _O_BINARY, _S_IREAD | _S_IWRITE);
+#else
+    return ::open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+#endif
+}
+
+int file_open_trunc(const std::string& path) {
+#ifdef _WIN32
+    return _open(path.c_str(), _O_WRONLY | _O_CREAT | _O_TRUNC | _O_BINARY, _S_IREAD | _S_IWRITE);
+#else
+    return ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+#endif
+}
+
+bool file_write_all(int fd, const char* data, size_t len) {
+    while (len > 0) {
+#ifdef _WIN32
+        long n = _write(fd, data, static_cast<unsigned>(len));
+#else
+        long n = static_cast<long>(::write(fd, data, len));
+#endif
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            LOG_ERROR << "[File] Write failed: " << std::strerror(errno);
+            return false;
+        }
+        data += n;
+        len -= static_cast<size_t>(n);
+    }
+    return true;
+}
+
+bool file_sync(int fd) {
+#if defined(_WIN32)
+    bool ok = _commit(fd) == 0;
+#elif defined(__APPLE__)
+    bool ok = ::fsync(fd) == 0;
+#else
+    bool ok = ::fdatasync(fd) == 0;
+#endif
+    if (!ok) LOG_ERROR << "[File] fdatasync failed: " << std::strerror(errno);
+    return ok;
+}
+
+bool file_truncate(int fd, uint64_t size) {
+#ifdef _WIN32
+    return _chsize_s(fd, static_cast<__int64>(size)) == 0;
+#else
+    return ::ftruncate(fd, static_cast<off_t>(size)) == 0;
+#endif
+}
+
+int64_t file_size(int fd) {
+#ifdef _WIN32
+    return _lseeki64(fd, 0, SEEK_END);
+#else
+    return static_cast<int64_t>(::lseek(fd, 0, SEEK_END));
+#endif
+}
+
+void file_close(int fd) {
+#ifdef _WIN32
+    _close(fd);
+#else
+    ::close(fd);
+#endif
+}
+
+void file_sync_parent_dir(const std::string& path) {
+#ifndef _WIN32
+    size_t slash = path.find_last_of('/');
+    std::string dir = slash == std::string::npos ? "." : path.substr(0, slash + 1);
+    int fd = ::open(dir.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return;
+    ::fsync(fd);
+    ::close(fd);
+#else
+    (void)path;
+#endif
+}
+
+// --- MAPPED FILE ---
+
+bool MappedFile::open(const std::string& path) {
+    close();
+#ifdef _WIN32
+    std::ifstream in(path, std::ios::binary);
+    if (!in.is_open()) return false;
+    buffer_.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    data_ = buffer_.data();
+    size_ = buffer_.size();
+    return true;
+#else
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return false;
+    struct stat st;
+    if (::fstat(fd, &st) != 0) { ::close(fd); return false; }
+    size_ = static_cast<size_t>(st.st_size);
+    if (size_ > 0) {
+        void* p = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (p == MAP_FAILED) { ::close(fd); size_ = 0; return false; }
+        ::madvise(p, size_, MADV_WILLNEED);
+        data_ = static_cast<const char*>(p);
+    }
+    ::close(fd);  // The mapping stays valid
+    return true;
+#endif
+}
+
+void MappedFile::close() {
+#ifdef _WIN32
+    buffer_.clear();
+    buffer_.shrink_to_fit();
+#else
+    if (data_) ::munmap(const_cast<char*>(data_), size_);
+#endif
+    data_ = nullptr;
+    size_ = 0;
+}
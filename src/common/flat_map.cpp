@@ -0,0 +1,292 @@
+#include "../../include/flat_map.hpp"
+#include <functional>
+#include <new>
+#include <utility>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define KV_FLAT_MAP_SSE2 1
+#include <emmintrin.h>
+#endif
+
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#endif
+
+// --- INLINE KEY ---
+
+InlineKey::InlineKey(std::string_view s) : len(static_cast<uint32_t>(s.size())) {
+    if (isInline()) {
+        std::memcpy(buf, s.data(), s.size());
+    } else {
+        char* p = new char[s.size()];
+        std::memcpy(p, s.data(), s.size());
+        std::memcpy(buf, &p, sizeof(p));
+    }
+}
+
+InlineKey::InlineKey(InlineKey&& other) noexcept : len(other.len) {
+    std::memcpy(buf, other.buf, sizeof(buf));
+    other.len = 0;
+}
+
+InlineKey& InlineKey::operator=(InlineKey&& other) noexcept {
+    if (this != &other) {
+        release();
+        len = other.len;
+        std::memcpy(buf, other.buf, sizeof(buf));
+        other.len = 0;
+    }
+    return *this;
+}
+
+void InlineKey::release() {
+    if (!isInline()) delete[] heapPtr();
+    len = 0;
+}
+
+// --- CONTROL BYTES & GROUP PROBING ---
+namespace {
+
+const int8_t kEmpty = -128;   // 0b10000000
+const int8_t kDeleted = -2;   // 0b11111110
+// Full slots store the low 7 bits of the hash (0..127), so "full" == ctrl >= 0.
+
+inline int lowestBit(uint32_t mask) {
+#if defined(_MSC_VER) && !defined(__clang__)
+    unsigned long idx;
+    _BitScanForward(&idx, mask);
+    return static_cast<int>(idx);
+#else
+    return __builtin_ctz(mask);
+#endif
+}
+
+// One probe group: 16 control bytes compared at once.
+struct Group {
+#ifdef KV_FLAT_MAP_SSE2
+    __m128i ctrl;
+    explicit Group(const int8_t* p) : ctrl(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p))) {}
+
+    uint32_t match(int8_t h2) const {
+        return static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(ctrl, _mm_set1_epi8(h2))));
+    }
+    uint32_t matchEmpty() const { return match(kEmpty); }
+    uint32_t matchEmptyOrDeleted() const {
+        // EMPTY and DELETED are the only control values below -1.
+        return static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpgt_epi8(_mm_set1_epi8(-1), ctrl)));
+    }
+#else
+    const int8_t* ctrl;
+    explicit Group(const int8_t* p) : ctrl(p) {}
+
+    uint32_t match(int8_t h2) const {
+        uint32_t mask = 0;
+        for (size_t i = 0; i < FlatStringMap::kGroupWidth; ++i) {
+            if (ctrl[i] == h2) mask |= 1u << i;
+        }
+        return mask;
+    }
+    uint32_t matchEmpty() const { return match(kEmpty); }
+    uint32_t matchEmptyOrDeleted() const {
+        uint32_t mask = 0;
+        for (size_t i = 0; i < FlatStringMap::kGroupWidth; ++i) {
+            if (ctrl[i] < -1) mask |= 1u << i;
+        }
+        return mask;
+    }
+#endif
+};
+
+inline int8_t h2Of(uint64_t hash) { return static_cast<int8_t>(hash & 0x7F); }
+inline uint64_t h1Of(uint64_t hash) { return hash >> 7; }
+
+// Maximum load factor is 7/8.
+inline size_t maxLoad(size_t capacity) { return capacity - capacity / 8; }
+
+// Heap bytes a slot owns beyond the table: a spilled key and a non-SSO value.
+size_t heap_bytes(const FlatStringMap::Slot& s) {
+    size_t bytes = s.key.isInline() ? 0 : s.key.size();
+    const char* data = s.value.data();
+    const char* self = reinterpret_cast<const char*>(&s.value);
+    if (data < self || data >= self + sizeof(std::string)) bytes += s.value.capacity() + 1;
+    return bytes;
+}
+
+} // namespace
+
+// --- FLAT STRING MAP ---
+
+FlatStringMap::~FlatStringMap() { destroyAll(); }
+
+FlatStringMap::FlatStringMap(FlatStringMap&& other) noexcept
+    : ctrl_(other.ctrl_), slots_(other.slots_), capacity_(other.capacity_),
+      size_(other.size_), growth_left_(other.growth_left_), heap_bytes_(other.heap_bytes_) {
+    other.ctrl_ = nullptr;
+    other.slots_ = nullptr;
+    other.capacity_ = other.size_ = other.growth_left_ = other.heap_bytes_ = 0;
+}
+
+FlatStringMap& FlatStringMap::operator=(FlatStringMap&& other) noexcept {
+    if (this != &other) {
+        destroyAll();
+        std::swap(ctrl_, other.ctrl_);
+        std::swap(slots_, other.slots_);
+        std::swap(capacity_, other.capacity_);
+        std::swap(size_, other.size_);
+        std::swap(growth_left_, other.growth_left_);
+        std::swap(heap_bytes_, other.heap_bytes_);
+    }
+    return *this;
+}
+
+size_t FlatStringMap::hashOf(std::string_view key) {
+    // std::hash also picks the server shard, so re-mix it (murmur3 fmix64)
+    // to keep H1/H2 independent of the shard selection bits.
+    uint64_t h = std::hash<std::string_view>{}(key);
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return static_cast<size_t>(h);
+}
+
+size_t FlatStringMap::findIndex(std::string_view key, size_t hash) const {
+    if (capacity_ == 0) return capacity_;
+    const size_t group_mask = capacity_ / kGroupWidth - 1;
+    size_t group = h1Of(hash) & group_mask;
+    const int8_t h2 = h2Of(hash);
+
+    // Triangular probing over aligned groups visits every group exactly once.
+    for (size_t step = 1;; ++step) {
+        const size_t base = group * kGroupWidth;
+        Group g(ctrl_ + base);
+        for (uint32_t bits = g.match(h2); bits; bits &= bits - 1) {
+            size_t idx = base + lowestBit(bits);
+            if (slots_[idx].key.view() == key) return idx;
+        }
+        if (g.matchEmpty()) return capacity_;
+        if (step > group_mask) return capacity_;
+        group = (group + step) & group_mask;
+    }
+}
+
+size_t FlatStringMap::findInsertSlot(size_t hash) const {
+    const size_t group_mask = capacity_ / kGroupWidth - 1;
+    size_t group = h1Of(hash) & group_mask;
+    for (size_t step = 1;; ++step) {
+        const size_t base = group * kGroupWidth;
+        uint32_t bits = Group(ctrl_ + base).matchEmptyOrDeleted();
+        if (bits) return base + lowestBit(bits);
+        group = (group + step) & group_mask;
+    }
+}
+
+std::string* FlatStringMap::find(std::string_view key) {
+    size_t idx = findIndex(key, hashOf(key));
+    return idx == capacity_ ? nullptr : &slots_[idx].value;
+}
+
+const std::string* FlatStringMap::find(std::string_view key) const {
+    size_t idx = findIndex(key, hashOf(key));
+    return idx == capacity_ ? nullptr : &slots_[idx].value;
+}
+
+bool FlatStringMap::insertOrAssign(std::string_view key, std::string value) {
+    if (capacity_ == 0) rehash(kGroupWidth);
+
+    const size_t hash = hashOf(key);
+    size_t idx = findIndex(key, hash);
+    if (idx != capacity_) {
+        Slot& slot = slots_[idx];
+        heap_bytes_ -= heap_bytes(slot);
+        slot.value = std::move(value);
+        heap_bytes_ += heap_bytes(slot);
+        return false;
+    }
+
+    size_t pos = findInsertSlot(hash);
+    if (growth_left_ == 0 && ctrl_[pos] == kEmpty) {
+        // Out of fresh slots: grow if the table is genuinely full, otherwise
+        // rehash in place to reclaim DELETED tombstones.
+        rehash(size_ >= maxLoad(capacity_) / 2 ? capacity_ * 2 : capacity_);
+        pos = findInsertSlot(hash);
+    }
+
+    new (&slots_[pos]) Slot{InlineKey(key), std::move(value)};
+    heap_bytes_ += heap_bytes(slots_[pos]);
+    if (ctrl_[pos] == kEmpty) --growth_left_;
+    ctrl_[pos] = h2Of(hash);
+    ++size_;
+    return true;
+}
+
+bool FlatStringMap::erase(std::string_view key) {
+    size_t idx = findIndex(key, hashOf(key));
+    if (idx == capacity_) return false;
+
+    heap_bytes_ -= heap_bytes(slots_[idx]);
+    slots_[idx].~Slot();
+    --size_;
+
+    // If this group still has an EMPTY byte, no probe sequence ever continued
+    // past it, so the slot can go straight back to EMPTY without a tombstone.
+    const size_t base = idx & ~(kGroupWidth - 1);
+    if (Group(ctrl_ + base).matchEmpty()) {
+        ctrl_[idx] = kEmpty;
+        ++growth_left_;
+    } else {
+        ctrl_[idx] = kDeleted;
+    }
+    return true;
+}
+
+void FlatStringMap::clear() {
+    destroyAll();
+}
+
+void FlatStringMap::reserve(size_t count) {
+    size_t cap = kGroupWidth;
+    while (maxLoad(cap) < count) cap *= 2;
+    if (cap > capacity_) rehash(cap);
+}
+
+size_t FlatStringMap::memoryUsage() const {
+    return capacity_ * (sizeof(int8_t) + sizeof(Slot)) + heap_bytes_;
+}
+
+void FlatStringMap::rehash(size_t new_capacity) {
+    int8_t* old_ctrl = ctrl_;
+    Slot* old_slots = slots_;
+    size_t old_capacity = capacity_;
+
+    // One allocation: control bytes first, slots right after (capacity is a
+    // multiple of 16, so the slot array stays suitably aligned).
+    char* mem = static_cast<char*>(::operator new(new_capacity * (1 + sizeof(Slot))));
+    ctrl_ = reinterpret_cast<int8_t*>(mem);
+    slots_ = reinterpret_cast<Slot*>(mem + new_capacity);
+    capacity_ = new_capacity;
+    std::memset(ctrl_, static_cast<unsigned char>(kEmpty), new_capacity);
+
+    for (size_t i = 0; i < old_capacity; ++i) {
+        if (old_ctrl[i] < 0) continue;
+        const size_t hash = hashOf(old_slots[i].key.view());
+        size_t pos = findInsertSlot(hash);
+        new (&slots_[pos]) Slot(std::move(old_slots[i]));
+        ctrl_[pos] = h2Of(hash);
+        old_slots[i].~Slot();
+    }
+    growth_left_ = maxLoad(capacity_) - size_;
+
+    if (old_ctrl) ::operator delete(old_ctrl);
+}
+
+void FlatStringMap::destroyAll() {
+    for (size_t i = 0; i < capacity_; ++i) {
+        if (ctrl_[i] >= 0) slots_[i].~Slot();
+    }
+    if (ctrl_) ::operator delete(ctrl_);
+    ctrl_ = nullptr;
+    slots_ = nullptr;
+    capacity_ = size_ = growth_left_ = heap_bytes_ = 0;
+}
@@ -0,0 +1,273 @@
+#include "../../include/frame_channel.hpp"
+#include <algorithm>
+#include <arpa/inet.h>
+#include <cerrno>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace {
+constexpr std::chrono::milliseconds kMinBackoff{100};
+constexpr size_t kReadChunk = 64 << 10;
+constexpr int kMaxEvents = 8;
+} // namespace
+
+FrameChannel::FrameChannel(std::string ip, int port, int timeout_s)
+    : ip_(std::move(ip)), port_(port), timeout_s_(timeout_s) {
+    epoll_fd_ = epoll_create1(EPOLL_CLOEXEC);
+    wake_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    epoll_event ev{};
+    ev.events = EPOLLIN | EPOLLET;
+    ev.data.fd = wake_fd_;
+    epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, wake_fd_, &ev);
+    loop_ = std::thread(&FrameChannel::run, this);
+}
+
+FrameChannel::~FrameChannel() {
+    {
+        std::lock_guard<std::mutex> lock(mu_);
+        stop_ = true;
+    }
+    wake();
+    loop_.join();  // The loop fails whatever is still in flight on its way out
+    ::close(wake_fd_);
+    ::close(epoll_fd_);
+}
+
+void FrameChannel::call(BinOp op, std::string_view payload, Callback done) {
+    bool queued = false, first = false;
+    {
+        std::lock_guard<std::mutex> lock(mu_);
+        auto now = Clock::now();
+        if (!stop_ && (state_ != State::Down || now >= retry_at_)) {
+            uint32_t id = next_id_++;
+            if (pending_.empty()) last_progress_ = now;
+            pending_.emplace(id, std::move(done));
+            first = out_.empty();
+            encode_frame(out_, id, static_cast<uint8_t>(op), payload);
+            queued = true;
+        }
+    }
+    if (!queued) done(BinStatus::Unavailable, {});
+    else if (first) wake();  // Later requests ride along with this one
+}
+
+void FrameChannel::wake() {
+    uint64_t one = 1;
+    ssize_t ignored = ::write(wake_fd_, &one, sizeof(one));
+    (void)ignored;
+}
+
+void FrameChannel::run() {
+    epoll_event events[kMaxEvents];
+    while (true) {
+        // 1. Sleep until I/O, a new request or the next deadline
+        int timeout_ms = -1;
+        {
+            std::lock_guard<std::mutex> lock(mu_);
+            if (stop_) break;
+            Clock::time_point deadline;
+            bool timed = true;
+            if (state_ == State::Connecting) deadline = connect_deadline_;
+            else if (state_ == State::Connected && !pending_.empty()) deadline = last_progress_ + std::chrono::seconds(timeout_s_);
+            else timed = false;
+            if (timed) {
+                auto left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - Clock::now()).count();
+                timeout_ms = static_cast<int>(std::max<int64_t>(0, left + 1));
+            }
+        }
+        int n = epoll_wait(epoll_fd_, events, kMaxEvents, timeout_ms);
+        if (n < 0 && errno != EINTR) break;
+
+        // 2. Socket events: connect completion, replies, room to write
+        for (int i = 0; i < n; ++i) {
+            int fd = events[i].data.fd;
+            uint32_t ev = events[i].events;
+            if (fd == wake_fd_) {
+                uint64_t count;
+                while (::read(wake_fd_, &count, sizeof(count)) > 0) {}
+                continue;
+            }
+            if (fd != fd_) continue;  // Closed earlier in this batch
+            if (state_ == State::Connecting) {
+                int err = 0;
+                socklen_t len = sizeof(err);
+                if (getsockopt(fd_, SOL_SOCKET, SO_ERROR, &err, &len) != 0 || err != 0) {
+                    drop();
+                    continue;
+                }
+                if (ev & (EPOLLOUT | EPOLLIN)) onConnected();
+                else continue;
+            }
+            if (ev & EPOLLERR) {
+                drop();
+                continue;
+            }
+            if (ev & (EPOLLIN | EPOLLRDHUP | EPOLLHUP)) onReadable();
+            if (fd_ >= 0 && (ev & EPOLLOUT)) flush();
+        }
+
+        // 3. New requests: connect if there is no connection, else send them
+        bool queued;
+        {
+            std::lock_guard<std::mutex> lock(mu_);
+            queued = !out_.empty();
+        }
+        if (queued && state_ == State::Down) connect();
+        else if (queued && state_ == State::Connected) flush();
+
+        // 4. A connect or a reply that took longer than timeout_s
+        auto now = Clock::now();
+        if (state_ == State::Connecting && now >= connect_deadline_) {
+            drop();
+        } else if (state_ == State::Connected) {
+            bool silent;
+            {
+                std::lock_guard<std::mutex> lock(mu_);
+                silent = !pending_.empty() && now - last_progress_ >= std::chrono::seconds(timeout_s_);
+            }
+            if (silent) drop();
+        }
+    }
+    drop();
+}
+
+// Starts a non-blocking connect; step 2 of the loop sees it complete.
+void FrameChannel::connect() {
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(static_cast<uint16_t>(port_));
+    if (inet_pton(AF_INET, ip_.c_str(), &addr.sin_addr) != 1) {
+        drop();
+        return;
+    }
+    int fd = ::socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        drop();
+        return;
+    }
+    int on = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+    int rc = ::connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr));
+    if (rc != 0 && errno != EINPROGRESS) {
+        ::close(fd);
+        drop();
+        return;
+    }
+
+    epoll_event ev{};
+    ev.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+    ev.data.fd = fd;
+    epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &ev);
+    fd_ = fd;
+    connect_deadline_ = Clock::now() + std::chrono::seconds(timeout_s_);
+    {
+        std::lock_guard<std::mutex> lock(mu_);
+        state_ = State::Connecting;
+    }
+    if (rc == 0) {
+        onConnected();
+        flush();
+    }
+}
+
+void FrameChannel::onConnected() {
+    std::lock_guard<std::mutex> lock(mu_);
+    state_ = State::Connected;
+    backoff_ = std::chrono::milliseconds(0);
+    last_progress_ = Clock::now();  // Requests queued while connecting start their clock now
+}
+
+void FrameChannel::onReadable() {
+    char buf[kReadChunk];
+    while (true) {
+        ssize_t n = ::recv(fd_, buf, sizeof(buf), 0);
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return;
+        if (n <= 0) {
+            drop();
+            return;
+        }
+        in_.append(buf, n);
+
+        size_t pos = 0, used;
+        Frame frame;
+        FrameDecode status;
+        while ((status = decode_frame(in_.data() + pos, in_.size() - pos, frame, used)) == FrameDecode::Ok) {
+            Callback done;
+            {
+                std::lock_guard<std::mutex> lock(mu_);
+                auto it = pending_.find(frame.id);
+                if (it != pending_.end()) {
+                    done = std::move(it->second);
+                    pending_.erase(it);
+                }
+                last_progress_ = Clock::now();
+            }
+            if (done) done(static_cast<BinStatus>(frame.code), frame.payload);
+            pos += used;
+        }
+        if (status == FrameDecode::TooLarge) {
+            drop();
+            return;
+        }
+        in_.erase(0, pos);
+    }
+}
+
+void FrameChannel::flush() {
+    {
+        std::lock_guard<std::mutex> lock(mu_);
+        if (wpos_ == wbuf_.size()) {
+            wbuf_.swap(out_);
+            wpos_ = 0;
+        } else {
+            wbuf_.append(out_);
+        }
+        out_.clear();
+    }
+
+    while (wpos_ < wbuf_.size()) {
+        ssize_t n = ::send(fd_, wbuf_.data() + wpos_, wbuf_.size() - wpos_, MSG_NOSIGNAL);
+        if (n > 0) {
+            wpos_ += n;
+        } else if (n < 0 && errno == EINTR) {
+            continue;
+        } else if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            return;  // EPOLLOUT fires once the socket drains
+        } else {
+            drop();
+            return;
+        }
+    }
+    wbuf_.clear();
+    wpos_ = 0;
+}
+
+// Closes the connection, if any, and fails everything in flight. Calls fail
+// at once until the backoff has passed.
+void FrameChannel::drop() {
+    if (fd_ >= 0) {
+        epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, fd_, nullptr);
+        ::close(fd_);
+        fd_ = -1;
+    }
+    in_.clear();
+    wbuf_.clear();
+    wpos_ = 0;
+
+    std::unordered_map<uint32_t, Callback> failed;
+    {
+        std::lock_guard<std::mutex> lock(mu_);
+        state_ = State::Down;
+        const std::chrono::milliseconds max_backoff = std::chrono::seconds(timeout_s_);
+        backoff_ = backoff_.count() == 0 ? kMinBackoff : std::min(backoff_ * 2, max_backoff);
+        retry_at_ = Clock::now() + backoff_;
+        failed.swap(pending_);
+        out_.clear();
+    }
+    for (auto& entry : failed) entry.second(BinStatus::Unavailable, {});
+}
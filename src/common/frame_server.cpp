@@ -0,0 +1,379 @@
+#include "../../include/frame_server.hpp"
+#include "../../include/logger.hpp"
+#include <algorithm>
+#include <arpa/inet.h>
+#include <cerrno>
+#include <cstring>
+#include <map>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <unordered_map>
+
+namespace {
+// A connection stops reading new requests while this many are unanswered,
+// or while this many reply bytes wait for a slow reader.
+constexpr size_t kMaxInFlight = 4096;
+constexpr size_t kMaxPendingBytes = 8 << 20;
+constexpr size_t kReadChunk = 64 << 10;
+constexpr int kMaxEvents = 256;
+} // namespace
+
+struct FrameServer::Connection {
+    int fd;
+    Loop* loop;
+
+    // Loop thread only
+    std::string in;
+    std::string wbuf;         // Being written; wbuf[wpos..] is still unsent
+    size_t wpos = 0;
+    bool paused = false;      // Stopped reading for backpressure
+    bool peer_closed = false; // Read EOF; close once every reply is out
+    uint64_t next_seq = 0;    // Assigned to the next request
+
+    // Shared with Reply::send
+    std::mutex mu;
+    std::string out;          // Replies not yet picked up by the loop
+    bool scheduled = false;   // Queued on loop->dirty
+    bool closed = false;
+    std::atomic<size_t> in_flight{0};
+    std::atomic<size_t> pending_bytes{0};  // In `out`, `held` or wbuf
+
+    // In-order protocols: replies that finished ahead of an earlier one
+    const bool ordered;
+    uint64_t next_reply = 0;
+    std::map<uint64_t, std::string> held;
+
+    Connection(int f, Loop* l, bool in_order) : fd(f), loop(l), ordered(in_order) {}
+};
+
+struct FrameServer::Loop {
+    int epoll_fd = -1;
+    int listen_fd = -1;
+    int wake_fd = -1;  // eventfd: replies arrived from another thread
+    std::thread thread;
+    std::unordered_map<int, std::shared_ptr<Connection>> conns;
+
+    std::mutex dirty_mu;
+    std::vector<std::shared_ptr<Connection>> dirty;  // Connections with new replies
+};
+
+namespace {
+thread_local const void* tl_current_loop = nullptr;
+
+bool backpressured(size_t in_flight, size_t pending_bytes) {
+    return in_flight >= kMaxInFlight || pending_bytes >= kMaxPendingBytes;
+}
+} // namespace
+
+// --- REPLIES ---
+
+template <typename Append>
+void FrameServer::Reply::deliver(Append&& append) const {
+    Connection& c = *conn_;
+    bool wake = false;
+    {
+        std::lock_guard<std::mutex> lock(c.mu);
+        c.in_flight.fetch_sub(1, std::memory_order_relaxed);
+        if (c.closed) return;
+        if (c.ordered && seq_ != c.next_reply) {
+            // An earlier request is still pending; wait behind it
+            std::string& slot = c.held[seq_];
+            append(slot);
+            c.pending_bytes.fetch_add(slot.size(), std::memory_order_relaxed);
+            return;
+        }
+        size_t before = c.out.size();
+        append(c.out);
+        c.pending_bytes.fetch_add(c.out.size() - before, std::memory_order_relaxed);
+        if (c.ordered) {
+            // Release the replies that were waiting on this one
+            auto it = c.held.begin();
+            for (++c.next_reply; it != c.held.end() && it->first == c.next_reply; ++c.next_reply) {
+                c.out += it->second;
+                it = c.held.erase(it);
+            }
+        }
+        wake = !c.scheduled;
+        c.scheduled = true;
+    }
+    if (!wake) return;
+    {
+        std::lock_guard<std::mutex> lock(c.loop->dirty_mu);
+        c.loop->dirty.push_back(conn_);
+    }
+    // The loop drains `dirty` after every pass; only other threads need to wake it.
+    if (tl_current_loop != c.loop) {
+        uint64_t one = 1;
+        ssize_t ignored = ::write(c.loop->wake_fd, &one, sizeof(one));
+        (void)ignored;
+    }
+}
+
+void FrameServer::Reply::send(BinStatus status, std::string_view payload) const {
+    deliver([&](std::string& out) { encode_frame(out, id_, static_cast<uint8_t>(status), payload); });
+}
+
+void FrameServer::Reply::sendRaw(std::string_view bytes) const {
+    deliver([&](std::string& out) { out.append(bytes.data(), bytes.size()); });
+}
+
+// --- LIFECYCLE ---
+
+FrameServer::FrameServer(Handler handler, size_t io_threads)
+    : FrameServer(
+          [](const char* data, size_t len, size_t& consumed) {
+              Frame frame;
+              return decode_frame(data, len, frame, consumed);
+          },
+          [handler = std::move(handler)](std::string_view request, Reply reply) {
+              Frame frame;
+              size_t used;
+              decode_frame(request.data(), request.size(), frame, used);
+              reply.id_ = frame.id;
+              handler(frame, std::move(reply));
+          },
+          io_threads, "Binary") {
+    ordered_ = false;
+}
+
+FrameServer::FrameServer(Splitter split, RawHandler handler, size_t io_threads, std::string name)
+    : split_(std::move(split)), handler_(std::move(handler)), ordered_(true), name_(std::move(name)) {
+    for (size_t i = 0; i < std::max<size_t>(1, io_threads); ++i) loops_.push_back(std::make_unique<Loop>());
+}
+
+FrameServer::~FrameServer() { stop(); }
+
+bool FrameServer::start(int port) {
+    for (auto& loop : loops_) {
+        loop->listen_fd = ::socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        int on = 1;
+        setsockopt(loop->listen_fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+        setsockopt(loop->listen_fd, SOL_SOCKET, SO_REUSEPORT, &on, sizeof(on));
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_ANY);
+        addr.sin_port = htons(static_cast<uint16_t>(port));
+        if (loop->listen_fd < 0 || ::bind(loop->listen_fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 ||
+            ::listen(loop->listen_fd, SOMAXCONN) != 0) {
+            LOG_ERROR << "[" << name_ << "] Cannot listen on port " << port << ": " << std::strerror(errno);
+            stop();
+            return false;
+        }
+        loop->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+        loop->wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        for (int fd : {loop->listen_fd, loop->wake_fd}) {
+            epoll_event ev{};
+            ev.events = EPOLLIN | EPOLLET;
+            ev.data.fd = fd;
+            epoll_ctl(loop->epoll_fd, EPOLL_CTL_ADD, fd, &ev);
+        }
+    }
+    for (auto& loop : loops_) {
+        Loop* l = loop.get();
+        loop->thread = std::thread([this, l] { run(*l); });
+    }
+    return true;
+}
+
+void FrameServer::stop() {
+    stop_ = true;
+    for (auto& loop : loops_) {
+        if (loop->thread.joinable()) {
+            uint64_t one = 1;
+            ssize_t ignored = ::write(loop->wake_fd, &one, sizeof(one));
+            (void)ignored;
+            loop->thread.join();
+        }
+        for (auto& entry : loop->conns) {
+            std::lock_guard<std::mutex> lock(entry.second->mu);
+            entry.second->closed = true;
+            ::close(entry.first);
+        }
+        loop->conns.clear();
+        for (int* fd : {&loop->listen_fd, &loop->wake_fd, &loop->epoll_fd}) {
+            if (*fd >= 0) ::close(*fd);
+            *fd = -1;
+        }
+    }
+}
+
+// --- EVENT LOOP ---
+
+void FrameServer::run(Loop& loop) {
+    tl_current_loop = &loop;
+    epoll_event events[kMaxEvents];
+    std::vector<std::shared_ptr<Connection>> dirty;
+
+    while (!stop_) {
+        int n = epoll_wait(loop.epoll_fd, events, kMaxEvents, -1);
+        if (n < 0 && errno != EINTR) {
+            LOG_ERROR << "[" << name_ << "] epoll_wait failed: " << std::strerror(errno);
+            return;
+        }
+        for (int i = 0; i < n; ++i) {
+            int fd = events[i].data.fd;
+            if (fd == loop.listen_fd) {
+                accept(loop);
+            } else if (fd == loop.wake_fd) {
+                uint64_t count;
+                while (::read(loop.wake_fd, &count, sizeof(count)) > 0) {}
+            } else {
+                auto it = loop.conns.find(fd);
+                if (it == loop.conns.end()) continue;
+                std::shared_ptr<Connection> conn = it->second;
+                if (events[i].events & EPOLLERR) {
+                    close(loop, conn);
+                    continue;
+                }
+                if (events[i].events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP)) onReadable(loop, conn);
+                if (events[i].events & EPOLLOUT) flush(loop, conn);
+            }
+        }
+
+        // Write out every reply produced during this pass (or handed over
+        // from other threads) with one send() per connection.
+        while (true) {
+            {
+                std::lock_guard<std::mutex> lock(loop.dirty_mu);
+                dirty.swap(loop.dirty);
+            }
+            if (dirty.empty()) break;
+            for (auto& conn : dirty) flush(loop, conn);
+            dirty.clear();
+        }
+    }
+}
+
+void FrameServer::accept(Loop& loop) {
+    while (true) {
+        int fd = ::accept4(loop.listen_fd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            if (errno == EINTR) continue;
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                LOG_WARN << "[" << name_ << "] accept failed: " << std::strerror(errno);
+            }
+            return;
+        }
+        int on = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+        auto conn = std::make_shared<Connection>(fd, &loop, ordered_);
+        epoll_event ev{};
+        ev.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+        ev.data.fd = fd;
+        if (epoll_ctl(loop.epoll_fd, EPOLL_CTL_ADD, fd, &ev) != 0) {
+            ::close(fd);
+            continue;
+        }
+        loop.conns.emplace(fd, std::move(conn));
+    }
+}
+
+// Edge-triggered: keeps reading until the socket is drained, unless the
+// connection is paused, in which case flush() resumes it.
+void FrameServer::onReadable(Loop& loop, const std::shared_ptr<Connection>& conn) {
+    Connection& c = *conn;
+    while (true) {
+        // 1. Dispatch every complete request already buffered
+        size_t pos = 0, used;
+        while (true) {
+            if (backpressured(c.in_flight.load(std::memory_order_relaxed),
+                              c.pending_bytes.load(std::memory_order_relaxed))) {
+                c.paused = true;
+                break;
+            }
+            FrameDecode status = split_(c.in.data() + pos, c.in.size() - pos, used);
+            if (status == FrameDecode::TooLarge) {
+                close(loop, conn);
+                return;
+            }
+            if (status == FrameDecode::Incomplete) break;
+            c.in_flight.fetch_add(1, std::memory_order_relaxed);
+            handler_(std::string_view(c.in.data() + pos, used), Reply(conn, c.next_seq++));
+            pos += used;
+        }
+        c.in.erase(0, pos);
+        if (c.paused || c.peer_closed) return;
+
+        // 2. Read more
+        size_t old_size = c.in.size();
+        c.in.resize(old_size + kReadChunk);
+        ssize_t n = ::recv(c.fd, &c.in[old_size], kReadChunk, 0);
+        c.in.resize(old_size + (n > 0 ? n : 0));
+        if (n > 0) continue;
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return;
+        if (n == 0) {
+            // Half-close: answer what was already sent, then close
+            c.peer_closed = true;
+            flush(loop, conn);
+            return;
+        }
+        close(loop, conn);
+        return;
+    }
+}
+
+void FrameServer::flush(Loop& loop, const std::shared_ptr<Connection>& conn) {
+    Connection& c = *conn;
+    {
+        std::lock_guard<std::mutex> lock(c.mu);
+        c.scheduled = false;
+        if (c.closed) return;
+        if (c.wpos == c.wbuf.size()) {
+            c.wbuf.swap(c.out);
+            c.wpos = 0;
+        } else {
+            c.wbuf.append(c.out);
+        }
+        c.out.clear();
+    }
+
+    while (c.wpos < c.wbuf.size()) {
+        ssize_t n = ::send(c.fd, c.wbuf.data() + c.wpos, c.wbuf.size() - c.wpos, MSG_NOSIGNAL);
+        if (n > 0) {
+            c.wpos += n;
+            c.pending_bytes.fetch_sub(n, std::memory_order_relaxed);
+        } else if (n < 0 && errno == EINTR) {
+            continue;
+        } else if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            break;  // EPOLLOUT fires once the socket drains
+        } else {
+            close(loop, conn);
+            return;
+        }
+    }
+    if (c.wpos == c.wbuf.size()) {
+        c.wbuf.clear();
+        c.wpos = 0;
+    }
+
+    if (c.paused && !backpressured(c.in_flight.load(std::memory_order_relaxed),
+                                   c.pending_bytes.load(std::memory_order_relaxed))) {
+        c.paused = false;
+        onReadable(loop, conn);
+        return;
+    }
+    if (c.peer_closed && c.wbuf.empty()) {
+        bool idle;
+        {
+            std::lock_guard<std::mutex> lock(c.mu);
+            idle = c.out.empty() && c.in_flight.load(std::memory_order_relaxed) == 0;
+        }
+        if (idle) close(loop, conn);
+    }
+}
+
+void FrameServer::close(Loop& loop, const std::shared_ptr<Connection>& conn) {
+    {
+        std::lock_guard<std::mutex> lock(conn->mu);
+        if (conn->closed) return;
+        conn->closed = true;
+    }
+    epoll_ctl(loop.epoll_fd, EPOLL_CTL_DEL, conn->fd, nullptr);
+    ::close(conn->fd);
+    loop.conns.erase(conn->fd);
+}
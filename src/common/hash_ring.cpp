@@ -1,12 +1,73 @@
 #include "../../include/hash_ring.hpp"
-#include <functional>
-#include <iostream>
+#include "../../include/logger.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <map>
 #include <string>
-#include <iterator>
+#include <utility>
+
+// --- RANGE SETS ---
+
+HashRangeSet::HashRangeSet(const std::vector<HashRange>& ranges) {
+    for (const HashRange& r : ranges) {
+        if (r.start == r.end) continue;
+        if (r.start < r.end) {
+            intervals_.push_back({r.start + 1, r.end});
+            continue;
+        }
+        if (r.start != SIZE_MAX) intervals_.push_back({r.start + 1, SIZE_MAX});
+        intervals_.push_back({0, r.end});
+    }
+    std::sort(intervals_.begin(), intervals_.end(), [](const Interval& a, const Interval& b) { return a.lo < b.lo; });
+    size_t out = 0;
+    for (const Interval& iv : intervals_) {
+        if (out > 0 && (intervals_[out - 1].hi == SIZE_MAX || iv.lo <= intervals_[out - 1].hi + 1)) {
+            intervals_[out - 1].hi = std::max(intervals_[out - 1].hi, iv.hi);
+        } else {
+            intervals_[out++] = iv;
+        }
+    }
+    intervals_.resize(out);
+}
+
+bool HashRangeSet::contains(size_t h) const {
+    // Last interval starting at or below h
+    auto it = std::upper_bound(intervals_.begin(), intervals_.end(), h,
+                               [](size_t v, const Interval& iv) { return v < iv.lo; });
+    return it != intervals_.begin() && h <= (it - 1)->hi;
+}
+
+std::vector<SourcePlan> coalesce_tasks(const std::vector<MigrationTask>& tasks) {
+    std::map<std::string, std::vector<HashRange>> by_source;
+    for (const MigrationTask& t : tasks) by_source[t.source_node].push_back({t.start_hash, t.end_hash});
+
+    std::vector<SourcePlan> plans;
+    for (auto& entry : by_source) {
+        std::vector<HashRange>& ranges = entry.second;
+        std::sort(ranges.begin(), ranges.end(), [](const HashRange& a, const HashRange& b) { return a.start < b.start; });
+
+        // (a, b] + (b, c] = (a, c]; the wrapped range sorts last and may
+        // continue into the first one
+        std::vector<HashRange> merged;
+        for (const HashRange& r : ranges) {
+            if (!merged.empty() && merged.back().end == r.start) merged.back().end = r.end;
+            else merged.push_back(r);
+        }
+        if (merged.size() > 1 && merged.back().end == merged.front().start &&
+            merged.back().start != merged.front().end) {
+            merged.back().end = merged.front().end;
+            merged.erase(merged.begin());
+        }
+        plans.push_back({entry.first, std::move(merged)});
+    }
+    return plans;
+}
+
+// --- RING ---
 
 ConsistentHashRing::ConsistentHashRing(int v_nodes) : virtual_nodes(v_nodes) {}
 
-size_t ConsistentHashRing::hash_key(const std::string& key) {
+size_t ConsistentHashRing::hash_key(std::string_view key) {
     // 1. FNV-1a 64-bit Base
     const size_t FNV_prime = 1099511628211u;
     const size_t offset_basis = 14695981039346656037u;
@@ -27,87 +88,144 @@ size_t ConsistentHashRing::hash_key(const std::string& key) {
     return hash;
 }
 
+ConsistentHashRing::NodeId ConsistentHashRing::findNode(const std::string& node_address) const {
+    for (NodeId id = 0; id < nodes_.size(); ++id) {
+        if (nodes_[id] == node_address) return id;
+    }
+    return kNoNode;
+}
+
+void ConsistentHashRing::rebuildIndex() {
+    // About one vnode per bucket: 2^bits >= vnode count
+    int bits = 1;
+    while (bits < 24 && (size_t(1) << bits) < hashes_.size()) ++bits;
+    bucket_shift_ = 64 - bits;
+
+    const size_t num_buckets = size_t(1) << bits;
+    buckets_.assign(num_buckets + 1, 0);
+    size_t i = 0;
+    for (size_t b = 0; b < num_buckets; ++b) {
+        while (i < hashes_.size() && (hashes_[i] >> bucket_shift_) < b) ++i;
+        buckets_[b] = static_cast<uint32_t>(i);
+    }
+    buckets_[num_buckets] = static_cast<uint32_t>(hashes_.size());
+}
+
+size_t ConsistentHashRing::lowerBound(size_t hash) const {
+    if (hashes_.empty()) return 0;
+    size_t b = hash >> bucket_shift_;
+    auto first = hashes_.begin() + buckets_[b];
+    auto last = hashes_.begin() + buckets_[b + 1];
+    return std::lower_bound(first, last, hash) - hashes_.begin();
+}
+
 void ConsistentHashRing::addNode(const std::string& node_address) {
+    if (findNode(node_address) != kNoNode) return;
+    NodeId id = static_cast<NodeId>(nodes_.size());
+    nodes_.push_back(node_address);
+
+    // Merge the new vnodes in; on a hash collision the newer node wins
+    std::vector<std::pair<size_t, NodeId>> entries;
+    entries.reserve(hashes_.size() + virtual_nodes);
+    for (size_t i = 0; i < hashes_.size(); ++i) entries.emplace_back(hashes_[i], owners_[i]);
     for (int i = 0; i < virtual_nodes; ++i) {
-        std::string v_node_key = node_address + "#" + std::to_string(i);
-        size_t hash = hash_key(v_node_key);
-        ring[hash] = node_address;
+        entries.emplace_back(hash_key(node_address + "#" + std::to_string(i)), id);
+    }
+    std::stable_sort(entries.begin(), entries.end(),
+                     [](const auto& a, const auto& b) { return a.first < b.first; });
+
+    hashes_.clear();
+    owners_.clear();
+    for (const auto& e : entries) {
+        if (!hashes_.empty() && hashes_.back() == e.first) {
+            owners_.back() = e.second;
+            continue;
+        }
+        hashes_.push_back(e.first);
+        owners_.push_back(e.second);
     }
+    rebuildIndex();
 }
 
 void ConsistentHashRing::removeNode(const std::string& node_address) {
-    std::cout << "[Ring] Request received to remove node: " << node_address << "...\n";
+    LOG_INFO << "[Ring] Request received to remove node: " << node_address << "...";
 
+    NodeId id = findNode(node_address);
     int removed_count = 0;
-    for (auto it = ring.begin(); it != ring.end(); ) {
-        if (it->second == node_address) {
-            it = ring.erase(it);
-            removed_count++;
-        } else {
-            ++it;
+    if (id != kNoNode) {
+        // Drop its vnodes and close the gap in the ID space
+        size_t out = 0;
+        for (size_t i = 0; i < hashes_.size(); ++i) {
+            if (owners_[i] == id) {
+                removed_count++;
+                continue;
+            }
+            hashes_[out] = hashes_[i];
+            owners_[out] = owners_[i] > id ? owners_[i] - 1 : owners_[i];
+            ++out;
         }
+        hashes_.resize(out);
+        owners_.resize(out);
+        nodes_.erase(nodes_.begin() + id);
+        rebuildIndex();
     }
 
     if (removed_count > 0) {
-        std::cout << "[Ring] Success: Removed " << removed_count << " virtual nodes for " << node_address << ".\n";
+        LOG_INFO << "[Ring] Success: Removed " << removed_count << " virtual nodes for " << node_address << ".";
     } else {
-        std::cout << "[Ring] Warning: Node " << node_address << " was not found in the ring.\n";
+        LOG_WARN << "[Ring] Warning: Node " << node_address << " was not found in the ring.";
     }
 }
 
-std::string ConsistentHashRing::getNode(const std::string& key) {
-    if (ring.empty()) return "";
-    size_t hash = hash_key(key);
-    auto it = ring.lower_bound(hash);
-    if (it == ring.end()) it = ring.begin();
-    return it->second;
+ConsistentHashRing::NodeId ConsistentHashRing::getNodeId(std::string_view key) const {
+    if (hashes_.empty()) return kNoNode;
+    size_t pos = lowerBound(hash_key(key));
+    if (pos == hashes_.size()) pos = 0;
+    return owners_[pos];
+}
+
+const std::string& ConsistentHashRing::getNode(std::string_view key) const {
+    static const std::string none;
+    NodeId id = getNodeId(key);
+    return id == kNoNode ? none : nodes_[id];
 }
 
-std::vector<MigrationTask> ConsistentHashRing::getRebalancingTasks(const std::string& new_node) {
+std::vector<MigrationTask> ConsistentHashRing::getRebalancingTasks(const std::string& new_node) const {
     std::vector<MigrationTask> tasks;
-    if (ring.empty()) return tasks;
+    if (hashes_.empty()) return tasks;
 
-    std::cout << "[Ring] Calculating rebalancing tasks for " << new_node << "...\n";
+    LOG_INFO << "[Ring] Calculating rebalancing tasks for " << new_node << "...";
 
+    const NodeId new_id = findNode(new_node);
+    const size_t n = hashes_.size();
     for (int i = 0; i < virtual_nodes; ++i) {
         // 1. Reconstruct the virtual key and hash
-        std::string v_node_key = new_node + "#" + std::to_string(i);
-        size_t hash = hash_key(v_node_key);
+        size_t hash = hash_key(new_node + "#" + std::to_string(i));
 
-        // 2. Direct Lookup: Jump straight to this node in the map
-        auto it = ring.find(hash);
+        // 2. Direct Lookup: Jump straight to this vnode in the array
+        size_t pos = lowerBound(hash);
 
         // Safety check: ensure the node is actually in the ring
-        if (it == ring.end()) continue;
+        if (pos == n || hashes_[pos] != hash) continue;
 
-        size_t end_hash = it->first;
-        size_t start_hash;
+        size_t end_hash = hash;
 
-        // 3. Determine the Range Start (Previous Node)
-        if (it == ring.begin()) {
-            start_hash = ring.rbegin()->first; // Wrap around to the end
-        } else {
-            start_hash = std::prev(it)->first;
-        }
+        // 3. Determine the Range Start (Previous Node, wrapping around)
+        size_t start_hash = pos == 0 ? hashes_[n - 1] : hashes_[pos - 1];
 
         // SAFETY: Skip zero-length ranges
         if (start_hash == end_hash) continue;
 
         // 4. Find Victim (Who owned this before?)
         // Look clockwise (forward) for the first node that ISN'T us.
-        auto successor_it = std::next(it);
-        while (true) {
-            if (successor_it == ring.end()) successor_it = ring.begin();
-            if (successor_it->second != new_node) break; // Found a different server
-            if (successor_it == it) break; // We looped entirely around (only 1 node exists)
-            successor_it++;
-        }
+        size_t succ = pos;
+        do {
+            succ = succ + 1 == n ? 0 : succ + 1;
+        } while (owners_[succ] == new_id && succ != pos);
 
-        std::string real_victim = successor_it->second;
-
-        if (real_victim != new_node) {
-            tasks.push_back({real_victim, start_hash, end_hash});
+        if (owners_[succ] != new_id) {
+            tasks.push_back({nodes_[owners_[succ]], start_hash, end_hash});
         }
     }
     return tasks;
-}
\ No newline at end of file
+}
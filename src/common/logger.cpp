@@ -0,0 +1,127 @@
+#include "../../include/logger.hpp"
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+
+bool parse_log_level(const std::string& name, LogLevel& out) {
+    if (name == "debug") out = LogLevel::Debug;
+    else if (name == "info") out = LogLevel::Info;
+    else if (name == "warn") out = LogLevel::Warn;
+    else if (name == "error") out = LogLevel::Error;
+    else if (name == "off") out = LogLevel::Off;
+    else return false;
+    return true;
+}
+
+const char* log_level_name(LogLevel level) {
+    switch (level) {
+        case LogLevel::Debug: return "debug";
+        case LogLevel::Info: return "info";
+        case LogLevel::Warn: return "warn";
+        case LogLevel::Error: return "error";
+        case LogLevel::Off: return "off";
+    }
+    return "unknown";
+}
+
+// --- LOGGER ---
+
+// Never destroyed, so objects torn down at exit (the WAL writer) can still
+// log; whatever is queued is flushed by an atexit hook instead.
+Logger& Logger::instance() {
+    static Logger* logger = [] {
+        Logger* created = new Logger();
+        std::atexit([] { instance().flush(); });
+        return created;
+    }();
+    return *logger;
+}
+
+Logger::Logger() : slots_(new Slot[kSlots]) {
+    for (size_t i = 0; i < kSlots; ++i) slots_[i].seq.store(i, std::memory_order_relaxed);
+    std::thread(&Logger::run, this).detach();
+}
+
+bool Logger::sampled() const {
+    uint32_t rate = sampleRate();
+    if (rate <= 1) return true;
+    return sample_counter_.fetch_add(1, std::memory_order_relaxed) % rate == 0;
+}
+
+// Bounded MPMC ring (Vyukov): a slot is free for position p when its seq is
+// p, and holds a line for the flusher when its seq is p + 1.
+void Logger::write(LogLevel level, const char* line, size_t len) {
+    size_t pos = enqueue_pos_.load(std::memory_order_relaxed);
+    Slot* slot;
+    while (true) {
+        slot = &slots_[pos % kSlots];
+        size_t seq = slot->seq.load(std::memory_order_acquire);
+        intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+        if (diff == 0) {
+            if (enqueue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+        } else if (diff < 0) {
+            dropped_.fetch_add(1, std::memory_order_relaxed);  // Full
+            return;
+        } else {
+            pos = enqueue_pos_.load(std::memory_order_relaxed);
+        }
+    }
+    slot->level = level;
+    slot->len = static_cast<uint16_t>(len < kLineBytes ? len : kLineBytes);
+    std::memcpy(slot->text, line, slot->len);
+    slot->seq.store(pos + 1, std::memory_order_release);
+
+    if (sleeping_.load(std::memory_order_relaxed)) wake_cv_.notify_one();
+}
+
+size_t Logger::drain(std::string& out, std::string& err) {
+    size_t lines = 0;
+    while (true) {
+        Slot& slot = slots_[dequeue_pos_ % kSlots];
+        if (slot.seq.load(std::memory_order_acquire) != dequeue_pos_ + 1) break;
+        std::string& dest = slot.level >= LogLevel::Warn ? err : out;
+        dest.append(slot.text, slot.len);
+        dest.push_back('\n');
+        slot.seq.store(dequeue_pos_ + kSlots, std::memory_order_release);
+        dequeue_pos_++;
+        lines++;
+    }
+    return lines;
+}
+
+void Logger::flush() {
+    std::unique_lock<std::mutex> lock(mu_);
+    uint64_t target = flushed_epoch_ + 2;  // A full pass that started after this call
+    wake_cv_.notify_one();
+    flushed_cv_.wait(lock, [&] { return flushed_epoch_ >= target; });
+}
+
+void Logger::run() {
+    std::string out, err;
+    std::unique_lock<std::mutex> lock(mu_);
+    while (true) {
+        lock.unlock();
+        size_t lines = drain(out, err);
+        if (!out.empty()) {
+            std::fwrite(out.data(), 1, out.size(), stdout);
+            std::fflush(stdout);
+            out.clear();
+        }
+        if (!err.empty()) {
+            std::fwrite(err.data(), 1, err.size(), stderr);
+            std::fflush(stderr);
+            err.clear();
+        }
+        lock.lock();
+        flushed_epoch_++;
+        flushed_cv_.notify_all();
+        if (lines > 0) continue;
+
+        // Idle: sleep until a writer notices and wakes us, or a short
+        // timeout covers a wake-up that raced with going to sleep.
+        sleeping_.store(true, std::memory_order_relaxed);
+        wake_cv_.wait_for(lock, std::chrono::milliseconds(50));
+        sleeping_.store(false, std::memory_order_relaxed);
+    }
+}
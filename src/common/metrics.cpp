@@ -0,0 +1,206 @@
+#include "../../include/metrics.hpp"
+#include <cstdio>
+
+// --- COUNTER / HISTOGRAM ---
+
+uint64_t Counter::value() const {
+    uint64_t total = 0;
+    for (const Cell& cell : cells_) total += cell.value.load(std::memory_order_relaxed);
+    return total;
+}
+
+// Values below 4 get a bucket each; above that, the bucket is picked by the
+// value's top bit (the power of two) and the two bits below it.
+size_t Histogram::bucketOf(uint64_t value) {
+    if (value < kSubBuckets) return static_cast<size_t>(value);
+    size_t exponent = 63 - static_cast<size_t>(__builtin_clzll(value));
+    if (exponent >= kMaxExponent) return kBuckets - 1;
+    return kSubBuckets * (exponent - 1) + ((value >> (exponent - 2)) & (kSubBuckets - 1));
+}
+
+uint64_t Histogram::bucketMax(size_t bucket) {
+    if (bucket < kSubBuckets) return bucket;
+    size_t exponent = bucket / kSubBuckets + 1;
+    uint64_t width = uint64_t{1} << (exponent - 2);
+    return (kSubBuckets + bucket % kSubBuckets) * width + width - 1;
+}
+
+Histogram::Snapshot Histogram::snapshot() const {
+    Snapshot snap;
+    snap.counts.assign(kBuckets, 0);
+    for (size_t s = 0; s < kMetricStripes; ++s) {
+        const Stripe& stripe = stripes_[s];
+        for (size_t i = 0; i < kBuckets; ++i) snap.counts[i] += stripe.counts[i].load(std::memory_order_relaxed);
+        snap.sum += stripe.sum.load(std::memory_order_relaxed);
+    }
+    for (uint64_t c : snap.counts) snap.count += c;
+    return snap;
+}
+
+uint64_t Histogram::quantile(const std::vector<uint64_t>& counts, double q) {
+    uint64_t total = 0;
+    for (uint64_t c : counts) total += c;
+    if (total == 0) return 0;
+    uint64_t rank = static_cast<uint64_t>(q * static_cast<double>(total - 1)) + 1;
+    uint64_t seen = 0;
+    for (size_t i = 0; i < counts.size(); ++i) {
+        seen += counts[i];
+        if (seen >= rank) return bucketMax(i);
+    }
+    return bucketMax(counts.size() - 1);
+}
+
+// --- EXPOSITION FORMAT ---
+
+std::string metric_label(std::string_view name, std::string_view value) {
+    std::string out(name);
+    out += "=\"";
+    for (char c : value) {
+        if (c == '\\' || c == '"') out.push_back('\\');
+        if (c == '\n') out += "\\n";
+        else out.push_back(c);
+    }
+    out.push_back('"');
+    return out;
+}
+
+void metric_header(std::string& out, std::string_view name, std::string_view help, std::string_view type) {
+    out.append("# HELP ").append(name).append(" ").append(help).append("\n");
+    out.append("# TYPE ").append(name).append(" ").append(type).append("\n");
+}
+
+namespace {
+std::string format_number(double value) {
+    char buf[32];
+    int n = std::snprintf(buf, sizeof(buf), "%.9g", value);
+    return std::string(buf, n > 0 ? n : 0);
+}
+
+std::string join_labels(std::string_view labels, std::string_view extra) {
+    if (labels.empty()) return std::string(extra);
+    std::string out(labels);
+    out.push_back(',');
+    out.append(extra);
+    return out;
+}
+} // namespace
+
+void metric_sample(std::string& out, std::string_view name, std::string_view labels, double value) {
+    out.append(name);
+    if (!labels.empty()) out.append("{").append(labels).append("}");
+    out.append(" ").append(format_number(value)).append("\n");
+}
+
+// --- REGISTRY ---
+
+// Never destroyed, so threads still running at exit can keep recording.
+Metrics& Metrics::instance() {
+    static Metrics* metrics = new Metrics();
+    return *metrics;
+}
+
+Metrics::Family& Metrics::family(const std::string& name, const std::string& help, bool histogram, double scale) {
+    Family& fam = families_[name];
+    if (fam.series.empty()) {
+        fam.help = help;
+        fam.histogram = histogram;
+        fam.scale = scale;
+    }
+    return fam;
+}
+
+Counter& Metrics::counter(const std::string& name, const std::string& help, const std::string& labels) {
+    std::lock_guard<std::mutex> lock(mu_);
+    Family& fam = family(name, help, false, 1);
+    for (Series& s : fam.series) {
+        if (s.labels == labels) return *s.counter;
+    }
+    fam.series.push_back({labels, std::make_unique<Counter>(), nullptr});
+    return *fam.series.back().counter;
+}
+
+Histogram& Metrics::histogram(const std::string& name, const std::string& help, const std::string& labels,
+                              double scale) {
+    std::lock_guard<std::mutex> lock(mu_);
+    Family& fam = family(name, help, true, scale);
+    for (Series& s : fam.series) {
+        if (s.labels == labels) return *s.histogram;
+    }
+    fam.series.push_back({labels, nullptr, std::make_unique<Histogram>()});
+    return *fam.series.back().histogram;
+}
+
+std::vector<Histogram*> Metrics::histograms(const std::string& name) {
+    std::lock_guard<std::mutex> lock(mu_);
+    std::vector<Histogram*> out;
+    auto it = families_.find(name);
+    if (it == families_.end() || !it->second.histogram) return out;
+    for (Series& s : it->second.series) out.push_back(s.histogram.get());
+    return out;
+}
+
+void Metrics::addCollector(std::function<void(std::string& out)> collect) {
+    std::lock_guard<std::mutex> lock(mu_);
+    collectors_.push_back(std::move(collect));
+}
+
+std::string Metrics::render() {
+    std::string out;
+    std::lock_guard<std::mutex> lock(mu_);
+    for (const auto& entry : families_) {
+        const std::string& name = entry.first;
+        const Family& fam = entry.second;
+        metric_header(out, name, fam.help, fam.histogram ? "histogram" : "counter");
+        for (const Series& s : fam.series) {
+            if (!fam.histogram) {
+                metric_sample(out, name, s.labels, static_cast<double>(s.counter->value()));
+                continue;
+            }
+            // Cumulative counts for every fixed bucket, then +Inf. The set never
+            // changes, so rate() and histogram_quantile() line up across scrapes.
+            Histogram::Snapshot snap = s.histogram->snapshot();
+            uint64_t cumulative = 0;
+            for (size_t i = 0; i < snap.counts.size(); ++i) {
+                cumulative += snap.counts[i];
+                std::string le = format_number(static_cast<double>(Histogram::bucketMax(i)) * fam.scale);
+                metric_sample(out, name + "_bucket", join_labels(s.labels, metric_label("le", le)),
+                              static_cast<double>(cumulative));
+            }
+            metric_sample(out, name + "_bucket", join_labels(s.labels, "le=\"+Inf\""), static_cast<double>(snap.count));
+            metric_sample(out, name + "_sum", s.labels, static_cast<double>(snap.sum) * fam.scale);
+            metric_sample(out, name + "_count", s.labels, static_cast<double>(snap.count));
+        }
+    }
+    for (const auto& collect : collectors_) collect(out);
+    return out;
+}
+
+// --- REQUEST METRICS ---
+
+EndpointMetrics::EndpointMetrics(const std::string& prefix, const std::string& label,
+                                 const std::vector<std::string>& endpoints)
+    : other_(make(prefix, label, "other")) {
+    for (const std::string& endpoint : endpoints) endpoints_.emplace(endpoint, make(prefix, label, endpoint));
+}
+
+EndpointMetrics::Endpoint EndpointMetrics::make(const std::string& prefix, const std::string& label,
+                                                const std::string& endpoint) {
+    static const char* outcomes[] = {"ok", "client_error", "server_error"};
+    Metrics& metrics = Metrics::instance();
+    std::string labels = metric_label(label, endpoint);
+    Endpoint ep;
+    for (size_t i = 0; i < 3; ++i) {
+        ep.requests[i] = &metrics.counter(prefix + "_requests_total", "Requests handled, by outcome.",
+                                          labels + "," + metric_label("outcome", outcomes[i]));
+    }
+    ep.latency = &metrics.histogram(prefix + "_request_duration_seconds", "Time to answer a request.", labels,
+                                    kNanosToSeconds);
+    return ep;
+}
+
+void EndpointMetrics::record(std::string_view endpoint, Outcome outcome, uint64_t nanos) {
+    auto it = endpoints_.find(endpoint);
+    const Endpoint& ep = it == endpoints_.end() ? other_ : it->second;
+    ep.requests[static_cast<size_t>(outcome)]->inc();
+    ep.latency->record(nanos);
+}
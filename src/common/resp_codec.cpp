@@ -0,0 +1,100 @@
+#include "../../include/resp_codec.hpp"
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+namespace {
+constexpr size_t kMaxInlineBytes = 64 << 10;
+constexpr int64_t kMaxArgs = 1 << 20;
+
+// Reads "<digits>\r\n" at p (after the type byte).
+FrameDecode read_number(const char*& p, const char* end, int64_t& v) {
+    const char* cr = static_cast<const char*>(std::memchr(p, '\r', end - p));
+    if (!cr || cr + 1 >= end) return end - p > 20 ? FrameDecode::TooLarge : FrameDecode::Incomplete;
+    if (cr[1] != '\n' || cr == p || cr - p > 20) return FrameDecode::TooLarge;
+    bool negative = *p == '-';
+    v = 0;
+    for (const char* d = p + negative; d < cr; ++d) {
+        if (*d < '0' || *d > '9') return FrameDecode::TooLarge;
+        int digit = *d - '0';
+        if (v > (std::numeric_limits<int64_t>::max() - digit) / 10) return FrameDecode::TooLarge;
+        v = v * 10 + digit;
+    }
+    if (negative) v = -v;
+    p = cr + 2;
+    return FrameDecode::Ok;
+}
+
+// Walks one command; fills `args` if given. Assumes nothing about `data`.
+FrameDecode walk_command(const char* data, size_t len, size_t& consumed, std::vector<std::string_view>* args) {
+    if (len == 0) return FrameDecode::Incomplete;
+    const char* p = data;
+    const char* end = data + len;
+
+    if (*p != '*') {
+        // Inline command: one line of space-separated words
+        const char* nl = static_cast<const char*>(std::memchr(p, '\n', std::min(len, kMaxInlineBytes)));
+        if (!nl) return len >= kMaxInlineBytes ? FrameDecode::TooLarge : FrameDecode::Incomplete;
+        consumed = nl - data + 1;
+        if (args) {
+            const char* line_end = nl > p && nl[-1] == '\r' ? nl - 1 : nl;
+            while (p < line_end) {
+                while (p < line_end && (*p == ' ' || *p == '\t')) ++p;
+                const char* word = p;
+                while (p < line_end && *p != ' ' && *p != '\t') ++p;
+                if (p > word) args->emplace_back(word, p - word);
+            }
+        }
+        return FrameDecode::Ok;
+    }
+
+    ++p;
+    int64_t count;
+    FrameDecode status = read_number(p, end, count);
+    if (status != FrameDecode::Ok) return status;
+    if (count > kMaxArgs) return FrameDecode::TooLarge;
+    for (int64_t i = 0; i < count; ++i) {
+        if (p == end) return FrameDecode::Incomplete;
+        if (*p++ != '$') return FrameDecode::TooLarge;
+        int64_t size;
+        if ((status = read_number(p, end, size)) != FrameDecode::Ok) return status;
+        if (size < 0 || size > kMaxFrameBody || p - data + size > static_cast<int64_t>(kMaxFrameBody)) {
+            return FrameDecode::TooLarge;
+        }
+        if (end - p < size + 2) return FrameDecode::Incomplete;
+        if (p[size] != '\r' || p[size + 1] != '\n') return FrameDecode::TooLarge;
+        if (args) args->emplace_back(p, static_cast<size_t>(size));
+        p += size + 2;
+    }
+    consumed = p - data;
+    return FrameDecode::Ok;
+}
+
+void put_line(std::string& out, char type, std::string_view s) {
+    out.push_back(type);
+    out.append(s.data(), s.size());
+    out.append("\r\n");
+}
+} // namespace
+
+FrameDecode frame_resp_command(const char* data, size_t len, size_t& consumed) {
+    return walk_command(data, len, consumed, nullptr);
+}
+
+void parse_resp_command(std::string_view command, std::vector<std::string_view>& args) {
+    size_t used;
+    args.clear();
+    walk_command(command.data(), command.size(), used, &args);
+}
+
+void resp_simple(std::string& out, std::string_view s) { put_line(out, '+', s); }
+void resp_error(std::string& out, std::string_view msg) { put_line(out, '-', msg); }
+void resp_integer(std::string& out, int64_t v) { put_line(out, ':', std::to_string(v)); }
+void resp_null(std::string& out) { out.append("$-1\r\n"); }
+void resp_array(std::string& out, size_t count) { put_line(out, '*', std::to_string(count)); }
+
+void resp_bulk(std::string& out, std::string_view s) {
+    put_line(out, '$', std::to_string(s.size()));
+    out.append(s.data(), s.size());
+    out.append("\r\n");
+}
@@ -0,0 +1,192 @@
+#include "../../include/wal_format.hpp"
+#include "../../include/crc32c.hpp"
+#include <cstdio>
+#include <fstream>
+
+namespace {
+const char kWalMagic[4] = {'K', 'V', 'W', 'L'};
+const char kSnapshotMagic[4] = {'K', 'V', 'S', 'N'};
+
+std::string file_header(const char (&magic)[4]) {
+    std::string h(magic, sizeof(magic));
+    h.push_back(static_cast<char>(kWalVersion));
+    h.append(3, '\0');
+    return h;
+}
+
+bool has_file_header(std::string_view data, const char (&magic)[4]) {
+    return data.size() >= kWalHeaderSize && data.compare(0, sizeof(magic), magic, sizeof(magic)) == 0 &&
+           static_cast<uint8_t>(data[4]) == kWalVersion;
+}
+
+uint32_t get_u32(const char* p) {
+    uint32_t v = 0;
+    for (int i = 0; i < 4; ++i) v |= static_cast<uint32_t>(static_cast<unsigned char>(p[i])) << (8 * i);
+    return v;
+}
+
+void put_u64(std::string& out, uint64_t v) {
+    for (int i = 0; i < 8; ++i) out.push_back(static_cast<char>((v >> (8 * i)) & 0xFF));
+}
+
+uint64_t get_u64(const char* p) {
+    uint64_t v = 0;
+    for (int i = 0; i < 8; ++i) v |= static_cast<uint64_t>(static_cast<unsigned char>(p[i])) << (8 * i);
+    return v;
+}
+} // namespace
+
+// --- HEADER ---
+
+std::string wal_file_header() { return file_header(kWalMagic); }
+bool has_wal_header(std::string_view data) { return has_file_header(data, kWalMagic); }
+
+std::string snapshot_file_header() { return file_header(kSnapshotMagic); }
+bool has_snapshot_header(std::string_view data) { return has_file_header(data, kSnapshotMagic); }
+
+// --- VARINTS (LEB128) ---
+
+void put_varint(std::string& out, uint64_t v) {
+    while (v >= 0x80) {
+        out.push_back(static_cast<char>((v & 0x7F) | 0x80));
+        v >>= 7;
+    }
+    out.push_back(static_cast<char>(v));
+}
+
+bool get_varint(const char*& p, const char* end, uint64_t& v) {
+    v = 0;
+    for (int shift = 0; shift <= 63 && p < end; shift += 7) {
+        uint64_t byte = static_cast<unsigned char>(*p++);
+        v |= (byte & 0x7F) << shift;
+        if (!(byte & 0x80)) return true;
+    }
+    return false;
+}
+
+// --- RECORDS ---
+
+void encode_wal_record(std::string& out, WalOp op, std::string_view key, std::string_view value) {
+    size_t crc_pos = out.size();
+    out.append(4, '\0');
+    out.push_back(static_cast<char>(op));
+    put_varint(out, key.size());
+    put_varint(out, value.size());
+    out.append(key.data(), key.size());
+    out.append(value.data(), value.size());
+
+    uint32_t crc = crc32c(out.data() + crc_pos + 4, out.size() - crc_pos - 4);
+    for (int i = 0; i < 4; ++i) out[crc_pos + i] = static_cast<char>((crc >> (8 * i)) & 0xFF);
+}
+
+namespace {
+// Parses the length prefixes; on Ok, `p` points at the key.
+WalDecode parse_lengths(const char* data, size_t len, const char*& p, uint64_t& key_len, uint64_t& val_len) {
+    const char* end = data + len;
+    if (len < 5) return WalDecode::Incomplete;
+
+    p = data + 5;
+    if (!get_varint(p, end, key_len) || !get_varint(p, end, val_len)) {
+        // A varint cut short by EOF is a torn tail; one that never ends is garbage.
+        return p == end ? WalDecode::Incomplete : WalDecode::Corrupt;
+    }
+    size_t remaining = static_cast<size_t>(end - p);
+    if (key_len > remaining || val_len > remaining - key_len) return WalDecode::Incomplete;
+    return WalDecode::Ok;
+}
+} // namespace
+
+WalDecode frame_wal_record(const char* data, size_t len, size_t& consumed) {
+    const char* p;
+    uint64_t key_len, val_len;
+    WalDecode status = parse_lengths(data, len, p, key_len, val_len);
+    if (status == WalDecode::Ok) consumed = static_cast<size_t>(p - data) + key_len + val_len;
+    return status;
+}
+
+WalDecode decode_wal_record(const char* data, size_t len, WalRecord& out, size_t& consumed, bool verify_crc) {
+    const char* p;
+    uint64_t key_len, val_len;
+    WalDecode status = parse_lengths(data, len, p, key_len, val_len);
+    if (status != WalDecode::Ok) return status;
+
+    const char* body_end = p + key_len + val_len;
+    if (verify_crc && crc32c(data + 4, static_cast<size_t>(body_end - data - 4)) != get_u32(data)) {
+        return WalDecode::Corrupt;
+    }
+
+    uint8_t op = static_cast<uint8_t>(data[4]);
+    if (op < static_cast<uint8_t>(WalOp::Set) || op > static_cast<uint8_t>(WalOp::Cursor)) return WalDecode::Corrupt;
+
+    out.op = static_cast<WalOp>(op);
+    out.key = std::string_view(p, key_len);
+    out.value = std::string_view(p + key_len, val_len);
+    consumed = static_cast<size_t>(body_end - data);
+    return WalDecode::Ok;
+}
+
+// --- RANGE PAYLOADS ---
+
+std::string encode_hash_ranges(const std::vector<HashRange>& ranges) {
+    std::string out;
+    out.reserve(ranges.size() * 16);
+    for (const HashRange& r : ranges) {
+        put_u64(out, r.start);
+        put_u64(out, r.end);
+    }
+    return out;
+}
+
+bool decode_hash_ranges(std::string_view payload, std::vector<HashRange>& out) {
+    if (payload.size() % 16 != 0) return false;
+    out.clear();
+    for (size_t i = 0; i < payload.size(); i += 16) {
+        out.push_back({static_cast<size_t>(get_u64(payload.data() + i)),
+                       static_cast<size_t>(get_u64(payload.data() + i + 8))});
+    }
+    return true;
+}
+
+// --- LEGACY TEXT CONVERTER ---
+
+long convert_text_wal(const std::string& path) {
+    std::ifstream infile(path);
+    if (!infile.is_open()) return -1;
+
+    std::string tmp_path = path + ".tmp";
+    std::ofstream outfile(tmp_path, std::ios::binary | std::ios::trunc);
+    if (!outfile.is_open()) return -1;
+
+    std::string buf = wal_file_header();
+    long count = 0;
+
+    // Same parsing rules the text replay used
+    std::string op, key, val;
+    while (infile >> op >> key) {
+        if (op == "SET") {
+            std::getline(infile, val);
+            if (!val.empty() && val[0] == ' ') val = val.substr(1);
+            encode_wal_record(buf, WalOp::Set, key, val);
+        } else if (op == "DEL") {
+            std::getline(infile, val);  // Skip the trailing space
+            encode_wal_record(buf, WalOp::Del, key);
+        } else {
+            continue;
+        }
+        ++count;
+        if (buf.size() >= (1 << 20)) {
+            outfile.write(buf.data(), static_cast<std::streamsize>(buf.size()));
+            buf.clear();
+        }
+    }
+    outfile.write(buf.data(), static_cast<std::streamsize>(buf.size()));
+    outfile.close();
+    infile.close();
+    if (!outfile) return -1;
+
+    std::string backup = path + ".txt.bak";
+    std::remove(backup.c_str());
+    if (std::rename(path.c_str(), backup.c_str()) != 0) return -1;
+    if (std::rename(tmp_path.c_str(), path.c_str()) != 0) return -1;
+    return count;
+}
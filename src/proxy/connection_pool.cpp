@@ -0,0 +1,151 @@
+#include "../../include/connection_pool.hpp"
+#include <iomanip>
+#include <sstream>
+
+// --- LEASE ---
+
+ConnectionPool::Lease::Lease(Lease&& other) noexcept
+    : pool_(other.pool_), backend_(other.backend_), client_(std::move(other.client_)), broken_(other.broken_) {
+    other.pool_ = nullptr;
+    other.backend_ = nullptr;
+}
+
+ConnectionPool::Lease& ConnectionPool::Lease::operator=(Lease&& other) noexcept {
+    if (this != &other) {
+        release();
+        pool_ = other.pool_;
+        backend_ = other.backend_;
+        client_ = std::move(other.client_);
+        broken_ = other.broken_;
+        other.pool_ = nullptr;
+        other.backend_ = nullptr;
+    }
+    return *this;
+}
+
+ConnectionPool::Lease::~Lease() { release(); }
+
+void ConnectionPool::Lease::release() {
+    if (pool_ && client_) pool_->giveBack(backend_, std::move(client_), broken_);
+    pool_ = nullptr;
+    backend_ = nullptr;
+}
+
+// --- POOL ---
+
+ConnectionPool::Backend* ConnectionPool::backend(const std::string& address) {
+    {
+        std::shared_lock<std::shared_mutex> lock(backends_mutex_);
+        auto it = backends_.find(address);
+        if (it != backends_.end()) return it->second.get();
+    }
+
+    size_t colon = address.rfind(':');
+    if (colon == std::string::npos) return nullptr;
+    int port;
+    try { port = std::stoi(address.substr(colon + 1)); } catch (...) { return nullptr; }
+
+    std::unique_lock<std::shared_mutex> lock(backends_mutex_);
+    auto& slot = backends_[address];
+    if (!slot) {
+        slot.reset(new Backend());
+        slot->ip = address.substr(0, colon);
+        slot->port = port;
+        std::string labels = metric_label("node", address) + "," + metric_label("protocol", "http");
+        slot->latency = &Metrics::instance().histogram("kv_proxy_backend_request_duration_seconds",
+                                                       "Round trip of a request to a storage node.", labels,
+                                                       kNanosToSeconds);
+        slot->errors = &Metrics::instance().counter("kv_proxy_backend_errors_total",
+                                                    "Requests to a storage node that failed.", labels);
+    }
+    return slot.get();
+}
+
+ConnectionPool::Lease ConnectionPool::acquire(const std::string& address) {
+    Backend* b = backend(address);
+    if (!b) return Lease();
+
+    using clock = std::chrono::steady_clock;
+    std::unique_lock<std::mutex> lock(b->mutex);
+
+    // 1. Wait for a free slot if the backend is saturated
+    if (b->idle.empty() && b->open >= options_.max_per_backend) {
+        auto start = clock::now();
+        b->cv.wait(lock, [&] { return !b->idle.empty() || b->open < options_.max_per_backend; });
+        b->stats.waits++;
+        b->stats.wait_us += static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::microseconds>(clock::now() - start).count());
+    }
+
+    // 2. Reuse the most recently returned connection, unless it sat idle too long
+    while (!b->idle.empty()) {
+        Idle entry = std::move(b->idle.back());
+        b->idle.pop_back();
+        if (clock::now() - entry.since < std::chrono::seconds(options_.max_idle_s)) {
+            b->stats.hits++;
+            return Lease(this, b, std::move(entry.client));
+        }
+        b->open--;
+        b->stats.evictions++;
+    }
+
+    // 3. Open a new one (the connect itself happens lazily on first request)
+    b->open++;
+    b->stats.misses++;
+    lock.unlock();
+
+    std::unique_ptr<httplib::Client> client(new httplib::Client(b->ip, b->port));
+    client->set_keep_alive(true);
+    client->set_tcp_nodelay(true);
+    client->set_connection_timeout(options_.connect_timeout_s);
+    client->set_read_timeout(options_.read_timeout_s);
+    return Lease(this, b, std::move(client));
+}
+
+void ConnectionPool::giveBack(Backend* b, std::unique_ptr<httplib::Client> client, bool broken) {
+    {
+        std::lock_guard<std::mutex> lock(b->mutex);
+        if (broken) {
+            b->open--;
+            b->stats.evictions++;
+            b->errors->inc();
+        } else {
+            b->idle.push_back({std::move(client), std::chrono::steady_clock::now()});
+        }
+    }
+    b->cv.notify_one();
+    // A broken client is destroyed here, outside the lock.
+}
+
+void ConnectionPool::evictIdle(const std::string& address) {
+    Backend* b = nullptr;
+    {
+        std::shared_lock<std::shared_mutex> lock(backends_mutex_);
+        auto it = backends_.find(address);
+        if (it == backends_.end()) return;
+        b = it->second.get();
+    }
+    std::vector<Idle> dropped;
+    {
+        std::lock_guard<std::mutex> lock(b->mutex);
+        dropped.swap(b->idle);
+        b->open -= dropped.size();
+        b->stats.evictions += dropped.size();
+    }
+    b->cv.notify_all();
+}
+
+std::string ConnectionPool::statsText() {
+    std::stringstream ss;
+    std::shared_lock<std::shared_mutex> lock(backends_mutex_);
+    for (const auto& entry : backends_) {
+        const Stats& s = entry.second->stats;
+        uint64_t hits = s.hits, misses = s.misses, waits = s.waits;
+        double hit_rate = hits + misses ? double(hits) / double(hits + misses) : 0.0;
+        double avg_wait_ms = waits ? s.wait_us / 1000.0 / double(waits) : 0.0;
+        ss << "pool " << entry.first << " hits=" << hits << " misses=" << misses << " hit_rate=" << std::fixed
+           << std::setprecision(3) << hit_rate << " waits=" << waits << " avg_wait_ms=" << avg_wait_ms
+           << " evictions=" << s.evictions << "\n";
+    }
+    return ss.str();
+}
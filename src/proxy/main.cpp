@@ -1,9 +1,40 @@
+#include "../../include/batch_codec.hpp"
+#include "../../include/binary_protocol.hpp"
+#include "../../include/connection_pool.hpp"
 #include "../../include/hash_ring.hpp"
 #include "../../include/httplib.h"
+#include "../../include/logger.hpp"
+#include "../../include/metrics.hpp"
+#include "../../include/migration_executor.hpp"
+#include "../../include/migration_routes.hpp"
+#include "../../include/rcu_ptr.hpp"
+#include "../../include/rebalance_jobs.hpp"
+#include "../../include/wal_format.hpp"
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <future>
 #include <iostream>
-#include <sstream>
+#include <memory>
+#include <mutex>
+#include <thread>
 #include <vector>
 #include <map>
+#ifdef __linux__
+#include "../../include/frame_channel.hpp"
+#include "../../include/frame_server.hpp"
+#include "../../include/resp_codec.hpp"
+#include <atomic>
+#include <shared_mutex>
+#include <unordered_map>
+#endif
+
+// Data-path handlers read the ring without locking; admin handlers publish
+// modified copies.
+using SharedRing = RcuPtr<ConsistentHashRing>;
 
 // --- HELPER FUNCTIONS ---
 std::string sanitize_host(std::string address) {
@@ -24,107 +55,944 @@ bool get_ip_port(const std::string& address, std::string& ip, int& port) {
     return true;
 }
 
-// --- ADD MIGRATION (Executed by Proxy) ---
-void optimized_rebalance_add(ConsistentHashRing& ring, const std::string& new_node) {
-    std::cout << "[Proxy] Rebalancing for new node: " << new_node << "...\n";
-    auto tasks = ring.getRebalancingTasks(new_node);
-
-    std::string new_ip; int new_port;
-    if (!get_ip_port(new_node, new_ip, new_port)) return;
-    httplib::Client dest_cli(new_ip, new_port);
-    dest_cli.set_connection_timeout(1);
-
-    int moved_count = 0;
-    for (const auto& task : tasks) {
-        std::string src_ip; int src_port;
-        if (!get_ip_port(task.source_node, src_ip, src_port)) continue;
-        httplib::Client src_cli(src_ip, src_port);
-        src_cli.set_connection_timeout(1);
-
-        // Ask source node for keys in the range
-        std::string path = "/range?start=" + std::to_string(task.start_hash) +
-                           "&end=" + std::to_string(task.end_hash);
-        auto res = src_cli.Get(path.c_str());
-
-        if (res && res->status == 200) {
-            std::stringstream ss(res->body);
-            std::string key, val;
-            while (std::getline(ss, key)) {
-                if (std::getline(ss, val)) {
-                    // 1. Copy to NEW node
-                    httplib::Params p_put; p_put.emplace("key", key); p_put.emplace("val", val);
-                    if (dest_cli.Post("/put", p_put)) {
-                        // 2. Delete from OLD node
-                        httplib::Params p_del; p_del.emplace("key", key);
-                        src_cli.Post("/del", p_del);
-                        moved_count++;
+// --- BULK TRANSFER ---
+// Migrations move keys as WAL-format record batches: one /ranges_export on
+// each source for all the ranges it hands over, /bulk_load on the
+// destination (one WAL append per batch), then a single /range_delete on the
+// source.
+constexpr size_t kBulkBatchBytes = 4 << 20;
+
+// Sends WAL-format `records` to `node` in batches cut at record boundaries.
+// Keys the node already has, or deleted under `lease`, are left alone
+// (?if_absent=1): a migration copy must not replace a value written since.
+// Each batch renews the lease; one the node no longer knows fails the load.
+bool bulk_load(ConnectionPool& pool, const std::string& node, uint64_t lease, const char* data, size_t len) {
+    auto cli = pool.acquire(node);
+    if (!cli) return false;
+
+    size_t pos = 0;
+    while (pos < len) {
+        size_t end = pos, used;
+        while (end < len && end - pos < kBulkBatchBytes) {
+            if (frame_wal_record(data + end, len - end, used) != WalDecode::Ok) return false;
+            end += used;
+        }
+        auto res = cli->Post("/bulk_load?if_absent=1&lease=" + std::to_string(lease), data + pos, end - pos,
+                             "application/octet-stream");
+        if (!res) cli.markBroken();
+        if (!res || res->status != 200) return false;
+        pos = end;
+    }
+    return true;
+}
+
+// Has `node` remember the keys of `ranges` deleted from now until the lease
+// is closed, or until kTombstoneLeaseSeconds pass without a load under it.
+// Returns the lease ID, or 0 if the node refused.
+constexpr int kTombstoneLeaseSeconds = 120;
+
+uint64_t open_tombstone_lease(ConnectionPool& pool, const std::string& node, const std::vector<HashRange>& ranges) {
+    auto cli = pool.acquire(node);
+    if (!cli) return 0;
+    auto res = cli->Post("/tombstones/open?ttl_s=" + std::to_string(kTombstoneLeaseSeconds),
+                         encode_hash_ranges(ranges), "application/octet-stream");
+    if (!res) cli.markBroken();
+    unsigned long long lease = 0;
+    if (!res || res->status != 200 || std::sscanf(res->body.c_str(), "Lease %llu", &lease) != 1) return 0;
+    return lease;
+}
+
+// Ends a lease and lets `node` forget its tombstones. Best effort: a lease
+// left open expires.
+void close_tombstone_lease(ConnectionPool& pool, const std::string& node, uint64_t lease) {
+    auto cli = pool.acquire(node);
+    if (!cli) return;
+    auto res = cli->Post("/tombstones/close?lease=" + std::to_string(lease), "", "text/plain");
+    if (!res) cli.markBroken();
+}
+
+// Drops every key of `ranges` from `node`. True once the node confirms.
+bool range_delete(ConnectionPool& pool, const std::string& node, const std::vector<HashRange>& ranges) {
+    auto cli = pool.acquire(node);
+    if (!cli) return false;
+    auto res = cli->Post("/range_delete", encode_hash_ranges(ranges), "application/octet-stream");
+    if (!res) cli.markBroken();
+    return res && res->status == 200;
+}
+
+// Streams the keys of `ranges` from `source` (/ranges_export), or the whole
+// node when `ranges` is null (/range_export), and hands each SET record to
+// on_record as it arrives, so the export is never held in memory. Starts at
+// `cursor` (empty for the beginning) and keeps it at the latest cursor
+// received; a dropped stream is resumed from there.
+bool stream_export(ConnectionPool& pool, const std::string& source, const std::vector<HashRange>* ranges,
+                   std::string& cursor,
+                   const std::function<bool(const char* record, size_t len, const WalRecord& rec)>& on_record) {
+    for (int attempt = 0; attempt < 3; ++attempt) {
+        auto cli = pool.acquire(source);
+        if (!cli) return false;
+
+        httplib::Request req;
+        req.method = ranges ? "POST" : "GET";
+        req.path = ranges ? "/ranges_export" : "/range_export";
+        if (!cursor.empty()) req.path += "?cursor=" + cursor;  // Digits, dots and hex only
+        if (ranges) {
+            req.body = encode_hash_ranges(*ranges);
+            req.set_header("Content-Type", "application/octet-stream");
+        }
+
+        std::string pending;
+        bool failed = false;
+        req.response_handler = [](const httplib::Response& r) { return r.status == 200; };
+        req.content_receiver = [&](const char* data, size_t len, uint64_t, uint64_t) {
+            pending.append(data, len);
+            size_t pos = 0, used;
+            WalRecord rec;
+            WalDecode status;
+            while ((status = decode_wal_record(pending.data() + pos, pending.size() - pos, rec, used)) ==
+                   WalDecode::Ok) {
+                if (rec.op == WalOp::Cursor) cursor.assign(rec.key);
+                else if (rec.op != WalOp::Set || !on_record(pending.data() + pos, used, rec)) failed = true;
+                if (failed) return false;
+                pos += used;
+            }
+            if (status == WalDecode::Corrupt) {
+                failed = true;
+                return false;
+            }
+            pending.erase(0, pos);
+            return true;
+        };
+        auto res = cli->send(req);
+        if (failed || res.error() == httplib::Error::Canceled) return false;  // Bad data or a non-200 reply
+        if (res && res->status == 200 && pending.empty()) return true;
+        cli.markBroken();  // Transport error: retry from the last cursor
+        LOG_WARN << "[Proxy] Export from " << source << " interrupted; resuming";
+    }
+    return false;
+}
+
+// --- MULTI-KEY FAN-OUT ---
+// Buckets batch positions by owning node (indexed by ring NodeId) from one
+// ring snapshot. Keys with no owner are left out.
+void group_by_owner(SharedRing& ring, const std::vector<std::string_view>& keys,
+                    std::vector<std::vector<size_t>>& groups, std::vector<std::string>& addresses) {
+    auto snapshot = ring.read();
+    groups.assign(snapshot->nodeCount(), {});
+    addresses.clear();
+    for (size_t i = 0; i < keys.size(); ++i) {
+        ConsistentHashRing::NodeId id = snapshot->getNodeId(keys[i]);
+        if (id != ConsistentHashRing::kNoNode) groups[id].push_back(i);
+    }
+    for (ConsistentHashRing::NodeId id = 0; id < groups.size(); ++id) addresses.push_back(snapshot->nodeAddress(id));
+}
+
+// Routes of the batch's keys that lie in moving ranges, by position; empty
+// when nothing is moving.
+std::vector<std::shared_ptr<MigrationRoute>> find_routes(const MigrationRoutes& routes,
+                                                         const std::vector<std::string_view>& keys) {
+    std::vector<std::shared_ptr<MigrationRoute>> found;
+    if (routes.empty()) return found;
+    found.resize(keys.size());
+    for (size_t i = 0; i < keys.size(); ++i) found[i] = routes.find(keys[i]);
+    return found;
+}
+
+// Folds the old owner's answer into a DEL of a moving key sent to both of its
+// owners (see MigrationRoute): failed if either failed, else Ok if either
+// had the key.
+void merge_delete(BatchStatus old_owner, BatchResult& result) {
+    if (result.status == BatchStatus::Error) return;
+    if (old_owner == BatchStatus::Error) result.status = BatchStatus::Error;
+    else if (old_owner == BatchStatus::Ok) result.status = BatchStatus::Ok;
+}
+
+// Splits a batch by owner, sends one sub-batch per backend (in parallel) and
+// reassembles the positional results. Items whose backend fails, or that
+// have no owner, come back as BatchStatus::Error. `values` is set for /mput.
+std::vector<BatchResult> fan_out(SharedRing& ring, MigrationRoutes& routes, ConnectionPool& pool, const char* path,
+                                 const std::vector<std::string_view>& keys,
+                                 const std::vector<std::string_view>* values) {
+    std::vector<BatchResult> results(keys.size());
+    for (auto& r : results) r.status = BatchStatus::Error;
+    const bool read = std::strcmp(path, "/mget") == 0;
+    const bool del = std::strcmp(path, "/mdel") == 0;
+
+    // 1. Group positions by owning node
+    std::vector<std::vector<size_t>> groups;
+    std::vector<std::string> addresses;
+    std::vector<std::shared_ptr<MigrationRoute>> moving = find_routes(routes, keys);
+    group_by_owner(ring, keys, groups, addresses);
+
+    // 2. One request per backend; `misses_only` keeps only the keys found
+    auto send = [&](const std::string& address, const std::vector<size_t>& positions, bool misses_only) {
+        std::vector<std::string_view> sub_keys, sub_values;
+        for (size_t i : positions) {
+            sub_keys.push_back(keys[i]);
+            if (values) sub_values.push_back((*values)[i]);
+        }
+        std::string body;
+        if (values) encode_batch_pairs(body, sub_keys, sub_values);
+        else encode_batch_keys(body, sub_keys);
+
+        auto cli = pool.acquire(address);
+        if (!cli) return;
+        auto start = std::chrono::steady_clock::now();
+        auto res = cli->Post(path, body, "application/octet-stream");
+        cli.observe(start);
+        if (!res) cli.markBroken();
+        std::vector<BatchResult> sub;
+        if (!res || res->status != 200 || !decode_batch_results(res->body, sub) || sub.size() != positions.size()) return;
+        for (size_t j = 0; j < positions.size(); ++j) {
+            if (!misses_only || sub[j].status == BatchStatus::Found) results[positions[j]] = std::move(sub[j]);
+        }
+    };
+
+    // 3. Deletes in moving ranges reach their old owner first
+    std::vector<BatchResult> old_owner_results;
+    if (del && !moving.empty()) {
+        std::map<std::string, std::vector<size_t>> old_owners;
+        for (size_t i = 0; i < keys.size(); ++i) {
+            if (moving[i]) old_owners[moving[i]->from()].push_back(i);
+        }
+        for (const auto& o : old_owners) send(o.first, o.second, false);
+        old_owner_results.swap(results);
+        results.assign(keys.size(), {BatchStatus::Error, {}});
+    }
+
+    // 4. Fan out: all but one backend on helper threads, the last inline
+    std::vector<size_t> targets;
+    for (size_t node = 0; node < groups.size(); ++node) {
+        if (!groups[node].empty()) targets.push_back(node);
+    }
+    std::vector<std::future<void>> pending;
+    for (size_t t = 0; t + 1 < targets.size(); ++t) {
+        pending.push_back(std::async(std::launch::async, send, std::cref(addresses[targets[t]]),
+                                     std::cref(groups[targets[t]]), false));
+    }
+    if (!targets.empty()) send(addresses[targets.back()], groups[targets.back()], false);
+    for (auto& f : pending) f.get();
+
+    // 5. Reads that missed on a moving range go to its old owner
+    if (read && !moving.empty()) {
+        std::map<std::string, std::vector<size_t>> retry;
+        for (size_t i = 0; i < keys.size(); ++i) {
+            if (moving[i] && results[i].status == BatchStatus::Missing) retry[moving[i]->from()].push_back(i);
+        }
+        for (const auto& r : retry) send(r.first, r.second, true);
+    }
+    for (size_t i = 0; i < old_owner_results.size(); ++i) {
+        if (moving[i]) merge_delete(old_owner_results[i].status, results[i]);
+    }
+    return results;
+}
+
+#ifdef __linux__
+// --- BINARY PROTOCOL ---
+// Binary-protocol channels to the storage nodes, keyed by the node's ring
+// address. A node gets one when it is added, if its /status advertises a
+// binary port; keys it owns are Unavailable over the binary protocol otherwise.
+class BackendChannels {
+public:
+    void add(const std::string& node, const std::string& ip, int port) {
+        std::string labels = metric_label("node", node) + "," + metric_label("protocol", "binary");
+        Backend backend{std::make_shared<FrameChannel>(ip, port),
+                        &Metrics::instance().histogram("kv_proxy_backend_request_duration_seconds",
+                                                       "Round trip of a request to a storage node.", labels,
+                                                       kNanosToSeconds),
+                        &Metrics::instance().counter("kv_proxy_backend_errors_total",
+                                                     "Requests to a storage node that failed.", labels)};
+        std::unique_lock<std::shared_mutex> lock(mu_);
+        channels_[node] = std::move(backend);
+    }
+    void remove(const std::string& node) {
+        std::unique_lock<std::shared_mutex> lock(mu_);
+        channels_.erase(node);
+    }
+
+    // Sends one request to `node` and times its round trip. `done` gets
+    // Unavailable if the node has no channel.
+    void call(const std::string& node, BinOp op, std::string_view payload, FrameChannel::Callback done) {
+        Backend backend;
+        {
+            std::shared_lock<std::shared_mutex> lock(mu_);
+            auto it = channels_.find(node);
+            if (it != channels_.end()) backend = it->second;
+        }
+        if (!backend.channel) { done(BinStatus::Unavailable, {}); return; }
+        backend.channel->call(op, payload, [latency = backend.latency, errors = backend.errors,
+                                            start = std::chrono::steady_clock::now(),
+                                            done = std::move(done)](BinStatus status, std::string_view reply) {
+            latency->recordSince(start);
+            if (status == BinStatus::Error || status == BinStatus::Unavailable) errors->inc();
+            done(status, reply);
+        });
+    }
+
+private:
+    struct Backend {
+        std::shared_ptr<FrameChannel> channel;
+        Histogram* latency = nullptr;
+        Counter* errors = nullptr;
+    };
+
+    std::shared_mutex mu_;
+    std::unordered_map<std::string, Backend> channels_;
+};
+
+// Forwards a single-key request to the key's owner. Never blocks: `done`
+// runs on the channel's reader thread. A key in a moving range is routed as
+// MigrationRoute describes: a PUT goes to its new owner, a DEL to the old
+// owner and then the new one, and a GET that misses on the new owner asks
+// the old one.
+void forward_binary(SharedRing& ring, MigrationRoutes& routes, BackendChannels& channels, BinOp op,
+                    std::string_view key, std::string_view payload, FrameChannel::Callback done) {
+    std::shared_ptr<MigrationRoute> route = routes.find(key);
+    if (!route) {
+        channels.call(ring.read()->getNode(key), op, payload, std::move(done));
+        return;
+    }
+    if (op == BinOp::Put) {
+        channels.call(route->to(), op, payload, std::move(done));
+        return;
+    }
+    if (op == BinOp::Del) {
+        channels.call(route->from(), op, payload,
+                      [&channels, route, payload = std::string(payload), done = std::move(done)](BinStatus first,
+                                                                                                std::string_view) {
+            if (first != BinStatus::Ok && first != BinStatus::NotFound) {
+                done(first, {});
+                return;
+            }
+            channels.call(route->to(), BinOp::Del, payload, [first, done](BinStatus status, std::string_view reply) {
+                done(status == BinStatus::NotFound ? first : status, reply);
+            });
+        });
+        return;
+    }
+    channels.call(route->to(), op, payload,
+                  [&channels, route, key = std::string(key), done = std::move(done)](BinStatus status,
+                                                                                     std::string_view reply) {
+        if (status != BinStatus::NotFound) {
+            done(status, reply);
+            return;
+        }
+        channels.call(route->from(), BinOp::Get, key, done);
+    });
+}
+
+// Multi-key request in flight: one sub-batch per backend, completed by
+// whichever backend replies last.
+struct BinaryFanOut {
+    std::function<void(std::vector<BatchResult>&)> done;
+    std::vector<std::vector<size_t>> groups;
+    std::vector<BatchResult> results;
+    std::atomic<size_t> remaining{0};
+
+    void finishOne() {
+        if (remaining.fetch_sub(1, std::memory_order_acq_rel) == 1) done(results);
+    }
+};
+
+// The old-owner round of a binary MGet or MDel over moving ranges (`keys`
+// holds their keys by position). An MGet runs it after the new owners
+// answered, for the keys that missed there, and only hits replace their
+// results. An MDel runs it first, for every moving key, over results that
+// start as Error.
+void ask_old_owners_binary(BackendChannels& channels, BinOp op,
+                           const std::vector<std::shared_ptr<MigrationRoute>>& moving,
+                           const std::vector<std::string>& keys, std::vector<BatchResult>& results,
+                           std::function<void(std::vector<BatchResult>&)> done) {
+    std::map<std::string, std::vector<size_t>> retry;
+    for (size_t i = 0; i < moving.size(); ++i) {
+        if (moving[i] && (op == BinOp::MDel || results[i].status == BatchStatus::Missing)) {
+            retry[moving[i]->from()].push_back(i);
+        }
+    }
+    if (retry.empty()) {
+        done(results);
+        return;
+    }
+
+    auto fan = std::make_shared<BinaryFanOut>();
+    fan->done = std::move(done);
+    fan->results = std::move(results);
+    fan->remaining = retry.size() + 1;
+    for (auto& r : retry) {
+        size_t group = fan->groups.size();
+        fan->groups.push_back(std::move(r.second));
+        std::vector<std::string_view> sub_keys;
+        for (size_t i : fan->groups[group]) sub_keys.push_back(keys[i]);
+        std::string body;
+        encode_batch_keys(body, sub_keys);
+        channels.call(r.first, op, body, [fan, group, op](BinStatus status, std::string_view payload) {
+            const std::vector<size_t>& positions = fan->groups[group];
+            std::vector<BatchResult> sub;
+            if (status == BinStatus::Ok && decode_batch_results(payload, sub) && sub.size() == positions.size()) {
+                for (size_t j = 0; j < positions.size(); ++j) {
+                    if (op == BinOp::MDel || sub[j].status == BatchStatus::Found) {
+                        fan->results[positions[j]] = std::move(sub[j]);
                     }
                 }
             }
+            fan->finishOne();
+        });
+    }
+    fan->finishOne();
+}
+
+// Sends one sub-batch of a binary multi-key request to each key's owner on
+// the ring; done(results) runs once every backend answered.
+void send_to_owners_binary(SharedRing& ring, BackendChannels& channels, BinOp op,
+                           const std::vector<std::string_view>& keys, const std::vector<std::string_view>* values,
+                           std::function<void(std::vector<BatchResult>&)> done) {
+    auto fan = std::make_shared<BinaryFanOut>();
+    fan->done = std::move(done);
+    std::vector<std::string> addresses;
+    group_by_owner(ring, keys, fan->groups, addresses);
+    fan->results.assign(keys.size(), {BatchStatus::Error, {}});
+
+    std::vector<size_t> targets;
+    for (size_t node = 0; node < fan->groups.size(); ++node) {
+        if (!fan->groups[node].empty()) targets.push_back(node);
+    }
+    fan->remaining = targets.size() + 1;  // +1 until every sub-batch is sent
+    for (size_t node : targets) {
+        std::vector<std::string_view> sub_keys, sub_values;
+        for (size_t i : fan->groups[node]) {
+            sub_keys.push_back(keys[i]);
+            if (values) sub_values.push_back((*values)[i]);
         }
+        std::string body;
+        if (values) encode_batch_pairs(body, sub_keys, sub_values);
+        else encode_batch_keys(body, sub_keys);
+
+        channels.call(addresses[node], op, body, [fan, node](BinStatus status, std::string_view payload) {
+            const std::vector<size_t>& positions = fan->groups[node];
+            std::vector<BatchResult> sub;
+            if (status == BinStatus::Ok && decode_batch_results(payload, sub) && sub.size() == positions.size()) {
+                for (size_t j = 0; j < positions.size(); ++j) fan->results[positions[j]] = std::move(sub[j]);
+            }
+            fan->finishOne();
+        });
     }
-    std::cout << "[Proxy] Rebalancing Complete. Moved " << moved_count << " keys.\n";
+    fan->finishOne();
 }
 
-// --- REMOVE MIGRATION (Executed by Proxy) ---
-void rebalance_remove(ConsistentHashRing& ring, const std::string& node_to_remove) {
-    std::cout << "[Proxy] Evacuating node: " << node_to_remove << "...\n";
-    std::string ip; int port;
-    if (!get_ip_port(node_to_remove, ip, port)) {
-        ring.removeNode(node_to_remove);
+// Asynchronous counterpart of fan_out over the binary channels (MGet, MPut
+// with `values`, or MDel), with the old-owner rounds of moving ranges.
+// done(results) runs once every backend answered.
+void fan_out_binary(SharedRing& ring, MigrationRoutes& routes, BackendChannels& channels, BinOp op,
+                    const std::vector<std::string_view>& keys, const std::vector<std::string_view>* values,
+                    std::function<void(std::vector<BatchResult>&)> done) {
+    std::vector<std::shared_ptr<MigrationRoute>> moving = find_routes(routes, keys);
+    if (moving.empty() || op == BinOp::MPut) {
+        send_to_owners_binary(ring, channels, op, keys, values, std::move(done));
+        return;
+    }
+    std::vector<std::string> moving_keys(keys.size());  // Outlive the request's payload
+    for (size_t i = 0; i < keys.size(); ++i) {
+        if (moving[i]) moving_keys[i] = std::string(keys[i]);
+    }
+    if (op == BinOp::MGet) {
+        send_to_owners_binary(ring, channels, op, keys, values,
+                              [&channels, moving = std::move(moving), moving_keys = std::move(moving_keys),
+                               done = std::move(done)](std::vector<BatchResult>& results) {
+            ask_old_owners_binary(channels, BinOp::MGet, moving, moving_keys, results, done);
+        });
         return;
     }
 
-    httplib::Client victim_cli(ip, port);
-    victim_cli.set_connection_timeout(1);
-
-    // 1. GET ALL DATA before removing from ring
-    auto res = victim_cli.Get("/all");
-
-    // 2. Remove from ring so new traffic goes to the new owners
-    ring.removeNode(node_to_remove);
-
-    int moved_count = 0;
-    if (res && res->status == 200) {
-        std::stringstream ss(res->body);
-        std::string key, val;
-        while (std::getline(ss, key)) {
-            if (std::getline(ss, val)) {
-                // Find who owns this key now
-                std::string target = ring.getNode(key);
-                std::string t_ip; int t_port;
-                if (get_ip_port(target, t_ip, t_port)) {
-                    httplib::Client dest(t_ip, t_port);
-                    httplib::Params p; p.emplace("key", key); p.emplace("val", val);
-
-                    // 3. Send data to new owner
-                    if (dest.Post("/put", p)) {
-                        moved_count++;
-                        // Note: We don't need to DEL individually anymore...
-                    }
+    // MDel: the old owners first, then the ring's owners for every key
+    auto all_keys = std::make_shared<std::vector<std::string>>(keys.begin(), keys.end());
+    std::vector<BatchResult> first(keys.size(), {BatchStatus::Error, {}});
+    ask_old_owners_binary(channels, op, moving, moving_keys, first,
+                          [&ring, &channels, moving, all_keys, done = std::move(done)](std::vector<BatchResult>& old) {
+        std::vector<std::string_view> views(all_keys->begin(), all_keys->end());
+        send_to_owners_binary(ring, channels, BinOp::MDel, views, nullptr,
+                              [moving, all_keys, old, done](std::vector<BatchResult>& results) {
+            for (size_t i = 0; i < results.size(); ++i) {
+                if (moving[i]) merge_delete(old[i].status, results[i]);
+            }
+            done(results);
+        });
+    });
+}
+
+Outcome bin_outcome(BinStatus status) {
+    if (status == BinStatus::Ok || status == BinStatus::NotFound) return Outcome::Ok;
+    return status == BinStatus::BadRequest ? Outcome::ClientError : Outcome::ServerError;
+}
+
+// Runs on a FrameServer I/O thread and never blocks: requests are forwarded
+// over the backends' pipelined channels and answered from their reader threads.
+void serve_frame(SharedRing& ring, MigrationRoutes& routes, BackendChannels& channels, EndpointMetrics& metrics,
+                 const Frame& req, FrameServer::Reply reply) {
+    BinOp op = static_cast<BinOp>(req.code);
+    auto respond = [reply, &metrics, code = req.code, start = std::chrono::steady_clock::now()](
+                       BinStatus status, std::string_view body = {}) {
+        reply.send(status, body);
+        metrics.record(bin_op_name(code), bin_outcome(status), nanos_since(start));
+    };
+    std::vector<std::string_view> keys, values;
+
+    switch (op) {
+        case BinOp::Ping:
+            respond(BinStatus::Ok);
+            return;
+        case BinOp::Get:
+        case BinOp::Put:
+        case BinOp::Del: {
+            std::string_view key = req.payload, val;
+            if (op == BinOp::Put && !decode_put_payload(req.payload, key, val)) break;
+            forward_binary(ring, routes, channels, op, key, req.payload,
+                           [respond](BinStatus status, std::string_view payload) { respond(status, payload); });
+            return;
+        }
+        case BinOp::MGet:
+        case BinOp::MPut:
+        case BinOp::MDel: {
+            bool ok = op == BinOp::MPut ? decode_batch_pairs(req.payload, keys, values) : decode_batch_keys(req.payload, keys);
+            if (!ok) break;
+            fan_out_binary(ring, routes, channels, op, keys, op == BinOp::MPut ? &values : nullptr,
+                           [respond](std::vector<BatchResult>& results) {
+                std::string body;
+                encode_batch_results(body, results);
+                respond(BinStatus::Ok, body);
+            });
+            return;
+        }
+    }
+    respond(BinStatus::BadRequest);
+}
+
+// --- REDIS (RESP2) FRONT-END ---
+// GET/SET/DEL/MGET/MSET/PING from Redis clients, routed like binary requests.
+// Replies leave in command order, as Redis pipelining requires.
+// Command names are client bytes: ::toupper on a negative char is undefined.
+char ascii_upper(unsigned char c) { return static_cast<char>(::toupper(c)); }
+char ascii_lower(unsigned char c) { return static_cast<char>(::tolower(c)); }
+
+void serve_resp(SharedRing& ring, MigrationRoutes& routes, BackendChannels& channels, EndpointMetrics& metrics,
+                std::string_view command, FrameServer::Reply reply) {
+    std::vector<std::string_view> args;
+    parse_resp_command(command, args);
+    if (args.empty()) { reply.sendRaw({}); return; }  // Blank inline line
+
+    std::string name(args[0]);
+    std::transform(name.begin(), name.end(), name.begin(), ascii_upper);
+    const char* kBackendError = "ERR storage node unavailable";
+    std::string label(name);
+    std::transform(label.begin(), label.end(), label.begin(), ascii_lower);
+    auto respond = [reply, &metrics, label, kBackendError, start = std::chrono::steady_clock::now()](
+                       std::string_view out) {
+        reply.sendRaw(out);
+        Outcome outcome = Outcome::Ok;
+        if (!out.empty() && out[0] == '-') {
+            outcome = out.substr(1, std::strlen(kBackendError)) == kBackendError ? Outcome::ServerError
+                                                                                  : Outcome::ClientError;
+        }
+        metrics.record(label, outcome, nanos_since(start));
+    };
+    auto error = [respond](std::string_view msg) {
+        std::string out;
+        resp_error(out, msg);
+        respond(out);
+    };
+    auto arity_ok = [&](bool ok) {
+        if (!ok) {
+            std::string lower(args[0]);
+            std::transform(lower.begin(), lower.end(), lower.begin(), ascii_lower);
+            error("ERR wrong number of arguments for '" + lower + "' command");
+        }
+        return ok;
+    };
+    std::vector<std::string_view> keys, values;
+
+    if (name == "PING") {
+        if (!arity_ok(args.size() <= 2)) return;
+        std::string out;
+        if (args.size() == 2) resp_bulk(out, args[1]);
+        else resp_simple(out, "PONG");
+        respond(out);
+    } else if (name == "GET") {
+        if (!arity_ok(args.size() == 2)) return;
+        forward_binary(ring, routes, channels, BinOp::Get, args[1], args[1], [respond, kBackendError](BinStatus status, std::string_view value) {
+            std::string out;
+            if (status == BinStatus::Ok) resp_bulk(out, value);
+            else if (status == BinStatus::NotFound) resp_null(out);
+            else resp_error(out, kBackendError);
+            respond(out);
+        });
+    } else if (name == "SET") {
+        if (args.size() > 3) { error("ERR syntax error"); return; }  // No EX/PX/NX/XX
+        if (!arity_ok(args.size() == 3)) return;
+        forward_binary(ring, routes, channels, BinOp::Put, args[1], encode_put_payload(args[1], args[2]),
+                       [respond, kBackendError](BinStatus status, std::string_view) {
+            std::string out;
+            if (status == BinStatus::Ok) resp_simple(out, "OK");
+            else resp_error(out, kBackendError);
+            respond(out);
+        });
+    } else if (name == "DEL" || name == "MGET") {
+        if (!arity_ok(args.size() >= 2)) return;
+        keys.assign(args.begin() + 1, args.end());
+        bool del = name == "DEL";
+        fan_out_binary(ring, routes, channels, del ? BinOp::MDel : BinOp::MGet, keys, nullptr,
+                       [respond, del, kBackendError](std::vector<BatchResult>& results) {
+            std::string out;
+            int64_t deleted = 0;
+            for (const auto& r : results) {
+                if (r.status == BatchStatus::Error) {
+                    resp_error(out, kBackendError);
+                    respond(out);
+                    return;
+                }
+                if (r.status == BatchStatus::Ok) deleted++;
+            }
+            if (del) {
+                resp_integer(out, deleted);
+            } else {
+                resp_array(out, results.size());
+                for (const auto& r : results) {
+                    if (r.status == BatchStatus::Found) resp_bulk(out, r.value);
+                    else resp_null(out);
                 }
             }
+            respond(out);
+        });
+    } else if (name == "MSET") {
+        if (!arity_ok(args.size() >= 3 && args.size() % 2 == 1)) return;
+        for (size_t i = 1; i < args.size(); i += 2) {
+            keys.push_back(args[i]);
+            values.push_back(args[i + 1]);
         }
+        fan_out_binary(ring, routes, channels, BinOp::MPut, keys, &values, [respond, kBackendError](std::vector<BatchResult>& results) {
+            std::string out;
+            bool ok = std::all_of(results.begin(), results.end(), [](const BatchResult& r) { return r.status == BatchStatus::Ok; });
+            if (ok) resp_simple(out, "OK");
+            else resp_error(out, kBackendError);
+            respond(out);
+        });
+    } else if (name == "COMMAND" || name == "CONFIG") {
+        // Probed by redis-cli and redis-benchmark on connect; nothing to report
+        std::string out;
+        resp_array(out, 0);
+        respond(out);
+    } else {
+        error("ERR unknown command '" + std::string(args[0]) + "'");
+    }
+}
+#endif
 
-        // 4. THE CLEANUP: Reset the old node completely.
-        // This clears its memory AND deletes the wal_PORT.log file.
-        // The node is now fresh and ready to be used by someone else.
+// What one run of a rebalance job moved. Exported as kv_rebalance_*
+// metrics labelled op="add"|"remove".
+struct RebalanceStats {
+    size_t keys = 0;
+    size_t bytes = 0;  // WAL-format record bytes
+    uint64_t nanos = 0;
+};
+
+void record_rebalance(const char* op, const RebalanceStats& st) {
+    Metrics& metrics = Metrics::instance();
+    std::string labels = metric_label("op", op);
+    metrics.counter("kv_rebalance_keys_moved_total", "Keys moved between nodes by rebalancing.", labels).inc(st.keys);
+    metrics.counter("kv_rebalance_bytes_moved_total", "Record bytes moved between nodes by rebalancing.", labels)
+        .inc(st.bytes);
+    metrics.histogram("kv_rebalance_duration_seconds", "Wall time of one run of a node add or remove job.", labels, kNanosToSeconds)
+        .record(st.nanos);
+}
+
+// p99 of the proxy's requests to its storage nodes (pool and binary
+// channels) since the previous call, which is what the migration executor
+// backs off on. Migration traffic itself is not recorded there.
+class BackendLatencyProbe {
+public:
+    static constexpr uint64_t kMinSamples = 20;
+
+    double operator()() {
+        std::lock_guard<std::mutex> lock(mu_);
+        std::vector<uint64_t> total(Histogram::kBuckets, 0);
+        for (Histogram* h : Metrics::instance().histograms("kv_proxy_backend_request_duration_seconds")) {
+            Histogram::Snapshot snap = h->snapshot();
+            for (size_t i = 0; i < total.size(); ++i) total[i] += snap.counts[i];
+        }
+        std::vector<uint64_t> window(total.size());
+        uint64_t count = 0;
+        for (size_t i = 0; i < total.size(); ++i) {
+            window[i] = total[i] - (last_.empty() ? 0 : last_[i]);
+            count += window[i];
+        }
+        last_ = std::move(total);
+        if (count < kMinSamples) return -1;
+        return static_cast<double>(Histogram::quantile(window, 0.99)) * kNanosToSeconds;
+    }
+
+private:
+    std::mutex mu_;
+    std::vector<uint64_t> last_;  // Cumulative bucket counts at the previous call
+};
+
+// --- REBALANCE JOBS (Executed by Proxy) ---
+// Keys `node` holds, from the "keys" line of its /stats; 0 when unknown.
+size_t node_key_count(ConnectionPool& pool, const std::string& node) {
+    auto cli = pool.acquire(node);
+    if (!cli) return 0;
+    auto res = cli->Get("/stats");
+    if (!res) cli.markBroken();
+    unsigned long long keys;
+    if (!res || res->status != 200 || std::sscanf(res->body.c_str(), "keys %llu", &keys) != 1) return 0;
+    return keys;
+}
+
+// Share of the hash space `ranges` cover.
+double ring_share(const std::vector<HashRange>& ranges) {
+    double width = 0;
+    for (const HashRange& r : ranges) width += static_cast<double>(r.end - r.start);  // Wraps correctly
+    return width / 18446744073709551616.0;
+}
+
+// First run of a job: plans the moves and updates the ring. An add takes
+// ranges from each old owner; a remove hands the node's ranges to each next
+// owner, so its targets are filled in parallel just like an add's sources.
+// Each move's route is in place before the ring changes, so no request
+// reaches a new owner without the fallback to the old one.
+void plan_rebalance(SharedRing& ring, ConnectionPool& pool, MigrationRoutes& routes, RebalanceJob& job) {
+    if (job.op == "add") {
+        LOG_INFO << "[Proxy] Rebalancing for new node: " << job.node << "...";
+        size_t cluster_keys = 0;
+        {
+            auto snapshot = ring.read();
+            for (ConsistentHashRing::NodeId id = 0; id < snapshot->nodeCount(); ++id) {
+                cluster_keys += node_key_count(pool, snapshot->nodeAddress(id));
+            }
+        }
+        ConsistentHashRing next = *ring.read();
+        next.addNode(job.node);
+        double share = 0;
+        for (SourcePlan& plan : next.getRebalancingPlan(job.node)) {
+            share += ring_share(plan.ranges);
+            job.moves.push_back({plan.source_node, job.node, std::move(plan.ranges), "", false, nullptr});
+        }
+        job.keys_estimate = static_cast<size_t>(cluster_keys * share);
+        for (RangeMove& move : job.moves) move.route = routes.add(move.from, move.to, move.ranges);
+        ring.update([&](ConsistentHashRing& r) { r.addNode(job.node); });
+    } else {
+        LOG_INFO << "[Proxy] Evacuating node: " << job.node << "...";
+        // Planned before the removal: each range's "source" is its next owner
+        for (SourcePlan& plan : ring.read()->getRebalancingPlan(job.node)) {
+            job.moves.push_back({job.node, plan.source_node, std::move(plan.ranges), "", false, nullptr});
+        }
+        for (RangeMove& move : job.moves) move.route = routes.add(move.from, move.to, move.ranges);
+        // Remove from ring so new traffic goes to the new owners
+        ring.update([&](ConsistentHashRing& r) { r.removeNode(job.node); });
+        job.keys_estimate = node_key_count(pool, job.node);
+    }
+
+    size_t ranges = 0;
+    for (const RangeMove& move : job.moves) ranges += move.ranges.size();
+    job.ranges_total = ranges;
+    job.planned = true;
+    LOG_INFO << "[Proxy] Plan: " << ranges << " ranges " << (job.op == "add" ? "from " : "to ") << job.moves.size()
+             << " nodes";
+}
+
+// Pacing step: a transfer waits on the executor's token buckets after every
+// this many bytes streamed, which also bounds how late a cancel is noticed.
+constexpr size_t kPaceStepBytes = 64 << 10;
+
+// Runs a job's unfinished moves through the executor, which caps how many
+// run at once and paces them as they stream. Each move records its export
+// cursor once a batch has landed, so a cancelled or failed job resumes where
+// it stopped. Batches are loaded with ?if_absent=1 under a tombstone lease on
+// the move's ranges, so the copy never replaces a newer value or brings back
+// a deleted key (see MigrationRoute).
+bool run_rebalance(SharedRing& ring, ConnectionPool& pool, MigrationRoutes& routes, MigrationExecutor& executor,
+                   RebalanceJob& job) {
+    auto start = std::chrono::steady_clock::now();
+    if (!job.planned) plan_rebalance(ring, pool, routes, job);
+    const size_t keys_before = job.keys_moved, bytes_before = job.bytes_moved;
+
+    std::vector<std::function<void()>> work;
+    for (size_t m = 0; m < job.moves.size(); ++m) {
+        if (job.moves[m].done) continue;
+        work.push_back([&, m] {
+            RangeMove& move = job.moves[m];
+            if (job.cancel) return;
+
+            // 1. Stream the ranges from the OLD owner into batches for the new
+            //    one, under a tombstone lease the new owner holds until the
+            //    copy ends (or, if this process dies, until it expires)
+            uint64_t lease = 0;
+            if (!move.copied && !(lease = open_tombstone_lease(pool, move.to, move.ranges))) {
+                LOG_ERROR << "[Proxy] " << move.to << " refused a tombstone lease; ranges stay on " << move.from;
+                return;
+            }
+            std::string batch, cursor = move.cursor;
+            size_t batch_keys = 0, unpaced_keys = 0, unpaced_bytes = 0;
+            auto pace = [&] {
+                executor.throttle(unpaced_keys, unpaced_bytes);
+                unpaced_keys = unpaced_bytes = 0;
+            };
+            auto flush = [&] {
+                pace();
+                if (!bulk_load(pool, move.to, lease, batch.data(), batch.size())) return false;
+                job.keys_moved += batch_keys;
+                job.bytes_moved += batch.size();
+                move.cursor = cursor;  // Everything streamed so far has landed
+                batch.clear();
+                batch_keys = 0;
+                return true;
+            };
+            bool ok = move.copied || stream_export(pool, move.from, &move.ranges, cursor,
+                                    [&](const char* record, size_t len, const WalRecord&) {
+                batch.append(record, len);
+                batch_keys++;
+                unpaced_keys++;
+                unpaced_bytes += len;
+                if (unpaced_bytes >= kPaceStepBytes) pace();
+                if (job.cancel) return false;
+                return batch.size() < kBulkBatchBytes || flush();
+            });
+            bool landed = move.copied || flush();  // Also what arrived before a cancel or an error
+            if (lease) close_tombstone_lease(pool, move.to, lease);
+            if (!ok || !landed) {
+                if (!job.cancel) {
+                    LOG_ERROR << "[Proxy] Moving ranges from " << move.from << " to " << move.to
+                              << " failed; the rest stay on " << move.from;
+                }
+                return;
+            }
+
+            // 2. Route the ranges to the new owner alone, then drop them from
+            //    the OLD node in one step (a removed node is reset instead).
+            //    If that fails the move stays unfinished, so a resume retries
+            //    the delete without copying again.
+            if (move.route) routes.remove(move.route);
+            move.route.reset();
+            move.copied = true;
+            if (job.op == "add" && !range_delete(pool, move.from, move.ranges)) {
+                LOG_ERROR << "[Proxy] Dropping moved ranges from " << move.from
+                          << " failed; resume the job to retry";
+                return;
+            }
+            move.done = true;
+            job.ranges_done += move.ranges.size();
+        });
+    }
+    executor.run(work);
+
+    bool finished = std::all_of(job.moves.begin(), job.moves.end(), [](const RangeMove& m) { return m.done; });
+    RebalanceStats st;
+    st.keys = job.keys_moved - keys_before;
+    st.bytes = job.bytes_moved - bytes_before;
+    st.nanos = nanos_since(start);
+    record_rebalance(job.op.c_str(), st);
+    if (!finished) return false;
+
+    if (job.op == "add") {
+        LOG_INFO << "[Proxy] Rebalancing Complete. Moved " << job.keys_moved << " keys, " << job.bytes_moved << " bytes.";
+        return true;
+    }
+
+    // 3. THE CLEANUP: Reset the old node completely.
+    // This clears its memory AND deletes the wal_PORT.log file.
+    // The node is now fresh and ready to be used by someone else.
+    // With nothing planned (not in the ring, or the last node) its data stays.
+    std::string ip; int port;
+    if (!job.moves.empty() && get_ip_port(job.node, ip, port)) {
+        httplib::Client victim_cli(ip, port);
+        victim_cli.set_connection_timeout(1);
         victim_cli.Post("/reset");
-        std::cout << "[Proxy] Node " << node_to_remove << " has been RESET (Data cleared, Log deleted).\n";
+        LOG_INFO << "[Proxy] Node " << job.node << " has been RESET (Data cleared, Log deleted).";
+    } else {
+        LOG_WARN << "[Proxy] Warning: nothing to move off " << job.node << "; it was NOT reset.";
     }
-    std::cout << "[Proxy] Evacuation Complete. Moved " << moved_count << " keys.\n";
+    pool.evictIdle(job.node);
+    LOG_INFO << "[Proxy] Evacuation Complete. Moved " << job.keys_moved << " keys, " << job.bytes_moved << " bytes.";
+    return true;
 }
 
-int main() {
-    ConsistentHashRing ring;
+int main(int argc, char* argv[]) {
+    int listen_port = 8000;
+    int binary_port = -1;  // Default: listen_port + kBinaryPortOffset
+    int resp_port = 0;     // Redis-compatible listener; off unless set
+    size_t io_threads = std::min(4u, std::max(1u, std::thread::hardware_concurrency()));
+    ConnectionPool::Options pool_options;
+    int migration_timeout_s = 300;
+    MigrationExecutor::Options migration_options;
+    LogLevel log_level;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string flag = argv[i];
+        if (flag == "--port") listen_port = std::stoi(argv[i + 1]);
+        else if (flag == "--pool-size") pool_options.max_per_backend = std::max<size_t>(1, std::stoul(argv[i + 1]));
+        else if (flag == "--pool-idle-s") pool_options.max_idle_s = std::stoi(argv[i + 1]);
+        else if (flag == "--binary-port") binary_port = std::stoi(argv[i + 1]);
+        else if (flag == "--resp-port") resp_port = std::stoi(argv[i + 1]);
+        else if (flag == "--io-threads") io_threads = std::max<size_t>(1, std::stoul(argv[i + 1]));
+        else if (flag == "--migration-concurrency") migration_options.concurrency = std::stoul(argv[i + 1]);
+        else if (flag == "--migration-rate-mb") migration_options.max_bytes_per_s = std::stod(argv[i + 1]) * 1e6;
+        else if (flag == "--migration-rate-keys") migration_options.max_keys_per_s = std::stod(argv[i + 1]);
+        else if (flag == "--migration-p99-ms") migration_options.target_p99_s = std::stod(argv[i + 1]) / 1e3;
+        else if (flag == "--migration-timeout-s") migration_timeout_s = std::max(1, std::stoi(argv[i + 1]));
+        else if (flag == "--log-sample") Logger::instance().setSampleRate(std::stoul(argv[i + 1]));
+        else if (flag == "--log-level" && parse_log_level(argv[i + 1], log_level)) Logger::instance().setLevel(log_level);
+        else {
+            std::cerr << "Usage: ./kv_proxy [--port N] [--pool-size N] [--pool-idle-s N] [--binary-port N] [--resp-port N]"
+                      << " [--io-threads N] [--migration-concurrency N] [--migration-rate-mb N]"
+                      << " [--migration-rate-keys N] [--migration-p99-ms N] [--migration-timeout-s N]"
+                      << " [--log-level debug|info|warn|error|off] [--log-sample N]\n";
+            return 1;
+        }
+    }
+
+    if (binary_port < 0) binary_port = listen_port + kBinaryPortOffset;
+
+    SharedRing ring;
+    MigrationRoutes routes;
+    ConnectionPool pool(pool_options);
+    // Migrations get their own connections and read timeout: a range delete
+    // or a 4 MB load can run far longer than any data-path request.
+    ConnectionPool::Options migration_pool_options = pool_options;
+    migration_pool_options.read_timeout_s = migration_timeout_s;
+    ConnectionPool migration_pool(migration_pool_options);
+    auto latency_probe = std::make_shared<BackendLatencyProbe>();
+    MigrationExecutor migrations(migration_options, [latency_probe] { return (*latency_probe)(); });
+#ifdef __linux__
+    BackendChannels channels;
+#endif
+    RebalanceJobs jobs([&](RebalanceJob& job) {
+        bool finished = run_rebalance(ring, migration_pool, routes, migrations, job);
+        if (finished && job.op == "remove") pool.evictIdle(job.node);
+#ifdef __linux__
+        if (finished && job.op == "remove") channels.remove(job.node);
+#endif
+        return finished;
+    });
     httplib::Server svr;
+    svr.set_tcp_nodelay(true);  // Keep-alive peers would otherwise hit Nagle + delayed ACK
 
-    std::cout << "--- KV Proxy/Gateway running on Port 8000 ---\n";
+    // Per-endpoint request metrics (see kv_server)
+    EndpointMetrics http_metrics("kv_http", "endpoint", {"/put", "/get", "/mget", "/mput", "/mdel", "/add_node",
+        "/remove_node", "/jobs", "/stats", "/metrics", "/log_level"});
+    static thread_local std::chrono::steady_clock::time_point request_start;
+    svr.set_pre_routing_handler([](const httplib::Request&, httplib::Response&) {
+        request_start = std::chrono::steady_clock::now();
+        return httplib::Server::HandlerResponse::Unhandled;
+    });
+    svr.set_post_routing_handler([&](const httplib::Request& req, httplib::Response& res) {
+        std::string_view path = req.path.rfind("/jobs", 0) == 0 ? "/jobs" : std::string_view(req.path);
+        http_metrics.record(path, http_outcome(res.status), nanos_since(request_start));
+    });
 
-    // 1. DATA API: PUT
+    LOG_INFO << "--- KV Proxy/Gateway running on Port " << listen_port << " (pool " << pool_options.max_per_backend
+             << " conns/backend) ---";
+
+    // 1. DATA API: PUT (a key in a moving range goes to its new owner)
     svr.Post("/put", [&](const httplib::Request& req, httplib::Response& res) {
         std::string key = req.get_param_value("key");
-        std::string target = ring.getNode(key);
+        std::string target = ring.read()->getNode(key);
+        if (auto route = routes.find(key)) target = route->to();
 
         if (target.empty()) {
             res.status = 503;
@@ -132,44 +1000,87 @@ int main() {
             return;
         }
 
-        std::string ip; int port;
-        get_ip_port(target, ip, port);
-        httplib::Client cli(ip, port);
+        auto cli = pool.acquire(target);
+        if (!cli) { res.status = 500; return; }
 
         httplib::Params p;
         p.emplace("key", key);
         p.emplace("val", req.get_param_value("val"));
-        auto cli_res = cli.Post("/put", p);
+        auto start = std::chrono::steady_clock::now();
+        auto cli_res = cli->Post("/put", p);
+        cli.observe(start);
 
         if(cli_res) {
             res.status = cli_res->status;
             res.set_content(cli_res->body, "text/plain");
         } else {
+            cli.markBroken();
             res.status = 500;
         }
     });
 
-    // 2. DATA API: GET
+    // 2. DATA API: GET (a miss on a moving range is retried on its old owner)
     svr.Get("/get", [&](const httplib::Request& req, httplib::Response& res) {
         std::string key = req.get_param_value("key");
-        std::string target = ring.getNode(key);
+        std::string target = ring.read()->getNode(key);
+        auto route = routes.find(key);
+        if (route) target = route->to();
 
         if (target.empty()) { res.status = 503; return; }
 
-        std::string ip; int port;
-        get_ip_port(target, ip, port);
-        httplib::Client cli(ip, port);
+        auto get = [&](const std::string& node) {
+            auto cli = pool.acquire(node);
+            if (!cli) { res.status = 500; return; }
 
-        auto cli_res = cli.Get(("/get?key=" + key).c_str());
-        if(cli_res) {
-            res.status = cli_res->status;
-            res.set_content(cli_res->body, "text/plain");
-        } else {
-            res.status = 500;
-        }
+            auto start = std::chrono::steady_clock::now();
+            auto cli_res = cli->Get("/get", httplib::Params{{"key", key}}, httplib::Headers());
+            cli.observe(start);
+            if(cli_res) {
+                res.status = cli_res->status;
+                res.set_content(cli_res->body, "text/plain");
+            } else {
+                cli.markBroken();
+                res.status = 500;
+            }
+        };
+        get(target);
+        if (res.status == 404 && route) get(route->from());
+    });
+
+    // 2b. DATA API: MULTI-KEY (bodies in batch_codec.hpp)
+    auto batch_reply = [](httplib::Response& res, const std::vector<BatchResult>& results) {
+        std::string body;
+        encode_batch_results(body, results);
+        res.set_content(body, "application/octet-stream");
+    };
+
+    svr.Post("/mget", [&](const httplib::Request& req, httplib::Response& res) {
+        std::vector<std::string_view> keys;
+        if (!decode_batch_keys(req.body, keys)) { res.status = 400; return; }
+        batch_reply(res, fan_out(ring, routes, pool, "/mget", keys, nullptr));
+    });
+
+    svr.Post("/mput", [&](const httplib::Request& req, httplib::Response& res) {
+        std::vector<std::string_view> keys, values;
+        if (!decode_batch_pairs(req.body, keys, values)) { res.status = 400; return; }
+        batch_reply(res, fan_out(ring, routes, pool, "/mput", keys, &values));
     });
 
-    // 3. ADMIN API: ADD NODE
+    svr.Post("/mdel", [&](const httplib::Request& req, httplib::Response& res) {
+        std::vector<std::string_view> keys;
+        if (!decode_batch_keys(req.body, keys)) { res.status = 400; return; }
+        batch_reply(res, fan_out(ring, routes, pool, "/mdel", keys, nullptr));
+    });
+
+    // 3. ADMIN API: ADD NODE (and 4, REMOVE NODE) answer 202 with a job ID at
+    // once; the data moves in the background (see 4b)
+    auto accepted = [](httplib::Response& res, const RebalanceJob& job) {
+        res.status = 202;
+        std::string id = std::to_string(job.id);
+        res.set_content("Accepted: job " + id + " (" + job.op + " " + job.node + "); GET /jobs/" + id + " for progress",
+                        "text/plain");
+    };
+
     svr.Post("/add_node", [&](const httplib::Request& req, httplib::Response& res) {
         std::string host = req.get_param_value("host");
         host = sanitize_host(host);
@@ -182,18 +1093,20 @@ int main() {
         auto check = temp_client.Get("/status");
 
         if (!check || check->status != 200) {
-            std::cout << "[Error] Refusing to add dead node: " << host << "\n";
+            LOG_WARN << "[Error] Refusing to add dead node: " << host;
             res.status = 503;
             res.set_content("Error: Target node is not reachable.", "text/plain");
             return;
         }
-        std::cout << "[Proxy] Health Check Passed for " << host << ". Adding to ring...\n";
-
-        // --- ADD & REBALANCE ---
-        ring.addNode(host);
-        optimized_rebalance_add(ring, host);
+        LOG_INFO << "[Proxy] Health Check Passed for " << host << ". Adding to ring...";
+#ifdef __linux__
+        if (check->has_header("X-Binary-Port")) {
+            try { channels.add(host, ip, std::stoi(check->get_header_value("X-Binary-Port"))); } catch (...) {}
+        }
+#endif
 
-        res.set_content("Success: Node Added " + host, "text/plain");
+        // --- ADD & REBALANCE (the job adds it to the ring when it starts) ---
+        accepted(res, *jobs.submit("add", host));
     });
 
     // 4. ADMIN API: REMOVE NODE
@@ -201,10 +1114,112 @@ int main() {
         std::string host = req.get_param_value("host");
         host = sanitize_host(host);
 
-        rebalance_remove(ring, host);
+        accepted(res, *jobs.submit("remove", host));
+    });
+
+    // 4b. ADMIN API: JOBS. GET /jobs lists them and GET /jobs/<id> reports
+    // one; POST /jobs/<id>/cancel stops one and /jobs/<id>/resume restarts it
+    svr.Get("/jobs", [&](const httplib::Request&, httplib::Response& res) {
+        res.set_content(jobs.list(), "text/plain");
+    });
+    svr.Get(R"(/jobs/(\d+))", [&](const httplib::Request& req, httplib::Response& res) {
+        std::string out;
+        if (!jobs.describe(std::stoull(req.matches[1]), out)) {
+            res.status = 404;
+            res.set_content("No such job", "text/plain");
+            return;
+        }
+        res.set_content(out, "text/plain");
+    });
+    auto job_reply = [](httplib::Response& res, RebalanceJobs::Result result, const char* conflict) {
+        if (result == RebalanceJobs::Result::Ok) {
+            res.set_content("OK", "text/plain");
+        } else if (result == RebalanceJobs::Result::NotFound) {
+            res.status = 404;
+            res.set_content("No such job", "text/plain");
+        } else {
+            res.status = 409;
+            res.set_content(conflict, "text/plain");
+        }
+    };
+    svr.Post(R"(/jobs/(\d+)/cancel)", [&](const httplib::Request& req, httplib::Response& res) {
+        job_reply(res, jobs.cancel(std::stoull(req.matches[1])), "Job is not queued or running");
+    });
+    svr.Post(R"(/jobs/(\d+)/resume)", [&](const httplib::Request& req, httplib::Response& res) {
+        job_reply(res, jobs.resume(std::stoull(req.matches[1])),
+                  "Job cannot be resumed: it has not stopped, or another job has changed the ring since");
+    });
+
+    // 5. OBSERVABILITY: connection pool hit rate and wait time per backend
+    svr.Get("/stats", [&](const httplib::Request&, httplib::Response& res) {
+        res.set_content(pool.statsText() + "log_dropped " + std::to_string(Logger::instance().dropped()) + "\n",
+                        "text/plain");
+    });
+
+    // Prometheus scrape target
+    Metrics::instance().addCollector([&migrations](std::string& out) {
+        metric_header(out, "kv_migration_rate_ratio", "Migration pace as a fraction of the configured maximum.", "gauge");
+        metric_sample(out, "kv_migration_rate_ratio", "", migrations.rateFraction());
+        metric_header(out, "kv_migration_active_transfers", "Migration transfers running now.", "gauge");
+        metric_sample(out, "kv_migration_active_transfers", "", static_cast<double>(migrations.activeTransfers()));
+        metric_header(out, "kv_log_dropped_total", "Log lines dropped because the log ring was full.", "counter");
+        metric_sample(out, "kv_log_dropped_total", "", static_cast<double>(Logger::instance().dropped()));
+    });
+    svr.Get("/metrics", [&](const httplib::Request&, httplib::Response& res) {
+        res.set_content(Metrics::instance().render(), "text/plain; version=0.0.4");
+    });
 
-        res.set_content("Node Removed: " + host, "text/plain");
+    // Runtime log settings: ?level=debug|info|warn|error|off and/or ?sample=N
+    svr.Post("/log_level", [&](const httplib::Request& req, httplib::Response& res) {
+        Logger& logger = Logger::instance();
+        if (req.has_param("level")) {
+            LogLevel level;
+            if (!parse_log_level(req.get_param_value("level"), level)) {
+                res.status = 400;
+                res.set_content("Unknown log level", "text/plain");
+                return;
+            }
+            logger.setLevel(level);
+        }
+        if (req.has_param("sample")) {
+            try {
+                logger.setSampleRate(std::stoul(req.get_param_value("sample")));
+            } catch (...) {
+                res.status = 400;
+                res.set_content("Bad sample rate", "text/plain");
+                return;
+            }
+        }
+        res.set_content(std::string("level ") + log_level_name(logger.level()) + " sample " +
+                        std::to_string(logger.sampleRate()), "text/plain");
     });
 
-    svr.listen("0.0.0.0", 8000);
+    // 6. BINARY + REDIS PROTOCOLS (data path only; HTTP stays for admin)
+#ifdef __linux__
+    EndpointMetrics binary_metrics("kv_binary", "op", {"ping", "get", "put", "del", "mget", "mput", "mdel"});
+    EndpointMetrics resp_metrics("kv_resp", "command", {"ping", "get", "set", "del", "mget", "mset"});
+    std::unique_ptr<FrameServer> binary;
+    if (binary_port > 0) {
+        binary = std::make_unique<FrameServer>(
+            [&](const Frame& req, FrameServer::Reply reply) {
+                serve_frame(ring, routes, channels, binary_metrics, req, std::move(reply));
+            },
+            io_threads);
+        if (!binary->start(binary_port)) return 1;
+        LOG_INFO << "--- Binary protocol on port " << binary_port << " (" << io_threads << " I/O threads) ---";
+    }
+    std::unique_ptr<FrameServer> resp;
+    if (resp_port > 0) {
+        resp = std::make_unique<FrameServer>(
+            frame_resp_command,
+            [&](std::string_view command, FrameServer::Reply reply) {
+                serve_resp(ring, routes, channels, resp_metrics, command, std::move(reply));
+            },
+            io_threads, "RESP");
+        if (!resp->start(resp_port)) return 1;
+        LOG_INFO << "--- Redis (RESP2) protocol on port " << resp_port << " ---";
+    }
+#endif
+
+    svr.listen("0.0.0.0", listen_port);
 }
\ No newline at end of file
@@ -0,0 +1,137 @@
+#include "../../include/migration_executor.hpp"
+#include "../../include/logger.hpp"
+#include <algorithm>
+#include <atomic>
+#include <thread>
+
+// --- TOKEN BUCKET ---
+
+TokenBucket::TokenBucket(double rate, double burst)
+    : rate_(rate), burst_(burst), tokens_(burst), last_(std::chrono::steady_clock::now()) {}
+
+void TokenBucket::refill(std::chrono::steady_clock::time_point now) {
+    double elapsed = std::chrono::duration<double>(now - last_).count();
+    last_ = now;
+    tokens_ = std::min(burst_, tokens_ + rate_ * elapsed);
+}
+
+std::chrono::nanoseconds TokenBucket::take(double n) {
+    std::lock_guard<std::mutex> lock(mu_);
+    if (rate_ <= 0) return std::chrono::nanoseconds(0);
+    refill(std::chrono::steady_clock::now());
+    tokens_ -= n;
+    if (tokens_ >= 0) return std::chrono::nanoseconds(0);
+    return std::chrono::nanoseconds(static_cast<int64_t>(-tokens_ / rate_ * 1e9));
+}
+
+void TokenBucket::setRate(double rate) {
+    std::lock_guard<std::mutex> lock(mu_);
+    refill(std::chrono::steady_clock::now());
+    rate_ = rate;
+}
+
+double TokenBucket::rate() const {
+    std::lock_guard<std::mutex> lock(mu_);
+    return rate_;
+}
+
+// --- EXECUTOR ---
+
+// Buckets hold a quarter second of traffic at full speed.
+MigrationExecutor::MigrationExecutor(Options options, LatencyProbe probe)
+    : options_(options),
+      probe_(std::move(probe)),
+      bytes_(options.max_bytes_per_s, options.max_bytes_per_s / 4),
+      keys_(options.max_keys_per_s, options.max_keys_per_s / 4),
+      next_control_(std::chrono::steady_clock::now() + options.control_interval) {
+    options_.concurrency = std::max<size_t>(1, options_.concurrency);
+}
+
+void MigrationExecutor::run(const std::vector<std::function<void()>>& jobs) {
+    // A fresh rebalance starts at full speed, judged on fresh latencies
+    bool fresh;
+    {
+        std::lock_guard<std::mutex> lock(mu_);
+        fresh = active_ == 0;
+        if (fresh) {
+            fraction_ = 1;
+            bytes_.setRate(options_.max_bytes_per_s);
+            keys_.setRate(options_.max_keys_per_s);
+            next_control_ = std::chrono::steady_clock::now() + options_.control_interval;
+        }
+    }
+    if (fresh && probe_) probe_();
+
+    std::atomic<size_t> next{0};
+    auto worker = [&] {
+        for (size_t i; (i = next.fetch_add(1)) < jobs.size();) {
+            {
+                std::unique_lock<std::mutex> lock(mu_);
+                slot_cv_.wait(lock, [&] { return active_ < options_.concurrency; });
+                active_++;
+            }
+            jobs[i]();
+            {
+                std::lock_guard<std::mutex> lock(mu_);
+                active_--;
+            }
+            slot_cv_.notify_one();
+        }
+    };
+    std::vector<std::thread> workers;
+    size_t threads = std::min(jobs.size(), options_.concurrency);
+    for (size_t t = 1; t < threads; ++t) workers.emplace_back(worker);
+    if (threads > 0) worker();  // The caller is one of the workers
+    for (auto& t : workers) t.join();
+}
+
+void MigrationExecutor::throttle(size_t keys, size_t bytes) {
+    auto now = std::chrono::steady_clock::now();
+    bool control = false;
+    {
+        std::lock_guard<std::mutex> lock(mu_);
+        if (now >= next_control_) {
+            next_control_ = now + options_.control_interval;
+            control = true;
+        }
+    }
+    if (control) adapt();
+    auto wait = std::max(bytes_.take(static_cast<double>(bytes)), keys_.take(static_cast<double>(keys)));
+    if (wait.count() > 0) std::this_thread::sleep_for(wait);
+}
+
+// The probe runs without mu_ held: it reads the metrics registry, whose
+// scrapes read this executor.
+void MigrationExecutor::adapt() {
+    if (options_.target_p99_s <= 0 || !probe_) return;
+
+    double p99 = probe_();
+    std::lock_guard<std::mutex> lock(mu_);
+    double previous = fraction_;
+    if (p99 > options_.target_p99_s) {
+        fraction_ = std::max(options_.min_fraction, fraction_ / 2);
+    } else {
+        fraction_ = std::min(1.0, fraction_ + 0.1);  // Also when too quiet to judge
+    }
+    if (fraction_ == previous) return;
+
+    bytes_.setRate(options_.max_bytes_per_s * fraction_);
+    keys_.setRate(options_.max_keys_per_s * fraction_);
+    if (fraction_ < previous) {
+        LOG_WARN << "[Migration] Backend p99 " << p99 * 1e3 << " ms over the " << options_.target_p99_s * 1e3
+                 << " ms target; migrating at " << fraction_ * 100 << "% of the maximum rate";
+    } else {
+        LOG_DEBUG << "[Migration] Backend p99 " << (p99 < 0 ? 0.0 : p99 * 1e3) << " ms; migrating at "
+                  << fraction_ * 100 << "% of the maximum rate";
+    }
+}
+
+double MigrationExecutor::rateFraction() const {
+    std::lock_guard<std::mutex> lock(mu_);
+    return fraction_;
+}
+
+size_t MigrationExecutor::activeTransfers() const {
+    std::lock_guard<std::mutex> lock(mu_);
+    return active_;
+}
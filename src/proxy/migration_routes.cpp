@@ -0,0 +1,28 @@
+#include "../../include/migration_routes.hpp"
+#include <algorithm>
+#include <mutex>
+
+std::shared_ptr<MigrationRoute> MigrationRoutes::add(const std::string& from, const std::string& to,
+                                                     const std::vector<HashRange>& ranges) {
+    auto route = std::make_shared<MigrationRoute>(from, to, ranges);
+    std::unique_lock<std::shared_mutex> lock(mu_);
+    routes_.push_back(route);
+    count_.store(routes_.size(), std::memory_order_release);
+    return route;
+}
+
+void MigrationRoutes::remove(const std::shared_ptr<MigrationRoute>& route) {
+    std::unique_lock<std::shared_mutex> lock(mu_);
+    routes_.erase(std::remove(routes_.begin(), routes_.end(), route), routes_.end());
+    count_.store(routes_.size(), std::memory_order_release);
+}
+
+std::shared_ptr<MigrationRoute> MigrationRoutes::find(std::string_view key) const {
+    if (empty()) return nullptr;
+    size_t hash = ConsistentHashRing::hash_key(key);
+    std::shared_lock<std::shared_mutex> lock(mu_);
+    for (auto it = routes_.rbegin(); it != routes_.rend(); ++it) {  // Newest first
+        if ((*it)->covers(hash)) return *it;
+    }
+    return nullptr;
+}
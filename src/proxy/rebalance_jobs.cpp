@@ -0,0 +1,190 @@
+#include "../../include/rebalance_jobs.hpp"
+#include "../../include/logger.hpp"
+#include <algorithm>
+
+namespace {
+
+const char* state_name(RebalanceJob::State state) {
+    switch (state) {
+        case RebalanceJob::State::Queued: return "queued";
+        case RebalanceJob::State::Running: return "running";
+        case RebalanceJob::State::Cancelled: return "cancelled";
+        case RebalanceJob::State::Done: return "done";
+        case RebalanceJob::State::Failed: return "failed";
+    }
+    return "unknown";
+}
+
+}  // namespace
+
+RebalanceJobs::RebalanceJobs(Runner runner) : runner_(std::move(runner)), worker_([this] { work(); }) {}
+
+RebalanceJobs::~RebalanceJobs() {
+    {
+        std::lock_guard<std::mutex> lock(mu_);
+        stop_ = true;
+        for (auto& j : jobs_) j.second.job->cancel = true;
+    }
+    cv_.notify_all();
+    worker_.join();
+}
+
+std::shared_ptr<RebalanceJob> RebalanceJobs::submit(const std::string& op, const std::string& node) {
+    auto job = std::make_shared<RebalanceJob>();
+    job->op = op;
+    job->node = node;
+    {
+        std::lock_guard<std::mutex> lock(mu_);
+        job->id = next_id_++;
+        jobs_[job->id].job = job;
+        queue_.push_back(job->id);
+        LOG_INFO << "[Proxy] Job " << job->id << " queued: " << op << " " << node;
+    }
+    cv_.notify_all();
+    return job;
+}
+
+RebalanceJobs::Result RebalanceJobs::cancel(uint64_t id) {
+    std::lock_guard<std::mutex> lock(mu_);
+    auto it = jobs_.find(id);
+    if (it == jobs_.end()) return Result::NotFound;
+    Entry& e = it->second;
+    if (e.state == RebalanceJob::State::Queued) {
+        queue_.erase(std::remove(queue_.begin(), queue_.end(), id), queue_.end());
+        e.state = RebalanceJob::State::Cancelled;
+        return Result::Ok;
+    }
+    if (e.state != RebalanceJob::State::Running) return Result::Conflict;
+    e.job->cancel = true;  // The worker records the state when the runner returns
+    if (e.finishing) jobs_[e.finishing].job->cancel = true;
+    return Result::Ok;
+}
+
+bool RebalanceJobs::resumable(const Entry& e) {
+    return e.state == RebalanceJob::State::Cancelled || e.state == RebalanceJob::State::Failed;
+}
+
+RebalanceJobs::Result RebalanceJobs::resume(uint64_t id) {
+    {
+        std::lock_guard<std::mutex> lock(mu_);
+        auto it = jobs_.find(id);
+        if (it == jobs_.end()) return Result::NotFound;
+        Entry& e = it->second;
+        if (!resumable(e)) return Result::Conflict;
+        e.state = RebalanceJob::State::Queued;
+        e.job->cancel = false;
+        if (e.job->planned) queue_.push_front(id);  // Nothing else may plan first
+        else queue_.push_back(id);
+        LOG_INFO << "[Proxy] Job " << id << " resumed";
+    }
+    cv_.notify_all();
+    return Result::Ok;
+}
+
+void RebalanceJobs::work() {
+    std::unique_lock<std::mutex> lock(mu_);
+    while (true) {
+        cv_.wait(lock, [&] { return stop_ || !queue_.empty(); });
+        if (stop_) return;
+        Entry& e = jobs_[queue_.front()];
+        queue_.pop_front();
+        if (!e.job->planned && !finishStoppedLocked(lock, e)) continue;
+        runLocked(lock, e);
+    }
+}
+
+// Runs `e` with the lock released and records how it ended.
+void RebalanceJobs::runLocked(std::unique_lock<std::mutex>& lock, Entry& e) {
+    e.state = RebalanceJob::State::Running;
+    e.run_start = std::chrono::steady_clock::now();
+    std::shared_ptr<RebalanceJob> job = e.job;
+
+    lock.unlock();
+    bool finished = runner_(*job);
+    lock.lock();
+
+    e.active += std::chrono::steady_clock::now() - e.run_start;
+    if (finished) e.state = RebalanceJob::State::Done;
+    else if (job->cancel) e.state = RebalanceJob::State::Cancelled;
+    else e.state = RebalanceJob::State::Failed;
+    LOG_INFO << "[Proxy] Job " << job->id << " " << state_name(e.state) << ": " << job->op << " " << job->node
+             << " (" << job->keys_moved << " keys, " << job->bytes_moved << " bytes moved)";
+}
+
+// Before `e` plans against the ring: a stopped job that has planned already
+// changed it, and some of its keys are still on their old owners behind its
+// routes. Its moves run to the end first, with `e` shown as running. Returns
+// false, with `e` stopped, if one of them stops again.
+bool RebalanceJobs::finishStoppedLocked(std::unique_lock<std::mutex>& lock, Entry& e) {
+    for (auto& j : jobs_) {  // std::map: entries submitted meanwhile leave the iterator valid
+        Entry& stopped = j.second;
+        if (&stopped == &e || !stopped.job->planned || !resumable(stopped)) continue;
+        LOG_INFO << "[Proxy] Job " << e.job->id << " first finishes stopped job " << stopped.job->id;
+        e.state = RebalanceJob::State::Running;
+        e.run_start = std::chrono::steady_clock::now();
+        e.finishing = stopped.job->id;
+        stopped.job->cancel = e.job->cancel.load();
+        runLocked(lock, stopped);
+        e.finishing = 0;
+        e.active += std::chrono::steady_clock::now() - e.run_start;
+        if (stopped.state != RebalanceJob::State::Done) {
+            e.state = e.job->cancel ? RebalanceJob::State::Cancelled : RebalanceJob::State::Failed;
+            LOG_ERROR << "[Proxy] Job " << e.job->id << " " << state_name(e.state) << " before changing the ring: job "
+                      << stopped.job->id << " did not finish; resume it, then this one";
+            return false;
+        }
+    }
+    return true;
+}
+
+// The ETA assumes the keys still to move go at the average rate so far.
+std::string RebalanceJobs::describeLocked(const Entry& e) const {
+    const RebalanceJob& job = *e.job;
+    auto active = e.active;
+    if (e.state == RebalanceJob::State::Running) active += std::chrono::steady_clock::now() - e.run_start;
+    int64_t elapsed_ms = std::chrono::duration_cast<std::chrono::milliseconds>(active).count();
+    size_t keys = job.keys_moved, estimate = job.keys_estimate;
+
+    int64_t eta_ms = -1;  // Unknown
+    if (e.state == RebalanceJob::State::Done) {
+        eta_ms = 0;
+    } else if (keys > 0) {
+        size_t left = estimate > keys ? estimate - keys : 0;
+        eta_ms = static_cast<int64_t>(static_cast<double>(left) * elapsed_ms / keys);
+    }
+
+    std::string out;
+    out += "id " + std::to_string(job.id) + "\n";
+    out += "op " + job.op + "\n";
+    out += "node " + job.node + "\n";
+    out += std::string("state ") + state_name(e.state) + "\n";
+    out += "resumable " + std::to_string(resumable(e) ? 1 : 0) + "\n";
+    out += "ranges_done " + std::to_string(job.ranges_done) + "\n";
+    out += "ranges_total " + std::to_string(job.ranges_total) + "\n";
+    out += "keys_moved " + std::to_string(keys) + "\n";
+    out += "bytes_moved " + std::to_string(job.bytes_moved) + "\n";
+    out += "keys_estimate " + std::to_string(estimate) + "\n";
+    out += "elapsed_ms " + std::to_string(elapsed_ms) + "\n";
+    out += "eta_ms " + std::to_string(eta_ms) + "\n";
+    return out;
+}
+
+bool RebalanceJobs::describe(uint64_t id, std::string& out) const {
+    std::lock_guard<std::mutex> lock(mu_);
+    auto it = jobs_.find(id);
+    if (it == jobs_.end()) return false;
+    out = describeLocked(it->second);
+    return true;
+}
+
+std::string RebalanceJobs::list() const {
+    std::lock_guard<std::mutex> lock(mu_);
+    std::string out;
+    for (const auto& j : jobs_) {
+        const RebalanceJob& job = *j.second.job;
+        out += std::to_string(job.id) + " " + job.op + " " + job.node + " " + state_name(j.second.state) + " " +
+               std::to_string(job.ranges_done) + "/" + std::to_string(job.ranges_total) + " ranges " +
+               std::to_string(job.keys_moved) + " keys\n";
+    }
+    return out;
+}
@@ -0,0 +1,239 @@
+#include "../../include/checkpoint.hpp"
+#include "../../include/file_util.hpp"
+#include "../../include/logger.hpp"
+#include "../../include/wal_format.hpp"
+#include "../../include/crc32c.hpp"
+#include "../../include/wal_replay.hpp"
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <shared_mutex>
+#include <vector>
+
+namespace {
+using Clock = std::chrono::steady_clock;
+
+uint64_t elapsed_ms(Clock::time_point since) {
+    return static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - since).count());
+}
+
+bool file_exists(const std::string& path) {
+    std::error_code ec;
+    return std::filesystem::exists(path, ec);
+}
+} // namespace
+
+CheckpointManager::CheckpointManager(ShardStore& store, WalWriter& wal, std::string snapshot_path, std::string wal_path)
+    : store_(store), wal_(wal), snapshot_path_(std::move(snapshot_path)), wal_path_(std::move(wal_path)),
+      rotated_path_(wal_path_ + ".ckpt") {}
+
+CheckpointManager::~CheckpointManager() { stop(); }
+
+// --- RESTORE ---
+
+bool CheckpointManager::restore(unsigned replay_threads) {
+    replay_threads_ = replay_threads > 0 ? replay_threads : 1;
+    auto start = Clock::now();
+    uint64_t snapshot_keys = 0, wal_records = 0;
+
+    // 1. Snapshot (if any checkpoint ever completed)
+    if (file_exists(snapshot_path_) && !replayFile(snapshot_path_, true, snapshot_keys)) return false;
+
+    // 2. Rotated segment of an interrupted checkpoint, then the active WAL
+    bool interrupted = file_exists(rotated_path_);
+    if (interrupted && !replayFile(rotated_path_, false, wal_records)) return false;
+    if (!replayFile(wal_path_, false, wal_records)) return false;
+
+    stats_.restore_ms = elapsed_ms(start);
+    stats_.restored_snapshot_keys = snapshot_keys;
+    if (file_exists(snapshot_path_)) {
+        std::error_code ec;
+        stats_.snapshot_bytes = std::filesystem::file_size(snapshot_path_, ec);
+        stats_.snapshot_keys = snapshot_keys;
+    }
+    stats_.replayed_wal_records = wal_records;
+    LOG_INFO << "[Checkpoint] Restored " << snapshot_keys << " snapshot keys + " << wal_records
+             << " WAL records in " << stats_.restore_ms << " ms.";
+
+    // 3. Finish the interrupted checkpoint before the next rotation would
+    //    overwrite the segment it still depends on.
+    if (interrupted) {
+        if (!writeSnapshot()) return false;
+        std::remove(rotated_path_.c_str());
+    }
+    return true;
+}
+
+bool CheckpointManager::replayFile(const std::string& path, bool is_snapshot, uint64_t& records) {
+    MappedFile file;
+    if (!file.open(path) || file.size() == 0) return true;
+    std::string_view data(file.data(), file.size());
+
+    if (is_snapshot && !has_snapshot_header(data)) {
+        LOG_ERROR << "[Checkpoint] " << path << " is not a snapshot file";
+        return false;
+    }
+    if (!is_snapshot && !has_wal_header(data)) {
+        file.close();
+        LOG_INFO << "[WAL] Converting text log " << path << " to binary format...";
+        long converted = convert_text_wal(path);
+        if (converted < 0) { LOG_ERROR << "[WAL] Conversion of " << path << " failed"; return false; }
+        LOG_INFO << "[WAL] Converted " << converted << " records (original kept as " << path << ".txt.bak)";
+        return replayFile(path, is_snapshot, records);
+    }
+
+    LOG_INFO << "[" << (is_snapshot ? "Checkpoint" : "WAL") << "] Restoring from " << path << " ("
+             << file.size() << " bytes, " << replay_threads_ << " threads, crc32c: " << crc32c_kernel() << ")...";
+    ReplayResult result = replay_records(store_, file.data(), file.size(), kWalHeaderSize, replay_threads_);
+    records += result.records;
+
+    if (result.valid_bytes < file.size()) {
+        if (is_snapshot) {
+            // Snapshots are renamed into place only after an fsync, so damage here is real data loss.
+            LOG_ERROR << "[Checkpoint] Corrupt snapshot record at offset " << result.valid_bytes << " in " << path;
+            return false;
+        }
+        size_t tail = file.size() - result.valid_bytes;
+        if (result.tail == WalDecode::Incomplete) {
+            // A write cut short by a crash: never acknowledged, safe to drop
+            LOG_WARN << "[WAL] Torn record at offset " << result.valid_bytes << ", discarding " << tail
+                     << " trailing bytes";
+        } else {
+            // A bad record may have acknowledged ones behind it; keep them for inspection
+            std::string kept = path + ".corrupt";
+            int fd = file_open_trunc(kept);
+            bool saved = fd >= 0 && file_write_all(fd, file.data() + result.valid_bytes, tail) && file_sync(fd);
+            if (fd >= 0) file_close(fd);
+            if (!saved) {
+                LOG_ERROR << "[WAL] Corrupt record at offset " << result.valid_bytes << " in " << path
+                          << " and its " << tail << " trailing bytes could not be saved to " << kept;
+                return false;
+            }
+            LOG_ERROR << "[WAL] Corrupt record at offset " << result.valid_bytes << " in " << path << "; moved the "
+                      << tail << " bytes from there on to " << kept;
+        }
+        file.close();
+        std::error_code ec;
+        std::filesystem::resize_file(path, result.valid_bytes, ec);
+        if (ec) {
+            LOG_ERROR << "[WAL] Cannot truncate " << path << ": " << ec.message();
+            return false;
+        }
+    }
+    return true;
+}
+
+// --- CHECKPOINT ---
+
+bool CheckpointManager::checkpoint() {
+    std::lock_guard<std::mutex> lock(checkpoint_mutex_);
+    auto start = Clock::now();
+
+    // 1. Cut the WAL: everything applied so far is in the rotated segment
+    if (!wal_.rotate(rotated_path_)) {
+        LOG_ERROR << "[Checkpoint] WAL rotation failed";
+        return false;
+    }
+    // 2. Snapshot covers the rotated segment (and possibly some newer ops)
+    if (!writeSnapshot()) return false;
+    // 3. The rotated segment is now redundant
+    std::remove(rotated_path_.c_str());
+
+    stats_.checkpoints++;
+    stats_.last_checkpoint_ms = elapsed_ms(start);
+    LOG_INFO << "[Checkpoint] Wrote " << stats_.snapshot_keys << " keys (" << stats_.snapshot_bytes
+             << " bytes) in " << stats_.last_checkpoint_ms << " ms.";
+    return true;
+}
+
+bool CheckpointManager::writeSnapshot() {
+    std::string tmp_path = snapshot_path_ + ".tmp";
+    int fd = file_open_trunc(tmp_path);
+    if (fd < 0) {
+        LOG_ERROR << "[Checkpoint] Cannot create " << tmp_path;
+        return false;
+    }
+
+    // Encode one shard at a time under its shared lock: readers are never
+    // blocked, and writers only wait for their own shard.
+    std::string buf = snapshot_file_header();
+    uint64_t bytes = 0, keys = 0;
+    bool ok = true;
+    for (size_t i = 0; i < store_.shardCount() && ok; ++i) {
+        const Shard& shard = store_.shard(i);
+        {
+            std::shared_lock<std::shared_mutex> lock(shard.mutex);
+            shard.map.forEach([&](std::string_view key, const std::string& val) {
+                encode_wal_record(buf, WalOp::Set, key, val);
+            });
+            keys += shard.map.size();
+        }
+        ok = file_write_all(fd, buf.data(), buf.size());
+        bytes += buf.size();
+        buf.clear();
+    }
+    ok = ok && file_sync(fd);
+    file_close(fd);
+
+    if (!ok || std::rename(tmp_path.c_str(), snapshot_path_.c_str()) != 0) {
+        LOG_ERROR << "[Checkpoint] Writing " << snapshot_path_ << " failed";
+        std::remove(tmp_path.c_str());
+        return false;
+    }
+    file_sync_parent_dir(snapshot_path_);
+    stats_.snapshot_bytes = bytes;
+    stats_.snapshot_keys = keys;
+    return true;
+}
+
+// --- BACKGROUND THREAD ---
+
+void CheckpointManager::start(int interval_s, uint64_t wal_bytes_limit) {
+    if (interval_s <= 0 && wal_bytes_limit == 0) return;
+    stop_ = false;
+    thread_ = std::thread(&CheckpointManager::run, this, interval_s, wal_bytes_limit);
+}
+
+void CheckpointManager::stop() {
+    {
+        std::lock_guard<std::mutex> lock(thread_mutex_);
+        stop_ = true;
+    }
+    thread_cv_.notify_all();
+    if (thread_.joinable()) thread_.join();
+}
+
+void CheckpointManager::run(int interval_s, uint64_t wal_bytes_limit) {
+    auto last = Clock::now();
+    std::unique_lock<std::mutex> lock(thread_mutex_);
+    while (!thread_cv_.wait_for(lock, std::chrono::seconds(1), [&] { return stop_; })) {
+        bool due = interval_s > 0 && Clock::now() - last >= std::chrono::seconds(interval_s);
+        bool too_big = wal_bytes_limit > 0 && wal_.logBytes() >= wal_bytes_limit;
+        if (!due && !too_big) continue;
+
+        lock.unlock();
+        checkpoint();
+        last = Clock::now();
+        lock.lock();
+    }
+}
+
+// --- RESET ---
+
+void CheckpointManager::reset() {
+    std::lock_guard<std::mutex> checkpoint_lock(checkpoint_mutex_);
+
+    // Hold every shard lock so no write lands between the clear and the truncate
+    std::vector<std::unique_lock<std::shared_mutex>> locks;
+    for (size_t i = 0; i < store_.shardCount(); ++i) {
+        Shard& shard = store_.shard(i);
+        locks.emplace_back(shard.mutex);
+        shard.clear();
+    }
+    wal_.reset();
+    std::remove(snapshot_path_.c_str());
+    std::remove(rotated_path_.c_str());
+    stats_.snapshot_bytes = 0;
+    stats_.snapshot_keys = 0;
+}
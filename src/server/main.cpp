@@ -1,189 +1,767 @@
+#include "../../include/batch_codec.hpp"
+#include "../../include/binary_protocol.hpp"
 #include "../../include/httplib.h"
+#include "../../include/shard_store.hpp"
+#include "../../include/wal_writer.hpp"
+#include "../../include/wal_format.hpp"
+#include "../../include/checkpoint.hpp"
+#include "../../include/logger.hpp"
+#include "../../include/metrics.hpp"
 #include <iostream>
 #include <string>
-#include <unordered_map>
 #include <mutex>
+#include <shared_mutex>
 #include <vector>
 #include <sstream>
-#include <fstream>
+#include <thread>
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <memory>
+#include <stdexcept>
+#ifdef __linux__
+#include "../../include/frame_server.hpp"
+#endif
 
 using namespace std;
 
-// --- STORAGE & CONCURRENCY ---
-const int NUM_SHARDS = 16;
-unordered_map<string, string> db_shards[NUM_SHARDS];
-mutex shard_mutexes[NUM_SHARDS];
-
 // --- WAL GLOBALS ---
-ofstream wal_file;
-mutex wal_mutex;
+WalWriter wal;
+
+// --- SHARD LOCKS ---
+// Data-path shard locks are taken through these so that contention shows up
+// in kv_shard_lock_wait_seconds. An uncontended lock records a zero wait
+// without reading the clock.
+Histogram& shared_lock_wait = Metrics::instance().histogram(
+    "kv_shard_lock_wait_seconds", "Time spent waiting for a shard lock.", metric_label("mode", "shared"), kNanosToSeconds);
+Histogram& exclusive_lock_wait = Metrics::instance().histogram(
+    "kv_shard_lock_wait_seconds", "Time spent waiting for a shard lock.", metric_label("mode", "exclusive"), kNanosToSeconds);
 
-// --- HASHING HELPERS ---
+template <typename Lock>
+Lock timed_lock(shared_mutex& mutex, Histogram& wait) {
+    Lock lock(mutex, try_to_lock);
+    if (lock.owns_lock()) {
+        wait.record(0);
+    } else {
+        auto start = chrono::steady_clock::now();
+        lock.lock();
+        wait.recordSince(start);
+    }
+    return lock;
+}
 
-// 1. Internal Sharding Hash
-size_t get_shard_id(const string& key) {
-    return hash<string>{}(key) % NUM_SHARDS;
+shared_lock<shared_mutex> read_lock(const Shard& shard) {
+    return timed_lock<shared_lock<shared_mutex>>(shard.mutex, shared_lock_wait);
 }
 
-// 2. Strong Hash (MUST MATCH PROXY)
-size_t consistent_hash(const std::string& key) {
-    const size_t FNV_prime = 1099511628211u;
-    const size_t offset_basis = 14695981039346656037u;
+unique_lock<shared_mutex> write_lock(Shard& shard) {
+    return timed_lock<unique_lock<shared_mutex>>(shard.mutex, exclusive_lock_wait);
+}
+
+// --- KEY STREAMS ---
+// /all, /range, /range_export and /ranges_export stream their result in
+// bounded batches.
+// A shard's lock is held only while one batch is collected, so a slow reader
+// never stalls writers; the output is not a point-in-time snapshot. Binary
+// streams (WAL-format SET records) end every batch with a Cursor record
+// that can be passed back as ?cursor= to resume after a dropped connection.
+constexpr size_t kStreamBatchKeys = 1024;
+constexpr size_t kStreamBatchBytes = 1 << 20;
+
+struct KeyStream {
+    bool all = true;        // Whole node, or only `ranges`
+    HashRangeSet ranges;
+    bool binary = false;    // WAL records + cursors, or "key\nval\n" text
+    size_t shard = 0;       // Shard being scanned
+    bool resume = false;    // Continue after `pos` within `shard`
+    RingIndex::Cursor pos;
+    size_t sent = 0;
+};
 
-    size_t hash = offset_basis;
-    for (char c : key) {
-        hash ^= static_cast<size_t>(c);
-        hash *= FNV_prime;
+// Cursor token: "<shard>" or "<shard>.<hash>.<hex key>".
+string encode_cursor(const KeyStream& st) {
+    string token = to_string(st.shard);
+    if (!st.resume) return token;
+    static const char* hex = "0123456789abcdef";
+    token += "." + to_string(st.pos.hash) + ".";
+    for (unsigned char c : st.pos.key) {
+        token.push_back(hex[c >> 4]);
+        token.push_back(hex[c & 15]);
     }
+    return token;
+}
 
-    // Mixer to prevent "a, b, c" clustering
-    hash ^= hash >> 33;
-    hash *= 0xff51afd7ed558ccd;
-    hash ^= hash >> 33;
-    hash *= 0xc4ceb9fe1a85ec53;
-    hash ^= hash >> 33;
+bool decode_cursor(const string& token, KeyStream& st) {
+    try {
+        size_t dot = token.find('.');
+        st.shard = stoull(token.substr(0, dot));
+        st.resume = dot != string::npos;
+        if (!st.resume) return true;
+        size_t dot2 = token.find('.', dot + 1);
+        if (dot2 == string::npos || (token.size() - dot2 - 1) % 2) return false;
+        st.pos.hash = stoull(token.substr(dot + 1, dot2 - dot - 1));
+        st.pos.key.clear();
+        for (size_t i = dot2 + 1; i < token.size(); i += 2) {
+            st.pos.key.push_back(static_cast<char>(stoi(token.substr(i, 2), nullptr, 16)));
+        }
+        return true;
+    } catch (...) {
+        return false;
+    }
+}
 
-    return hash;
+// Reads start/end/cursor/format; returns false (and sets a 400) on bad input.
+bool parse_key_stream(const httplib::Request& req, httplib::Response& res, KeyStream& st, bool ranged) {
+    try {
+        if (ranged && req.has_param("start")) {
+            st.all = false;
+            st.ranges = HashRangeSet({{stoull(req.get_param_value("start")), stoull(req.get_param_value("end"))}});
+        } else if (ranged) {
+            throw invalid_argument("start");
+        }
+    } catch (...) {
+        res.status = 400;
+        res.set_content("Bad range", "text/plain");
+        return false;
+    }
+    if (req.get_param_value("format") == "bin") st.binary = true;
+    if (req.has_param("cursor") && !decode_cursor(req.get_param_value("cursor"), st)) {
+        res.status = 400;
+        res.set_content("Bad cursor", "text/plain");
+        return false;
+    }
+    return true;
 }
 
-// 3. Ring Range Check
-bool in_range(size_t h, size_t start, size_t end) {
-    if (start == end) return false; // Safety
-    if (start < end) return h > start && h <= end;
-    return h > start || h <= end;   // Wrap-around
+void stream_keys(ShardStore& store, httplib::Response& res, shared_ptr<KeyStream> st, string log_label) {
+    const char* type = st->binary ? "application/octet-stream" : "text/plain";
+    res.set_chunked_content_provider(type, [&store, st, log_label](size_t, httplib::DataSink& sink) {
+        string out;
+        // One batch per call: stop at the batch limits or a shard boundary
+        while (out.empty() && st->shard < store.shardCount()) {
+            const Shard& shard = store.shard(st->shard);
+            bool done;
+            {
+                auto lock = read_lock(shard);
+                done = shard.ring_index.scan(st->all ? nullptr : &st->ranges, st->resume ? &st->pos : nullptr,
+                                             kStreamBatchKeys, [&](size_t hash, string_view key) {
+                    const string& val = *shard.map.find(key);
+                    if (st->binary) encode_wal_record(out, WalOp::Set, key, val);
+                    else out.append(key).append("\n").append(val).append("\n");
+                    st->pos.hash = hash;
+                    st->pos.key.assign(key);
+                    st->sent++;
+                    return out.size() < kStreamBatchBytes;
+                });
+            }
+            st->resume = !done;
+            if (done) st->shard++;
+            if (st->binary && !out.empty()) encode_wal_record(out, WalOp::Cursor, encode_cursor(*st));
+        }
+        if (out.empty()) {
+            if (st->sent > 0 && !log_label.empty()) LOG_INFO << "[Migration] " << log_label << " " << st->sent << " keys";
+            sink.done();
+            return true;
+        }
+        return sink.write(out.data(), out.size());
+    });
 }
 
 // --- PERSISTENCE HELPERS ---
-void log_op(const string& op, const string& key, const string& val = "") {
-    lock_guard<mutex> lock(wal_mutex);
-    wal_file << op << " " << key << " " << val << endl;
+string wal_record(WalOp op, const string& key, const string& val = "") {
+    string record;
+    encode_wal_record(record, op, key, val);
+    return record;
 }
 
-void restore_from_wal(const string& filename) {
-    ifstream infile(filename);
-    if (!infile.is_open()) return;
-
-    cout << "[WAL] Restoring from " << filename << "..." << endl;
-    string op, key, val;
-    while (infile >> op >> key) {
-        if (op == "SET") {
-            getline(infile, val);
-            if (!val.empty() && val[0] == ' ') val = val.substr(1);
-            int id = get_shard_id(key);
-            db_shards[id][key] = val;
-        } else if (op == "DEL") {
-            int id = get_shard_id(key);
-            db_shards[id].erase(key);
+// Exclusive locks on several shards, always taken in ascending shard order.
+vector<unique_lock<shared_mutex>> lock_shards(ShardStore& store, vector<size_t> ids) {
+    sort(ids.begin(), ids.end());
+    ids.erase(unique(ids.begin(), ids.end()), ids.end());
+    vector<unique_lock<shared_mutex>> locks;
+    locks.reserve(ids.size());
+    for (size_t id : ids) locks.push_back(write_lock(store.shard(id)));
+    return locks;
+}
+
+// --- DATA OPERATIONS ---
+// Shared by the HTTP handlers and the binary protocol. Writes are applied
+// and appended under the shard lock, so WAL order matches apply order; the
+// caller waits for durability on the returned sequence number.
+uint64_t apply_put(ShardStore& store, string_view key, string_view val) {
+    string record;
+    encode_wal_record(record, WalOp::Set, key, val);
+    Shard& shard = store.shardFor(key);
+    uint64_t seq;
+    {
+        auto lock = write_lock(shard);
+        shard.put(key, string(val));
+        seq = wal.append(record);
+    }
+    shard.writes.fetch_add(1, memory_order_relaxed);
+    return seq;
+}
+
+// Sets `existed` to whether the key was present.
+uint64_t apply_del(ShardStore& store, string_view key, bool& existed) {
+    string record;
+    encode_wal_record(record, WalOp::Del, key);
+    Shard& shard = store.shardFor(key);
+    uint64_t seq;
+    {
+        auto lock = write_lock(shard);
+        existed = shard.erase(key);
+        store.keepTombstone(shard, key);
+        seq = wal.append(record);
+    }
+    shard.writes.fetch_add(1, memory_order_relaxed);
+    return seq;
+}
+
+// Visits each shard once, under one shared lock.
+vector<BatchResult> batch_get(ShardStore& store, const vector<string_view>& keys) {
+    vector<pair<size_t, size_t>> order(keys.size());  // (shard, position)
+    for (size_t i = 0; i < keys.size(); ++i) order[i] = {store.shardId(keys[i]), i};
+    sort(order.begin(), order.end());
+    vector<BatchResult> results(keys.size());
+    for (size_t begin = 0, end; begin < order.size(); begin = end) {
+        for (end = begin; end < order.size() && order[end].first == order[begin].first; ++end) {}
+        Shard& shard = store.shard(order[begin].first);
+        shard.reads.fetch_add(end - begin, memory_order_relaxed);
+        auto lock = read_lock(shard);
+        for (size_t j = begin; j < end; ++j) {
+            size_t i = order[j].second;
+            if (const string* val = shard.map.find(keys[i])) results[i] = {BatchStatus::Found, *val};
         }
     }
+    return results;
 }
 
+// Multi-key PUT (`values` set) or DEL under the touched shards' locks, made
+// durable with a single WAL append like /bulk_load. Returns 0 for an empty batch.
+uint64_t batch_write(ShardStore& store, const vector<string_view>& keys, const vector<string_view>* values,
+                     vector<BatchResult>& results) {
+    results.assign(keys.size(), {values ? BatchStatus::Ok : BatchStatus::Missing, {}});
+    if (keys.empty()) return 0;
+    string records;
+    vector<size_t> shard_ids(keys.size());
+    for (size_t i = 0; i < keys.size(); ++i) {
+        if (values) encode_wal_record(records, WalOp::Set, keys[i], (*values)[i]);
+        else encode_wal_record(records, WalOp::Del, keys[i]);
+        shard_ids[i] = store.shardId(keys[i]);
+    }
+    auto locks = lock_shards(store, shard_ids);
+    for (size_t i = 0; i < keys.size(); ++i) {
+        Shard& shard = store.shard(shard_ids[i]);
+        if (values) {
+            shard.put(keys[i], string((*values)[i]));
+        } else {
+            if (shard.erase(keys[i])) results[i].status = BatchStatus::Ok;
+            store.keepTombstone(shard, keys[i]);
+        }
+        shard.writes.fetch_add(1, memory_order_relaxed);
+    }
+    return wal.append(records);
+}
+
+#ifdef __linux__
+// --- BINARY PROTOCOL ---
+Outcome bin_outcome(BinStatus status) {
+    if (status == BinStatus::Ok || status == BinStatus::NotFound) return Outcome::Ok;
+    return status == BinStatus::BadRequest ? Outcome::ClientError : Outcome::ServerError;
+}
+
+// Runs on a FrameServer I/O thread. Reads answer inline; writes answer from
+// the WAL writer thread once durable, so an I/O thread never waits on an
+// fsync and pipelined writes share one group commit.
+void serve_frame(ShardStore& store, EndpointMetrics& metrics, const Frame& req, FrameServer::Reply reply) {
+    auto respond = [reply, &metrics, code = req.code, start = chrono::steady_clock::now()](
+                       BinStatus status, string_view body = {}) {
+        reply.send(status, body);
+        metrics.record(bin_op_name(code), bin_outcome(status), nanos_since(start));
+    };
+    auto reply_when_durable = [&](uint64_t seq, BinStatus status, string body) {
+        if (seq == 0) { respond(status, body); return; }
+        wal.whenDurable(seq, [respond, status, body = move(body)](bool ok) {
+            if (ok) respond(status, body);
+            else respond(BinStatus::Error);
+        });
+    };
+    vector<string_view> keys, values;
+    vector<BatchResult> results;
+    string body;
+
+    switch (static_cast<BinOp>(req.code)) {
+        case BinOp::Ping:
+            respond(BinStatus::Ok);
+            return;
+        case BinOp::Get: {
+            Shard& shard = store.shardFor(req.payload);
+            shard.reads.fetch_add(1, memory_order_relaxed);
+            auto lock = read_lock(shard);
+            const string* val = shard.map.find(req.payload);
+            if (val) respond(BinStatus::Ok, *val);
+            else respond(BinStatus::NotFound);
+            return;
+        }
+        case BinOp::Put: {
+            string_view key, val;
+            if (!decode_put_payload(req.payload, key, val)) break;
+            reply_when_durable(apply_put(store, key, val), BinStatus::Ok, {});
+            return;
+        }
+        case BinOp::Del: {
+            bool existed;
+            uint64_t seq = apply_del(store, req.payload, existed);
+            reply_when_durable(seq, existed ? BinStatus::Ok : BinStatus::NotFound, {});
+            return;
+        }
+        case BinOp::MGet:
+            if (!decode_batch_keys(req.payload, keys)) break;
+            encode_batch_results(body, batch_get(store, keys));
+            respond(BinStatus::Ok, body);
+            return;
+        case BinOp::MPut:
+        case BinOp::MDel: {
+            bool put = static_cast<BinOp>(req.code) == BinOp::MPut;
+            if (put ? !decode_batch_pairs(req.payload, keys, values) : !decode_batch_keys(req.payload, keys)) break;
+            uint64_t seq = batch_write(store, keys, put ? &values : nullptr, results);
+            encode_batch_results(body, results);
+            reply_when_durable(seq, BinStatus::Ok, move(body));
+            return;
+        }
+    }
+    respond(BinStatus::BadRequest);
+}
+#endif
+
 int main(int argc, char* argv[]) {
-    if (argc != 2) { cerr << "Usage: ./kv_server <PORT>" << endl; return 1; }
+    if (argc < 2) {
+        cerr << "Usage: ./kv_server <PORT> [--shards N] [--durability none|interval|group|every-write]"
+             << " [--fsync-interval-ms N] [--checkpoint-interval-s N] [--checkpoint-wal-mb N]"
+             << " [--replay-threads N] [--binary-port N] [--io-threads N]"
+             << " [--log-level debug|info|warn|error|off] [--log-sample N]" << endl;
+        return 1;
+    }
     int port = atoi(argv[1]);
+    size_t num_shards = ShardStore::defaultShardCount();
+    Durability durability = Durability::Interval;
+    int fsync_interval_ms = 100;
+    int checkpoint_interval_s = 300;
+    uint64_t checkpoint_wal_mb = 256;
+    unsigned replay_threads = max(1u, thread::hardware_concurrency());
+    int binary_port = port + kBinaryPortOffset;
+    size_t io_threads = min(4u, max(1u, thread::hardware_concurrency()));
+    for (int i = 2; i + 1 < argc; i += 2) {
+        string flag = argv[i];
+        if (flag == "--shards") num_shards = stoul(argv[i + 1]);
+        else if (flag == "--fsync-interval-ms") fsync_interval_ms = stoi(argv[i + 1]);
+        else if (flag == "--checkpoint-interval-s") checkpoint_interval_s = stoi(argv[i + 1]);
+        else if (flag == "--checkpoint-wal-mb") checkpoint_wal_mb = stoull(argv[i + 1]);
+        else if (flag == "--replay-threads") replay_threads = stoul(argv[i + 1]);
+        else if (flag == "--binary-port") binary_port = stoi(argv[i + 1]);
+        else if (flag == "--io-threads") io_threads = max<size_t>(1, stoul(argv[i + 1]));
+        else if (flag == "--log-sample") Logger::instance().setSampleRate(stoul(argv[i + 1]));
+        else if (flag == "--log-level") {
+            LogLevel level;
+            if (!parse_log_level(argv[i + 1], level)) { cerr << "Unknown log level: " << argv[i + 1] << endl; return 1; }
+            Logger::instance().setLevel(level);
+        }
+        else if (flag == "--durability") {
+            if (!parse_durability(argv[i + 1], durability)) { cerr << "Unknown durability: " << argv[i + 1] << endl; return 1; }
+        }
+        else { cerr << "Unknown option: " << flag << endl; return 1; }
+    }
+    ShardStore store(num_shards);
 
-    // 1. SETUP WAL
+    // 1. SETUP SNAPSHOT + WAL
     string wal_filename = "wal_" + to_string(port) + ".log";
-    restore_from_wal(wal_filename);
-    wal_file.open(wal_filename, ios::app);
+    string snapshot_filename = "snap_" + to_string(port) + ".bin";
+    CheckpointManager persistence(store, wal, snapshot_filename, wal_filename);
+    if (!persistence.restore(replay_threads)) return 1;
+    if (!wal.open(wal_filename, durability, fsync_interval_ms, wal_file_header())) return 1;
+    persistence.start(checkpoint_interval_s, checkpoint_wal_mb << 20);
 
-    std::cout.setf(std::ios::unitbuf);
     httplib::Server svr;
+    svr.set_tcp_nodelay(true);  // Keep-alive peers would otherwise hit Nagle + delayed ACK
+
+    // Per-endpoint request metrics. httplib answers a request on the thread
+    // that routed it, so the start time is kept per thread. Streams count
+    // until their first byte.
+    EndpointMetrics http_metrics("kv_http", "endpoint", {"/put", "/del", "/get", "/mget", "/mput", "/mdel", "/range",
+        "/range_export", "/ranges_export", "/bulk_load", "/tombstones/open", "/tombstones/close", "/range_delete",
+        "/status", "/stats", "/metrics", "/log_level", "/checkpoint", "/all", "/reset"});
+    static thread_local chrono::steady_clock::time_point request_start;
+    svr.set_pre_routing_handler([](const httplib::Request&, httplib::Response&) {
+        request_start = chrono::steady_clock::now();
+        return httplib::Server::HandlerResponse::Unhandled;
+    });
+    svr.set_post_routing_handler([&](const httplib::Request& req, httplib::Response& res) {
+        http_metrics.record(req.path, http_outcome(res.status), nanos_since(request_start));
+    });
 
     // 2. WRITE
-    svr.Post("/put", [](const httplib::Request& req, httplib::Response& res) {
+    svr.Post("/put", [&](const httplib::Request& req, httplib::Response& res) {
         string key = req.get_param_value("key");
-        string val = req.get_param_value("val");
-        int id = get_shard_id(key);
-
-        {
-            lock_guard<mutex> lock(shard_mutexes[id]);
-            db_shards[id][key] = val;
-        }
-        log_op("SET", key, val);
+        uint64_t seq = apply_put(store, key, req.get_param_value("val"));
+        if (!wal.waitDurable(seq)) { res.status = 500; res.set_content("WAL write failed", "text/plain"); return; }
 
-        // LOG ENABLED: Shows when a key joins this server
-        cout << "\033[1;32m[Saved] " << key << "\033[0m" << endl;
+        // Shows when a key joins this server (1 in --log-sample)
+        LOG_SAMPLED(LogLevel::Info) << "\033[1;32m[Saved] " << key << "\033[0m";
         res.set_content("OK", "text/plain");
     });
 
     // 3. DELETE
-    svr.Post("/del", [](const httplib::Request& req, httplib::Response& res) {
+    svr.Post("/del", [&](const httplib::Request& req, httplib::Response& res) {
         string key = req.get_param_value("key");
-        int id = get_shard_id(key);
+        bool existed;
+        uint64_t seq = apply_del(store, key, existed);
+        if (!wal.waitDurable(seq)) { res.status = 500; res.set_content("WAL write failed", "text/plain"); return; }
 
-        {
-            lock_guard<mutex> lock(shard_mutexes[id]);
-            db_shards[id].erase(key);
-        }
-        log_op("DEL", key);
-
-        // LOG ENABLED: Shows when a key leaves this server
-        cout << "\033[1;31m[Deleted] " << key << "\033[0m" << endl;
+        // Shows when a key leaves this server (1 in --log-sample)
+        LOG_SAMPLED(LogLevel::Info) << "\033[1;31m[Deleted] " << key << "\033[0m";
         res.set_content("OK", "text/plain");
     });
 
     // 4. READ
-    svr.Get("/get", [](const httplib::Request& req, httplib::Response& res) {
+    svr.Get("/get", [&](const httplib::Request& req, httplib::Response& res) {
         string key = req.get_param_value("key");
-        int id = get_shard_id(key);
-        lock_guard<mutex> lock(shard_mutexes[id]);
-        if (db_shards[id].count(key)) res.set_content(db_shards[id][key], "text/plain");
+        Shard& shard = store.shardFor(key);
+        shard.reads.fetch_add(1, memory_order_relaxed);
+        auto lock = read_lock(shard);
+        const string* val = shard.map.find(key);
+        if (val) res.set_content(*val, "text/plain");
         else { res.status = 404; res.set_content("Not Found", "text/plain"); }
     });
 
+    // 4b. MULTI-KEY (bodies in batch_codec.hpp; results are positional)
+    svr.Post("/mget", [&](const httplib::Request& req, httplib::Response& res) {
+        vector<string_view> keys;
+        if (!decode_batch_keys(req.body, keys)) { res.status = 400; res.set_content("Bad batch", "text/plain"); return; }
+        string body;
+        encode_batch_results(body, batch_get(store, keys));
+        res.set_content(body, "application/octet-stream");
+    });
+
+    svr.Post("/mput", [&](const httplib::Request& req, httplib::Response& res) {
+        vector<string_view> keys, values;
+        if (!decode_batch_pairs(req.body, keys, values)) { res.status = 400; res.set_content("Bad batch", "text/plain"); return; }
+        vector<BatchResult> results;
+        uint64_t seq = batch_write(store, keys, &values, results);
+        if (seq && !wal.waitDurable(seq)) { res.status = 500; res.set_content("WAL write failed", "text/plain"); return; }
+        string body;
+        encode_batch_results(body, results);
+        res.set_content(body, "application/octet-stream");
+    });
+
+    svr.Post("/mdel", [&](const httplib::Request& req, httplib::Response& res) {
+        vector<string_view> keys;
+        if (!decode_batch_keys(req.body, keys)) { res.status = 400; res.set_content("Bad batch", "text/plain"); return; }
+        vector<BatchResult> results;
+        uint64_t seq = batch_write(store, keys, nullptr, results);
+        if (seq && !wal.waitDurable(seq)) { res.status = 500; res.set_content("WAL write failed", "text/plain"); return; }
+        string body;
+        encode_batch_results(body, results);
+        res.set_content(body, "application/octet-stream");
+    });
+
     // 5. MIGRATION HELPERS
-    svr.Get("/range", [](const httplib::Request& req, httplib::Response& res) {
-        size_t start = stoull(req.get_param_value("start"));
-        size_t end = stoull(req.get_param_value("end"));
-        stringstream ss;
-        int count = 0;
-
-        for (int i = 0; i < NUM_SHARDS; ++i) {
-            lock_guard<mutex> lock(shard_mutexes[i]);
-            for (const auto& pair : db_shards[i]) {
-                if (in_range(consistent_hash(pair.first), start, end)) {
-                    ss << pair.first << "\n" << pair.second << "\n";
-                    count++;
+    svr.Get("/range", [&](const httplib::Request& req, httplib::Response& res) {
+        auto st = make_shared<KeyStream>();
+        if (!parse_key_stream(req, res, *st, true)) return;
+        // Log summary of keys leaving this server
+        stream_keys(store, res, st, "Sent range " + req.get_param_value("start") + ".." + req.get_param_value("end") + ":");
+    });
+
+    // 6. BULK MIGRATION
+    // Binary stream of every key in (start, end], or every key when no
+    // range is given; same as /range?format=bin.
+    svr.Get("/range_export", [&](const httplib::Request& req, httplib::Response& res) {
+        auto st = make_shared<KeyStream>();
+        if (!parse_key_stream(req, res, *st, req.has_param("start"))) return;
+        st->binary = true;
+        stream_keys(store, res, st, "Exported");
+    });
+
+    // Same, for every key in any of the ranges in the body (u64 start | u64
+    // end per range, see encode_hash_ranges): all of a migration source's
+    // ranges in one pass over each shard. Takes ?cursor= like the others.
+    svr.Post("/ranges_export", [&](const httplib::Request& req, httplib::Response& res) {
+        vector<HashRange> ranges;
+        auto st = make_shared<KeyStream>();
+        if (!decode_hash_ranges(req.body, ranges)) {
+            res.status = 400;
+            res.set_content("Bad ranges", "text/plain");
+            return;
+        }
+        if (!parse_key_stream(req, res, *st, false)) return;
+        st->all = false;
+        st->ranges = HashRangeSet(ranges);
+        st->binary = true;
+        stream_keys(store, res, st, "Exported " + to_string(ranges.size()) + " ranges:");
+    });
+
+    // Body: WAL-format SET/DEL records, applied atomically with respect to
+    // each touched shard and made durable with a single WAL append.
+    svr.Post("/bulk_load", [&](const httplib::Request& req, httplib::Response& res) {
+        const string& body = req.body;
+
+        // 1. Validate the whole batch before applying any of it
+        vector<size_t> shard_ids;
+        size_t pos = 0;
+        WalRecord rec;
+        size_t used;
+        while (pos < body.size()) {
+            if (decode_wal_record(body.data() + pos, body.size() - pos, rec, used) != WalDecode::Ok ||
+                (rec.op != WalOp::Set && rec.op != WalOp::Del)) {
+                res.status = 400;
+                res.set_content("Bad batch at offset " + to_string(pos), "text/plain");
+                return;
+            }
+            shard_ids.push_back(store.shardId(rec.key));
+            pos += used;
+        }
+
+        // 2. A migration copy loads under a tombstone lease (?lease=, see
+        //    /tombstones/open), renewed here. One this node no longer has,
+        //    say since a restart, may have missed a DEL: refuse the batch.
+        bool if_absent = req.get_param_value("if_absent") == "1";
+        if (req.has_param("lease")) {
+            uint64_t lease = 0;
+            try { lease = stoull(req.get_param_value("lease")); } catch (...) {}
+            if (!store.renewTombstoneLease(lease)) {
+                res.status = 409;
+                res.set_content("Unknown tombstone lease", "text/plain");
+                return;
+            }
+        }
+
+        // 3. Apply in batch order under the touched shards' locks; the body
+        //    is already valid WAL, so it is appended as is. With ?if_absent=1
+        //    (migration copies) a SET of a key that is already here, or was
+        //    deleted under a live lease, is skipped, and only the records
+        //    applied are logged.
+        string applied;
+        size_t loaded = 0;
+        uint64_t seq = 0;
+        if (!shard_ids.empty()) {
+            auto locks = lock_shards(store, shard_ids);
+            pos = 0;
+            for (size_t id : shard_ids) {
+                decode_wal_record(body.data() + pos, body.size() - pos, rec, used, false);
+                Shard& shard = store.shard(id);
+                if (!if_absent || rec.op != WalOp::Set || (!shard.map.contains(rec.key) && !shard.tombstoned(rec.key))) {
+                    if (rec.op == WalOp::Set) shard.put(rec.key, string(rec.value));
+                    else shard.erase(rec.key);
+                    shard.writes.fetch_add(1, memory_order_relaxed);
+                    if (if_absent) applied.append(body, pos, used);
+                    loaded++;
                 }
+                pos += used;
             }
+            if (!if_absent) seq = wal.append(body);
+            else if (!applied.empty()) seq = wal.append(applied);
         }
+        if (seq && !wal.waitDurable(seq)) { res.status = 500; res.set_content("WAL write failed", "text/plain"); return; }
+        res.set_content("Loaded " + to_string(loaded), "text/plain");
+    });
 
-        // Log summary of keys leaving this server
-        if (count > 0) {
-            cout << "[Migration] Sending " << count << " keys for range " << start << ".." << end << endl;
+    // Opens a tombstone lease on the ranges in the body (encoded as for
+    // /ranges_export) for ?ttl_s seconds (default 120) past its last use;
+    // see ShardStore::openTombstoneLease. Answers "Lease <id>".
+    svr.Post("/tombstones/open", [&](const httplib::Request& req, httplib::Response& res) {
+        vector<HashRange> ranges;
+        long long ttl_s = 120;
+        try {
+            if (req.has_param("ttl_s")) ttl_s = stoll(req.get_param_value("ttl_s"));
+        } catch (...) {
+            ttl_s = -1;
         }
-        res.set_content(ss.str(), "text/plain");
+        if (ttl_s <= 0 || req.body.empty() || !decode_hash_ranges(req.body, ranges)) {
+            res.status = 400;
+            res.set_content("Bad ranges or ttl_s", "text/plain");
+            return;
+        }
+        uint64_t lease = store.openTombstoneLease(ranges, chrono::seconds(ttl_s));
+        LOG_INFO << "[Migration] Opened tombstone lease " << lease << " on " << ranges.size() << " ranges";
+        res.set_content("Lease " + to_string(lease), "text/plain");
+    });
+
+    // Ends ?lease= and drops the tombstones no other live lease covers.
+    svr.Post("/tombstones/close", [&](const httplib::Request& req, httplib::Response& res) {
+        uint64_t lease = 0;
+        try { lease = stoull(req.get_param_value("lease")); } catch (...) {}
+        if (!store.closeTombstoneLease(lease)) {
+            res.status = 404;
+            res.set_content("Unknown tombstone lease", "text/plain");
+            return;
+        }
+        res.set_content("Closed", "text/plain");
     });
 
-    // 6. STATUS
-    svr.Get("/status", [](const httplib::Request&, httplib::Response& res) {
+    // Drops every key in (start, end], or in any of the ranges in the body
+    // (encoded as for /ranges_export). Shards are locked and erased one at a
+    // time, as the exports walk them, so writes elsewhere never wait on the
+    // whole delete. Each shard logs a DEL per key it dropped, under its own
+    // lock, so the WAL orders each delete against that shard's writes.
+    svr.Post("/range_delete", [&](const httplib::Request& req, httplib::Response& res) {
+        vector<HashRange> ranges;
+        try {
+            if (req.has_param("start")) {
+                ranges.push_back({stoull(req.get_param_value("start")), stoull(req.get_param_value("end"))});
+            } else if (req.body.empty() || !decode_hash_ranges(req.body, ranges)) {
+                throw invalid_argument("ranges");
+            }
+        } catch (...) {
+            res.status = 400;
+            res.set_content("Bad range", "text/plain");
+            return;
+        }
+
+        size_t removed = 0;
+        uint64_t seq = 0;
+        vector<string> erased;
+        string records;
+        for (size_t i = 0; i < store.shardCount(); ++i) {
+            Shard& shard = store.shard(i);
+            auto lock = write_lock(shard);
+            removed += ShardStore::eraseRanges(shard, ranges, &erased);
+            if (erased.empty()) continue;
+            for (const string& key : erased) encode_wal_record(records, WalOp::Del, key);
+            seq = wal.append(records);
+            erased.clear();
+            records.clear();
+        }
+        if (seq && !wal.waitDurable(seq)) { res.status = 500; res.set_content("WAL write failed", "text/plain"); return; }
+        if (removed > 0) LOG_INFO << "[Migration] Range-deleted " << removed << " keys";
+        res.set_content("Deleted " + to_string(removed), "text/plain");
+    });
+
+    // 7. STATUS
+    // The proxy learns the node's binary port from this header.
+    svr.Get("/status", [&](const httplib::Request&, httplib::Response& res) {
+        if (binary_port > 0) res.set_header("X-Binary-Port", to_string(binary_port));
         res.set_content("OK", "text/plain");
     });
 
-    // 7. DUMP
-    svr.Get("/all", [](const httplib::Request& req, httplib::Response& res) {
-        stringstream ss;
-        for (int i = 0; i < NUM_SHARDS; ++i) {
-            lock_guard<mutex> lock(shard_mutexes[i]);
-            for (const auto& pair : db_shards[i]) ss << pair.first << "\n" << pair.second << "\n";
+    svr.Get("/stats", [&](const httplib::Request&, httplib::Response& res) {
+        const PersistenceStats& st = persistence.stats();
+        size_t keys = 0, map_bytes = 0, index_bytes = 0, tombstones = 0, tombstone_bytes = 0;
+        for (size_t i = 0; i < store.shardCount(); ++i) {
+            const Shard& shard = store.shard(i);
+            shared_lock<shared_mutex> lock(shard.mutex);
+            keys += shard.map.size();
+            map_bytes += shard.map.memoryUsage();
+            index_bytes += shard.ring_index.memoryUsage();
+            tombstones += shard.tombstones.size();
+            tombstone_bytes += shard.tombstones.memoryUsage();
         }
+        stringstream ss;
+        ss << "keys " << keys << "\n"
+           << "map_bytes " << map_bytes << "\n"
+           << "ring_index_bytes " << index_bytes << "\n"
+           << "tombstones " << tombstones << "\n"
+           << "tombstone_bytes " << tombstone_bytes << "\n"
+           << "tombstone_leases " << store.tombstoneLeases() << "\n"
+           << "restore_ms " << st.restore_ms << "\n"
+           << "restored_snapshot_keys " << st.restored_snapshot_keys << "\n"
+           << "replayed_wal_records " << st.replayed_wal_records << "\n"
+           << "snapshot_bytes " << st.snapshot_bytes << "\n"
+           << "snapshot_keys " << st.snapshot_keys << "\n"
+           << "checkpoints " << st.checkpoints << "\n"
+           << "last_checkpoint_ms " << st.last_checkpoint_ms << "\n"
+           << "wal_bytes " << wal.logBytes() << "\n"
+           << "log_dropped " << Logger::instance().dropped() << "\n";
         res.set_content(ss.str(), "text/plain");
     });
 
-    // 8. RESET
+    // Runtime log settings: ?level=debug|info|warn|error|off and/or ?sample=N
+    svr.Post("/log_level", [&](const httplib::Request& req, httplib::Response& res) {
+        Logger& logger = Logger::instance();
+        if (req.has_param("level")) {
+            LogLevel level;
+            if (!parse_log_level(req.get_param_value("level"), level)) { res.status = 400; res.set_content("Unknown log level", "text/plain"); return; }
+            logger.setLevel(level);
+        }
+        if (req.has_param("sample")) {
+            try { logger.setSampleRate(stoul(req.get_param_value("sample"))); }
+            catch (...) { res.status = 400; res.set_content("Bad sample rate", "text/plain"); return; }
+        }
+        res.set_content(string("level ") + log_level_name(logger.level()) + " sample " + to_string(logger.sampleRate()), "text/plain");
+    });
+
+    // Prometheus scrape target. Per-shard sizes and traffic are read here.
+    Metrics::instance().addCollector([&](string& out) {
+        vector<array<size_t, 4>> sizes(store.shardCount());  // keys, map bytes, index bytes, tombstone bytes
+        for (size_t i = 0; i < store.shardCount(); ++i) {
+            const Shard& shard = store.shard(i);
+            shared_lock<shared_mutex> lock(shard.mutex);
+            sizes[i] = {shard.map.size(), shard.map.memoryUsage(), shard.ring_index.memoryUsage(),
+                        shard.tombstones.memoryUsage()};
+        }
+        auto per_shard = [&](const char* name, const char* help, const char* type, auto value) {
+            metric_header(out, name, help, type);
+            for (size_t i = 0; i < sizes.size(); ++i) {
+                metric_sample(out, name, metric_label("shard", to_string(i)), static_cast<double>(value(i)));
+            }
+        };
+        per_shard("kv_shard_keys", "Keys stored in the shard.", "gauge", [&](size_t i) { return sizes[i][0]; });
+        per_shard("kv_shard_map_bytes", "Memory used by the shard's map.", "gauge", [&](size_t i) { return sizes[i][1]; });
+        per_shard("kv_shard_index_bytes", "Memory used by the shard's ring index.", "gauge",
+                  [&](size_t i) { return sizes[i][2]; });
+        per_shard("kv_shard_tombstone_bytes", "Memory used by the shard's migration tombstones.", "gauge",
+                  [&](size_t i) { return sizes[i][3]; });
+        per_shard("kv_shard_reads_total", "Reads served by the shard.", "counter",
+                  [&](size_t i) { return store.shard(i).reads.load(memory_order_relaxed); });
+        per_shard("kv_shard_writes_total", "Writes applied to the shard.", "counter",
+                  [&](size_t i) { return store.shard(i).writes.load(memory_order_relaxed); });
+        metric_header(out, "kv_tombstone_leases", "Open tombstone leases of migrations loading into this node.",
+                      "gauge");
+        metric_sample(out, "kv_tombstone_leases", "", static_cast<double>(store.tombstoneLeases()));
+        metric_header(out, "kv_wal_bytes", "Size of the current WAL file.", "gauge");
+        metric_sample(out, "kv_wal_bytes", "", static_cast<double>(wal.logBytes()));
+        metric_header(out, "kv_log_dropped_total", "Log lines dropped because the log ring was full.", "counter");
+        metric_sample(out, "kv_log_dropped_total", "", static_cast<double>(Logger::instance().dropped()));
+    });
+
+    svr.Get("/metrics", [&](const httplib::Request&, httplib::Response& res) {
+        res.set_content(Metrics::instance().render(), "text/plain; version=0.0.4");
+    });
+
+    svr.Post("/checkpoint", [&](const httplib::Request&, httplib::Response& res) {
+        if (persistence.checkpoint()) res.set_content("Checkpoint Complete", "text/plain");
+        else { res.status = 500; res.set_content("Checkpoint Failed", "text/plain"); }
+    });
+
+    // 8. DUMP
+    svr.Get("/all", [&](const httplib::Request& req, httplib::Response& res) {
+        auto st = make_shared<KeyStream>();
+        if (!parse_key_stream(req, res, *st, false)) return;
+        stream_keys(store, res, st, "");
+    });
+
+    // 9. RESET
     svr.Post("/reset", [&](const httplib::Request&, httplib::Response& res) {
-        for (int i = 0; i < NUM_SHARDS; ++i) {
-            lock_guard<mutex> lock(shard_mutexes[i]);
-            db_shards[i].clear();
-        }
-        wal_file.close();
-        string filename = "wal_" + to_string(port) + ".log";
-        std::remove(filename.c_str());
-        wal_file.open(filename, ios::app);
+        persistence.reset();
         res.set_content("Database Reset", "text/plain");
     });
 
-    cout << "--- Persistent Server Port " << port << " ---" << endl;
+    // 10. BINARY PROTOCOL (data path only; HTTP stays for admin)
+#ifdef __linux__
+    EndpointMetrics binary_metrics("kv_binary", "op", {"ping", "get", "put", "del", "mget", "mput", "mdel"});
+    unique_ptr<FrameServer> binary;
+    if (binary_port > 0) {
+        binary = make_unique<FrameServer>(
+            [&](const Frame& req, FrameServer::Reply reply) { serve_frame(store, binary_metrics, req, move(reply)); },
+            io_threads);
+        if (!binary->start(binary_port)) return 1;
+        LOG_INFO << "--- Binary protocol on port " << binary_port << " (" << io_threads << " I/O threads) ---";
+    }
+#else
+    binary_port = 0;
+#endif
+
+    LOG_INFO << "--- Persistent Server Port " << port << " (" << store.shardCount() << " shards, durability: "
+             << durability_name(durability) << ") ---";
     svr.listen("0.0.0.0", port);
 }
\ No newline at end of file
@@ -0,0 +1,24 @@
+#include "../../include/ring_index.hpp"
+
+void RingIndex::insert(size_t ring_hash, std::string_view key) {
+    auto result = entries_.emplace(ring_hash, key);
+    if (result.second && !result.first->key.isInline()) spilled_bytes_ += key.size();
+}
+
+void RingIndex::erase(size_t ring_hash, std::string_view key) {
+    auto it = entries_.find(Probe{ring_hash, key});
+    if (it == entries_.end()) return;
+    if (!it->key.isInline()) spilled_bytes_ -= it->key.size();
+    entries_.erase(it);
+}
+
+void RingIndex::clear() {
+    entries_.clear();
+    spilled_bytes_ = 0;
+}
+
+size_t RingIndex::memoryUsage() const {
+    // A red-black tree node carries a color word and three pointers
+    constexpr size_t kNodeOverhead = 4 * sizeof(void*);
+    return entries_.size() * (kNodeOverhead + sizeof(Entry)) + spilled_bytes_;
+}
@@ -0,0 +1,159 @@
+#include "../../include/shard_store.hpp"
+#include <algorithm>
+#include <functional>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <utility>
+
+namespace {
+size_t round_up_pow2(size_t n) {
+    size_t p = 1;
+    while (p < n) p <<= 1;
+    return p;
+}
+} // namespace
+
+ShardStore::ShardStore(size_t shard_count)
+    : count_(round_up_pow2(std::max<size_t>(shard_count, 1))),
+      mask_(count_ - 1),
+      shards_(new Shard[count_]),
+      // Lease IDs start at a random point, so one issued before a restart
+      // is not mistaken for a new one
+      next_lease_(static_cast<uint64_t>(std::random_device{}()) << 32 | 1) {}
+
+size_t ShardStore::defaultShardCount() {
+    size_t cores = std::max(1u, std::thread::hardware_concurrency());
+    return std::min<size_t>(4096, round_up_pow2(std::max<size_t>(16, cores * 4)));
+}
+
+size_t ShardStore::keyHash(std::string_view key) {
+    return std::hash<std::string_view>{}(key);
+}
+
+size_t ShardStore::size() const {
+    size_t total = 0;
+    for (size_t i = 0; i < count_; ++i) {
+        std::shared_lock<std::shared_mutex> lock(shards_[i].mutex);
+        total += shards_[i].map.size();
+    }
+    return total;
+}
+
+size_t ShardStore::eraseRanges(Shard& shard, const std::vector<HashRange>& ranges,
+                               std::vector<std::string>* erased) {
+    std::vector<std::string> doomed;
+    shard.ring_index.forEachInRanges(HashRangeSet(ranges), [&](std::string_view key) { doomed.emplace_back(key); });
+    size_t removed = 0;
+    for (auto& key : doomed) {
+        if (shard.map.erase(key)) {
+            shard.ring_index.erase(ringHash(key), key);
+            ++removed;
+            if (erased) erased->push_back(std::move(key));
+        }
+    }
+    return removed;
+}
+
+// --- TOMBSTONE LEASES ---
+
+template <typename Fn>
+size_t ShardStore::endLeasesLocked(Fn done) {
+    auto now = std::chrono::steady_clock::now();
+    TombstoneLeases ended, live;
+    for (const TombstoneLease& lease : *leases_.read()) {
+        (now >= lease.until || done(lease) ? ended : live).push_back(lease);
+    }
+    if (ended.empty()) return 0;
+    lease_count_.store(live.size(), std::memory_order_release);
+    leases_.store(std::unique_ptr<TombstoneLeases>(new TombstoneLeases(live)));
+
+    // Published first: a delete that still saw an ended lease has finished
+    // with the shard by the time its lock is taken here
+    std::vector<std::string> doomed;
+    for (size_t i = 0; i < count_; ++i) {
+        Shard& shard = shards_[i];
+        std::unique_lock<std::shared_mutex> lock(shard.mutex);
+        if (shard.tombstones.empty()) continue;
+        shard.tombstones.forEach([&](std::string_view key, const std::string&) {
+            size_t h = ringHash(key);
+            auto covers = [h](const TombstoneLease& lease) { return lease.ranges.contains(h); };
+            if (std::any_of(ended.begin(), ended.end(), covers) && std::none_of(live.begin(), live.end(), covers)) {
+                doomed.emplace_back(key);
+            }
+        });
+        for (const std::string& key : doomed) shard.tombstones.erase(key);
+        if (shard.tombstones.empty()) shard.tombstones = FlatStringMap();  // Give the table back
+        doomed.clear();
+    }
+    return ended.size();
+}
+
+uint64_t ShardStore::openTombstoneLease(const std::vector<HashRange>& ranges, std::chrono::seconds ttl) {
+    std::lock_guard<std::mutex> lock(lease_mutex_);
+    endLeasesLocked([](const TombstoneLease&) { return false; });
+    uint64_t id = next_lease_++;
+    if (id == 0) id = next_lease_++;
+    auto until = std::chrono::steady_clock::now() + ttl;
+    leases_.update([&](TombstoneLeases& leases) { leases.push_back({id, HashRangeSet(ranges), ttl, until}); });
+    lease_count_.fetch_add(1, std::memory_order_release);
+    return id;
+}
+
+bool ShardStore::renewTombstoneLease(uint64_t id) {
+    std::lock_guard<std::mutex> lock(lease_mutex_);
+    endLeasesLocked([](const TombstoneLease&) { return false; });
+    bool found = false;
+    auto now = std::chrono::steady_clock::now();
+    leases_.update([&](TombstoneLeases& leases) {
+        for (TombstoneLease& lease : leases) {
+            if (lease.id != id) continue;
+            lease.until = now + lease.ttl;
+            found = true;
+        }
+    });
+    return found;
+}
+
+bool ShardStore::closeTombstoneLease(uint64_t id) {
+    std::lock_guard<std::mutex> lock(lease_mutex_);
+    bool found = false;
+    endLeasesLocked([&](const TombstoneLease& lease) {
+        if (lease.id != id) return false;
+        found = true;
+        return true;
+    });
+    return found;
+}
+
+void ShardStore::keepTombstone(Shard& shard, std::string_view key) const {
+    if (lease_count_.load(std::memory_order_acquire) == 0) return;
+    size_t h = ringHash(key);
+    auto now = std::chrono::steady_clock::now();
+    auto leases = leases_.read();
+    for (const TombstoneLease& lease : *leases) {
+        if (now < lease.until && lease.ranges.contains(h)) {
+            shard.tombstones.insertOrAssign(key, std::string());
+            return;
+        }
+    }
+}
+
+// --- SHARD ---
+
+void Shard::put(std::string_view key, std::string value) {
+    if (map.insertOrAssign(key, std::move(value))) ring_index.insert(ShardStore::ringHash(key), key);
+}
+
+bool Shard::erase(std::string_view key) {
+    if (!map.erase(key)) return false;
+    ring_index.erase(ShardStore::ringHash(key), key);
+    return true;
+}
+
+void Shard::clear() {
+    map.clear();
+    ring_index.clear();
+    tombstones.clear();
+}
@@ -0,0 +1,175 @@
+#include "../../include/wal_replay.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+// --- DISTINCT-KEY ESTIMATE (HyperLogLog, 1024 registers) ---
+// WAL records include overwrites, so reserving one slot per record could
+// over-allocate wildly for hot keys. The estimate caps the reservation at
+// roughly the number of distinct keys (about 3% error).
+class DistinctCounter {
+public:
+    static constexpr int kBits = 10;
+    static constexpr size_t kRegisters = size_t(1) << kBits;
+
+    void add(uint64_t hash) {
+        // Re-mix: the low bits of the key hash already picked the shard.
+        hash ^= hash >> 33;
+        hash *= 0xff51afd7ed558ccdULL;
+        hash ^= hash >> 33;
+        hash *= 0xc4ceb9fe1a85ec53ULL;
+        hash ^= hash >> 33;
+
+        size_t idx = static_cast<size_t>(hash >> (64 - kBits));
+        uint64_t rest = (hash << kBits) | (uint64_t(1) << (kBits - 1));
+        uint8_t rank = 1;
+        while (!(rest & (uint64_t(1) << 63))) { rest <<= 1; ++rank; }
+
+        std::atomic<uint8_t>& reg = registers_[idx];
+        uint8_t cur = reg.load(std::memory_order_relaxed);
+        while (cur < rank && !reg.compare_exchange_weak(cur, rank, std::memory_order_relaxed)) {}
+    }
+
+    double estimate() const {
+        const double m = static_cast<double>(kRegisters);
+        double sum = 0;
+        size_t zeros = 0;
+        for (const auto& r : registers_) {
+            uint8_t v = r.load(std::memory_order_relaxed);
+            sum += std::ldexp(1.0, -v);
+            if (v == 0) ++zeros;
+        }
+        double e = (0.7213 / (1 + 1.079 / m)) * m * m / sum;
+        if (e <= 2.5 * m && zeros > 0) e = m * std::log(m / static_cast<double>(zeros));
+        return e;
+    }
+
+private:
+    std::atomic<uint8_t> registers_[kRegisters] = {};
+};
+
+struct Chunk {
+    size_t begin = 0;
+    size_t end = 0;
+    std::vector<std::vector<uint32_t>> buckets;  // Per shard: offsets relative to `begin`
+    size_t bad_offset = SIZE_MAX;                // Absolute offset of the first bad record
+    WalDecode bad_status = WalDecode::Ok;
+};
+
+// Runs fn(i) for i in [0, n) on up to `threads` threads, handing out
+// indices dynamically so uneven chunks and shards balance out.
+template <typename Fn>
+void parallel_for(size_t n, unsigned threads, Fn fn) {
+    std::atomic<size_t> next{0};
+    auto worker = [&] {
+        for (size_t i = next++; i < n; i = next++) fn(i);
+    };
+    unsigned extra = static_cast<unsigned>(std::min<size_t>(threads, n)) - 1;
+    std::vector<std::thread> pool;
+    for (unsigned t = 0; t < extra; ++t) pool.emplace_back(worker);
+    worker();
+    for (auto& t : pool) t.join();
+}
+
+} // namespace
+
+ReplayResult replay_records(ShardStore& store, const char* data, size_t len, size_t begin, unsigned threads) {
+    ReplayResult result;
+    result.valid_bytes = begin;
+    if (begin >= len) return result;
+    threads = std::max(1u, threads);
+
+    // 1. FRAMING: cut the file into record-aligned chunks (< 4 GiB each,
+    //    so bucketed offsets fit in 32 bits).
+    const size_t target = std::min<size_t>(size_t(1) << 30,
+                                           std::max<size_t>(size_t(1) << 20, (len - begin) / (threads * 4)));
+    std::vector<Chunk> chunks(1);
+    chunks[0].begin = begin;
+    size_t pos = begin;
+    WalDecode frame_status = WalDecode::Ok;
+    while (pos < len) {
+        size_t used;
+        frame_status = frame_wal_record(data + pos, len - pos, used);
+        if (frame_status != WalDecode::Ok) break;
+        pos += used;
+        if (pos - chunks.back().begin >= target && pos < len) {
+            chunks.back().end = pos;
+            chunks.emplace_back();
+            chunks.back().begin = pos;
+        }
+    }
+    chunks.back().end = pos;
+
+    // 2. VERIFY + BUCKET by shard, in parallel over chunks
+    const size_t num_shards = store.shardCount();
+    std::unique_ptr<DistinctCounter[]> distinct(new DistinctCounter[num_shards]);
+
+    parallel_for(chunks.size(), threads, [&](size_t c) {
+        Chunk& chunk = chunks[c];
+        chunk.buckets.resize(num_shards);
+        size_t p = chunk.begin;
+        WalRecord rec;
+        size_t used;
+        while (p < chunk.end) {
+            WalDecode status = decode_wal_record(data + p, chunk.end - p, rec, used);
+            if (status == WalDecode::Ok && rec.op == WalOp::Cursor) status = WalDecode::Corrupt;
+            if (status != WalDecode::Ok) {
+                chunk.bad_offset = p;
+                chunk.bad_status = status;
+                return;
+            }
+            size_t hash = ShardStore::keyHash(rec.key);
+            size_t shard = store.shardOfHash(hash);
+            chunk.buckets[shard].push_back(static_cast<uint32_t>(p - chunk.begin));
+            if (rec.op == WalOp::Set) distinct[shard].add(hash);
+            p += used;
+        }
+    });
+
+    // Everything after the first bad record is dropped, as in a sequential scan
+    size_t valid_chunks = chunks.size();
+    result.valid_bytes = pos;
+    result.tail = frame_status;
+    for (size_t c = 0; c < chunks.size(); ++c) {
+        if (chunks[c].bad_offset != SIZE_MAX) {
+            valid_chunks = c + 1;
+            result.valid_bytes = chunks[c].bad_offset;
+            result.tail = chunks[c].bad_status;
+            break;
+        }
+    }
+
+    // 3. RESERVE + APPLY, in parallel over shards
+    std::atomic<uint64_t> applied{0};
+    parallel_for(num_shards, threads, [&](size_t s) {
+        size_t records = 0;
+        for (size_t c = 0; c < valid_chunks; ++c) records += chunks[c].buckets[s].size();
+        if (records == 0) return;
+
+        Shard& shard = store.shard(s);
+        FlatStringMap& map = shard.map;
+        size_t expected = std::min(records, static_cast<size_t>(distinct[s].estimate() * 1.05) + 1);
+        map.reserve(map.size() + expected);
+
+        WalRecord rec;
+        size_t used;
+        for (size_t c = 0; c < valid_chunks; ++c) {
+            const Chunk& chunk = chunks[c];
+            for (uint32_t off : chunk.buckets[s]) {
+                const char* p = data + chunk.begin + off;
+                decode_wal_record(p, chunk.end - chunk.begin - off, rec, used, false);
+                if (rec.op == WalOp::Set) shard.put(rec.key, std::string(rec.value));
+                else shard.erase(rec.key);
+            }
+        }
+        applied += records;
+    });
+    result.records = applied.load();
+    return result;
+}
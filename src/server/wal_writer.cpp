@@ -0,0 +1,300 @@
+#include "../../include/wal_writer.hpp"
+#include "../../include/file_util.hpp"
+#include "../../include/logger.hpp"
+#include <chrono>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <iterator>
+
+// --- DURABILITY MODES ---
+
+bool parse_durability(const std::string& name, Durability& out) {
+    if (name == "none") out = Durability::None;
+    else if (name == "interval") out = Durability::Interval;
+    else if (name == "group") out = Durability::Group;
+    else if (name == "every-write") out = Durability::EveryWrite;
+    else return false;
+    return true;
+}
+
+const char* durability_name(Durability mode) {
+    switch (mode) {
+        case Durability::None: return "none";
+        case Durability::Interval: return "interval";
+        case Durability::Group: return "group";
+        case Durability::EveryWrite: return "every-write";
+    }
+    return "unknown";
+}
+
+// --- WAL WRITER ---
+
+WalWriter::~WalWriter() { close(); }
+
+bool WalWriter::open(const std::string& path, Durability mode, int interval_ms, std::string_view file_header) {
+    close();
+    path_ = path;
+    header_ = std::string(file_header);
+    if (!openFile()) return false;
+    mode_ = mode;
+    interval_ms_ = interval_ms > 0 ? interval_ms : 1;
+    stop_ = false;
+    healthy_ = true;
+    thread_ = std::thread(&WalWriter::run, this);
+    return true;
+}
+
+bool WalWriter::openFile() {
+    fd_ = file_open_append(path_);
+    if (fd_ < 0) {
+        LOG_ERROR << "[WAL] Cannot open " << path_ << ": " << std::strerror(errno);
+        return false;
+    }
+    int64_t size = file_size(fd_);
+    if (size == 0) {
+        if (!file_write_all(fd_, header_.data(), header_.size())) return false;
+        size = static_cast<int64_t>(header_.size());
+    }
+    file_bytes_ = size > 0 ? static_cast<uint64_t>(size) : 0;
+    return true;
+}
+
+void WalWriter::close() {
+    if (fd_ < 0) return;
+    {
+        std::lock_guard<std::mutex> lock(mu_);
+        stop_ = true;
+    }
+    work_cv_.notify_one();
+    thread_.join();
+    if (mode_ != Durability::None) file_sync(fd_);
+    {
+        std::unique_lock<std::mutex> lock(mu_);
+        synced_seq_ = written_seq_;
+        notifyWaiters(lock);
+    }
+    file_close(fd_);
+    fd_ = -1;
+}
+
+uint64_t WalWriter::append(std::string_view record) {
+    uint64_t seq;
+    {
+        std::lock_guard<std::mutex> lock(mu_);
+        pending_.append(record.data(), record.size());
+        if (mode_ == Durability::EveryWrite) pending_ends_.push_back(pending_.size());
+        seq = ++appended_seq_;
+    }
+    work_cv_.notify_one();
+    return seq;
+}
+
+bool WalWriter::waitDurable(uint64_t seq) {
+    std::unique_lock<std::mutex> lock(mu_);
+    switch (mode_) {
+        case Durability::None:
+            break;
+        case Durability::Interval:
+            done_cv_.wait(lock, [&] { return written_seq_ >= seq || !healthy_; });
+            break;
+        case Durability::Group:
+        case Durability::EveryWrite:
+            done_cv_.wait(lock, [&] { return synced_seq_ >= seq || !healthy_; });
+            break;
+    }
+    return healthy_;
+}
+
+void WalWriter::whenDurable(uint64_t seq, std::function<void(bool)> fn) {
+    bool ok;
+    {
+        std::lock_guard<std::mutex> lock(mu_);
+        if (healthy_ && !isDurable(seq)) {
+            waiters_.push_back({seq, std::move(fn)});
+            return;
+        }
+        ok = healthy_;
+    }
+    fn(ok);
+}
+
+bool WalWriter::isDurable(uint64_t seq) const {
+    switch (mode_) {
+        case Durability::None: return true;
+        case Durability::Interval: return written_seq_ >= seq;
+        case Durability::Group:
+        case Durability::EveryWrite: return synced_seq_ >= seq;
+    }
+    return true;
+}
+
+// Runs the whenDurable callbacks that progress has satisfied, outside mu_.
+// Sequence numbers are handed out under mu_ in order, so waiters_ is sorted.
+void WalWriter::notifyWaiters(std::unique_lock<std::mutex>& lock) {
+    size_t ready = 0;
+    while (ready < waiters_.size() && (!healthy_ || isDurable(waiters_[ready].seq))) ready++;
+    if (ready == 0) return;
+    std::vector<DurableWaiter> batch(std::make_move_iterator(waiters_.begin()),
+                                     std::make_move_iterator(waiters_.begin() + ready));
+    waiters_.erase(waiters_.begin(), waiters_.begin() + ready);
+    bool ok = healthy_;
+    lock.unlock();
+    for (auto& w : batch) w.fn(ok);
+    lock.lock();
+}
+
+void WalWriter::waitIdle(std::unique_lock<std::mutex>& lock) {
+    work_cv_.notify_one();
+    done_cv_.wait(lock, [&] { return (!busy_ && written_seq_ == appended_seq_) || !healthy_; });
+}
+
+void WalWriter::reset() {
+    std::unique_lock<std::mutex> lock(mu_);
+    waitIdle(lock);
+    // Writer thread is idle and blocked on mu_, so nothing races the truncate.
+    if (!file_truncate(fd_, 0) || !file_write_all(fd_, header_.data(), header_.size())) healthy_ = false;
+    file_bytes_ = header_.size();
+}
+
+bool WalWriter::rotate(const std::string& rotated_path) {
+    std::unique_lock<std::mutex> lock(mu_);
+    done_cv_.wait(lock, [&] { return !rotate_requested_; });  // One cut at a time
+    if (!healthy_) return false;
+
+    // Everything appended before this point goes to the old segment. The
+    // writer thread makes the cut between two batches, so appends never wait.
+    rotate_requested_ = true;
+    rotate_bytes_ = pending_.size();
+    rotate_records_ = pending_ends_.size();
+    rotate_seq_ = appended_seq_;
+    rotate_path_ = rotated_path;
+    work_cv_.notify_one();
+    done_cv_.wait(lock, [&] { return !rotate_requested_; });
+    return rotate_ok_;
+}
+
+// Writer thread, holding mu_, once the old segment is durable. Only metadata
+// operations happen here, so appenders are held up briefly.
+bool WalWriter::switchFile(const std::string& rotated_path) {
+    file_close(fd_);
+    fd_ = -1;
+    std::remove(rotated_path.c_str());
+    bool ok = std::rename(path_.c_str(), rotated_path.c_str()) == 0;
+    if (!openFile()) ok = false;
+    if (ok) file_sync_parent_dir(path_);
+    return ok;
+}
+
+uint64_t WalWriter::logBytes() {
+    std::lock_guard<std::mutex> lock(mu_);
+    return file_bytes_;
+}
+
+void WalWriter::run() {
+    using clock = std::chrono::steady_clock;
+    const auto interval = std::chrono::milliseconds(interval_ms_);
+    auto last_sync = clock::now();
+
+    std::string batch;
+    std::vector<size_t> ends;
+    auto timed_sync = [&] {
+        auto start = clock::now();
+        bool ok = file_sync(fd_);
+        fsync_latency_.recordSince(start);
+        return ok;
+    };
+    std::unique_lock<std::mutex> lock(mu_);
+
+    while (true) {
+        work_cv_.wait_for(lock, interval, [&] { return stop_ || !pending_.empty() || rotate_requested_; });
+
+        if (pending_.empty() && !rotate_requested_) {
+            if (stop_) break;
+            // Idle tick: Interval mode still owes an fdatasync for recent writes.
+            if (mode_ == Durability::Interval && synced_seq_ < written_seq_) {
+                uint64_t target = written_seq_;
+                busy_ = true;
+                lock.unlock();
+                bool ok = timed_sync();
+                last_sync = clock::now();
+                lock.lock();
+                busy_ = false;
+                if (ok) synced_seq_ = target;
+                else healthy_ = false;
+                done_cv_.notify_all();
+                notifyWaiters(lock);
+            }
+            continue;
+        }
+
+        // 1. Take the whole group in one swap, or only the records before the
+        //    cut when a rotate() is pending
+        const bool cut = rotate_requested_;
+        const uint64_t first = written_seq_ + 1;
+        const uint64_t last = cut ? rotate_seq_ : appended_seq_;
+        if (cut) {
+            batch.assign(pending_, 0, rotate_bytes_);
+            pending_.erase(0, rotate_bytes_);
+            ends.assign(pending_ends_.begin(), pending_ends_.begin() + rotate_records_);
+            pending_ends_.erase(pending_ends_.begin(), pending_ends_.begin() + rotate_records_);
+            for (size_t& end : pending_ends_) end -= rotate_bytes_;
+        } else {
+            batch.swap(pending_);
+            ends.swap(pending_ends_);
+        }
+        const std::string rotated_path = cut ? rotate_path_ : std::string();
+        busy_ = true;
+        lock.unlock();
+
+        // 2. Write it out (one write per group, or one write+sync per record)
+        bool ok = true;
+        bool synced = false;
+        if (mode_ == Durability::EveryWrite) {
+            size_t begin = 0;
+            for (size_t i = 0; i < ends.size() && ok; ++i) {
+                ok = file_write_all(fd_, batch.data() + begin, ends[i] - begin) && timed_sync();
+                begin = ends[i];
+                if (ok) {
+                    std::unique_lock<std::mutex> progress(mu_);
+                    written_seq_ = synced_seq_ = first + i;
+                    done_cv_.notify_all();
+                    notifyWaiters(progress);
+                }
+            }
+            synced = ok;
+        } else {
+            ok = file_write_all(fd_, batch.data(), batch.size());
+            bool due = mode_ == Durability::Interval && clock::now() - last_sync >= interval;
+            // The old segment must be durable before it is renamed away
+            if (ok && (mode_ == Durability::Group || due || cut)) {
+                ok = timed_sync();
+                synced = ok;
+                last_sync = clock::now();
+            }
+        }
+        const size_t batch_bytes = batch.size();
+        if (last >= first) {
+            batch_records_.record(last - first + 1);
+            batch_bytes_.record(batch_bytes);
+        }
+        batch.clear();
+        ends.clear();
+
+        // 3. Publish progress and wake the waiters of this group; on a cut,
+        //    switch to a fresh log and release the rotate() caller
+        lock.lock();
+        busy_ = false;
+        written_seq_ = last;
+        if (synced) synced_seq_ = last;
+        file_bytes_ += batch_bytes;
+        if (cut) {
+            if (ok) ok = switchFile(rotated_path);
+            rotate_ok_ = ok;
+            rotate_requested_ = false;
+        }
+        if (!ok) healthy_ = false;
+        done_cv_.notify_all();
+        notifyWaiters(lock);
+    }
+}